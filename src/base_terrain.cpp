@@ -21,6 +21,7 @@
 #include "wml_node.hpp"
 #include "wml_utils.hpp"
 
+#include <cassert>
 #include <iostream>
 #include <cstdlib>
 
@@ -30,6 +31,7 @@ namespace hex
 namespace {
 
 std::map<std::string,base_terrain_ptr> terrains;
+std::vector<const_base_terrain_ptr> terrains_by_index;
 
 }
 
@@ -44,6 +46,12 @@ const_base_terrain_ptr base_terrain::get(const std::string& id)
 	}
 }
 
+const_base_terrain_ptr base_terrain::get_by_index(int index)
+{
+	assert(index >= 0 && index < terrains_by_index.size());
+	return terrains_by_index[index];
+}
+
 void base_terrain::get_terrain_ids(std::vector<std::string>& res)
 {
 	for(std::map<std::string,base_terrain_ptr>::const_iterator i =
@@ -144,14 +152,17 @@ GLfloat base_terrain::get_rotation(const location& loc, int height) const
 void base_terrain::add_terrain(wml::const_node_ptr node)
 {
 	const base_terrain_ptr ptr(new base_terrain(node));
-	terrains.insert(std::pair<std::string,base_terrain_ptr>(
-							ptr->id_,ptr));
+	if(terrains.insert(std::pair<std::string,base_terrain_ptr>(
+							ptr->id_,ptr)).second) {
+		ptr->index_ = terrains_by_index.size();
+		terrains_by_index.push_back(ptr);
+	}
 	std::cerr << "loaded terrain '" << ptr->id_ << "'\n";
 
 }
 
 base_terrain::base_terrain(wml::const_node_ptr node)
-    : cliff_particles_(node->get_child("cliff_particles")),
+    : index_(-1), cliff_particles_(node->get_child("cliff_particles")),
       overlap_priority_(wml::get_attr<int>(node,"overlap_priority")),
       vision_block_(wml::get_attr<GLfloat>(node,"vision_block")),
 	  default_cost_(wml::get_int(node,"cost",-1)),
@@ -43,6 +43,11 @@ public:
 
 	static void add_terrain(wml::const_node_ptr node);
 
+	//terrains are numbered in the order they're added, so maps can
+	//store them compactly.
+	static const_base_terrain_ptr get_by_index(int index);
+	int index() const { return index_; }
+
 	const std::string& id() const { return id_; }
 	const std::string& name() const { return name_; }
 
@@ -58,6 +63,7 @@ private:
 	explicit base_terrain(wml::const_node_ptr node);
 
 	std::string id_;
+	int index_;
 	std::string name_;
 	std::vector<std::string> textures_;
 	std::vector<std::string> models_;
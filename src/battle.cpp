@@ -39,32 +39,20 @@
 namespace game_logic
 {
 
-namespace {
-
-bool battle_char_less(const const_battle_character_ptr& c1,
-                      const const_battle_character_ptr& c2)
-{
-	return c1->ready_to_move_at() < c2->ready_to_move_at();
-}
-
-}
-
 battle::battle(const std::vector<battle_character_ptr>& chars,
                const hex::gamemap& battle_map)
-    : chars_(chars), focus_(chars_.end()), map_(battle_map),
+    : battle_engine(chars, battle_map, SDL_GetTicks()),
+      fast_resolve_(preference_fast_battles()), animate_(true),
       highlight_moves_(false), highlight_targets_(false),
       move_done_(false), turn_done_(false),
       camera_(battle_map), camera_controller_(camera_),
-      result_(ONGOING), keyed_selection_(0),
-      current_time_(0), sub_time_(0.0),
+      keyed_selection_(0), sub_time_(0.0),
       tracked_tile_(NULL), 
       initiative_bar_(new gui::initiative_bar),
       listener_(this),
       renderer_(map_, camera_),
       selection_(renderer_)
 {
-    srand(SDL_GetTicks());
-    
     for(std::vector<battle_character_ptr>::const_iterator i = chars_.begin();
         i != chars_.end(); ++i) {
 
@@ -81,7 +69,8 @@ battle::battle(const std::vector<battle_character_ptr>& chars,
     
     add_widget(initiative_bar_);
     
-    std::sort(chars_.begin(), chars_.end(), battle_char_less);
+    begin_turn();
+    record_events(true);
 
     pump_.register_listener(&listener_);
     pump_.register_listener(&camera_controller_);
@@ -91,29 +80,23 @@ battle::battle(const std::vector<battle_character_ptr>& chars,
 void battle::play()
 {
     while(result_ == ONGOING) {
-        std::sort(chars_.begin(),chars_.end(),battle_char_less);
-        focus_ = chars_.begin();
+        begin_turn();
         
-        // Update the initiative bar, moving the game time forward, until
-        // someone is ready to move.
-        while(current_time_ < (*focus_)->ready_to_move_at()) {
-            sub_time_ = 0.0;
-            while(sub_time_ < 1.0) {
-                initiative_bar_->set_current_time(current_time_ + sub_time_);
-                animation_frame(0.5);
-				pump_.process();
-            }
-            // Check whether character modifications expired.
-            foreach(battle_character_ptr ch, chars_) {
-                ch->update_time(current_time_);
-            }
-            
-            ++current_time_;
+        // Move the game time forward until someone is ready to move, and
+        // then show it passing on the initiative bar.
+        while(!focus_ready()) {
+            advance_time();
         }
+
+        //when battles are resolved fast, only the turns of the player's
+        //characters, and the time leading up to them, are animated.
+        animate_ = !fast_resolve_ || (*focus_)->is_human();
+        play_events();
         
         initiative_bar_->set_current_time(current_time_);
         sub_time_ = 0.0;
-        (*focus_)->play_turn(*this);
+        play_turn();
+        play_events();
     }
 
     if(result_ == QUIT) {
@@ -147,7 +130,7 @@ void battle::player_turn(battle_character& c)
             const_battle_move_ptr move = menu_->highlighted_move();
             if(move) {
                 //std::cerr << "highlighted move: " << move->name() << ": " << move->min_moves() << "\n";
-                initiative_bar_->focus_character(focus_->get(), move->min_moves() > 0 ? 0 : move->get_stat("initiative", **focus_));
+                initiative_bar_->focus_character(focus_->get(), move->min_moves() > 0 ? 0 : move->get_stat(STAT_INITIATIVE, **focus_));
             }
         }
         
@@ -185,12 +168,16 @@ void battle::player_turn(battle_character& c)
                 if(!input) {
                     if(current_move_->mod()) {
                         if(current_move_->mod()->target() == battle_modification::TARGET_SELF) {
-                            current_move_->mod()->apply(**focus_,**focus_,current_time_);
+                            std::vector<int> damage;
+                            current_move_->mod()->apply(**focus_,**focus_,current_time_,&damage);
+                            foreach(int amount, damage) {
+                                show_damage(**focus_, amount);
+                            }
                         }
                     }
                     
                     (*focus_)->use_energy(current_move_->energy_required());
-                    (*focus_)->set_time_until_next_move(current_move_->get_stat("initiative",**focus_));
+                    (*focus_)->set_time_until_next_move(current_move_->get_stat(STAT_INITIATIVE,**focus_));
                     initiative_bar_->focus_character(NULL);
                     turn_done_ = true;
                 }
@@ -220,11 +207,6 @@ void battle::remove_widget(gui::widget_ptr w)
     pump_.deregister_listener(w);
 }
 
-int battle::movement_duration()
-{
-	return 10;
-}
-
 battle_character_ptr battle::mouse_selected_char() {
     int select_name = selection_.get_selected_avatar();
     
@@ -401,6 +383,10 @@ bool battle::draw()
         }
     }
     
+    foreach(const_battle_character_ptr c, dying_) {
+        renderer_.add_avatar(c->avatar());
+    }
+    
     if(missile_) {
         renderer_.add_avatar(missile_->avatar());
     }
@@ -503,130 +489,124 @@ void battle::elapse_time(GLfloat anim_elapse, int frames, bool in_anim) {
 
 void battle::move_character(battle_character& c, const battle_character::route& r)
 {
-    begin_animation();
-    
-    const GLfloat time = c.begin_move(r);
-    
-    for(GLfloat t = 0; t < time; t += 0.1) {
-        initiative_bar_->focus_character(&c, t);
-        c.set_movement_time(t);
-        animation_frame(0.1);
-    }
-    
-    initiative_bar_->focus_character(&c, 0.0);
-    
-    c.end_move();
-    end_animation();
+    battle_engine::move_character(c, r);
+    play_events();
 }
 
-battle::attack_stats battle::get_attack_stats(
-     const battle_character& attacker,
-	 const battle_character& defender,
-	 const battle_move& move,
-	 std::string* description,
-	 hex::location from_loc) const
+void battle::attack_character(battle_character& attacker,
+                              battle_character& defender,
+			      const battle_move& attack_move)
 {
-	if(!from_loc.valid()) {
-		from_loc = attacker.loc();
+	battle_engine::attack_character(attacker, defender, attack_move);
+	play_events();
+}
+
+int battle::attack_roll(battle_character& attacker,
+                        battle_character& defender,
+                        const attack_stats& stats)
+{
+	int random = battle_engine::attack_roll(attacker, defender, stats);
+	if(!preference_sliders() || !attacker.is_human()) {
+		return random;
 	}
 
-	const int height_diff = map_.get_tile(from_loc).height() -
-	                        map_.get_tile(defender.loc()).height();
-	//std::cerr << "height diff: " << height_diff << "\n";
-	const character& ch = attacker.get_character();
-	static const std::string AttackStat = "attack";
-	static const std::string DefenseStat = "defense";
-	static const std::string DamageStat = "damage";
-	static const std::string InitiativeStat = "initiative";
-	static const std::string StaminaUsedStat = "stamina_used";
-	attack_stats stats;
-	stats.attack = std::max<int>(ch.stat_mod_height(AttackStat,height_diff) +
-	    move.get_stat(AttackStat,attacker), 1);
-	stats.defense = std::max<int>(defender.defense(
-	                  attacker.get_character().damage_type()), 0);
-	stats.damage = std::max<int>(ch.stat_mod_height(DamageStat,height_diff/2) +
-	                  attacker.adjust_damage(move.get_stat(DamageStat,attacker)), 1);
-	stats.damage_critical = stats.damage;
-	stats.time_taken = ch.stat_mod_height(InitiativeStat,height_diff) +
-	                       move.get_stat(InitiativeStat,attacker);
-	stats.stamina_used = ch.stat_mod_height(StaminaUsedStat,height_diff) +
-	                       move.get_stat(StaminaUsedStat,attacker);
-	int resist_amount, resist_percent;
-	defender.get_character().get_resistance(
-	                        attacker.get_character().damage_type(),
-	                        &resist_amount, &resist_percent);
-	stats.damage -=
-	    (std::min(resist_amount,stats.damage)*resist_percent)/100;
-
-	bool behind = false;
-	const bool engaged = is_engaged(defender);
-	if(engaged) {
-		switch(abs(hex::get_adjacent_direction(defender.loc(),
-		                 from_loc) - defender.facing())) {
-		case 2:
-		case 3:
-		case 4:
-			stats.defense = defender.defense_behind();
-			behind = true;
-			break;
-		}
+	const SDL_Rect slider_rect = {100, 650, 800, 100};
+	input::pump local_pump;
+	gui::slider slider(local_pump, slider_rect, stats.attack, stats.defense, true);
+
+	begin_animation();
+	for(GLfloat t = 0.0; slider.result() == gui::slider::PENDING; t += 0.08) {
+		local_pump.process();
+		slider.process();
+		slider.set_time(t);
+		animation_frame(0.0, &slider);
 	}
+	end_animation();
 
-	if(description) {
-		const int chance_to_hit = std::min<int>(100, std::max<int>(0, stats.attack - stats.defense));
-		*description += formatter() << "Attack: " <<
-		                stats.attack << "\nDefense: " <<
-						stats.defense <<
-						(behind ? " (from behind!)" : "") << "\nChance to hit: " << chance_to_hit <<
-						"%\nDamage: " << stats.damage <<
-						"\nTime: " << stats.time_taken << "s";
-		if(stats.attack > stats.defense &&
-		   stats.damage_critical != stats.damage) {
-			const int chance_to_critical = std::min<int>(100, std::max<int>(0, stats.attack/2 - stats.defense));
-			*description += formatter() << "Chance to critical: " <<
-			                chance_to_critical <<
-							"%\nCritical damage: " <<
-							stats.damage_critical;
-		}
+	if(slider.result() == gui::slider::RED) {
+		random *= 2;
+	} else if(slider.result() == gui::slider::BLUE) {
+		random /= 2;
+	}
+
+	//flush any remaining events
+	local_pump.process();
+	return random;
+}
 
+void battle::play_events()
+{
+	while(has_events()) {
+		const event e = next_event();
+		switch(e.type) {
+		case event::TIME_PASSED:
+			if(animate_) {
+				animate_time(e);
+			}
+			break;
+		case event::MOVE:
+			if(animate_) {
+				animate_move(e);
+			}
+			break;
+		case event::ATTACK:
+			if(animate_) {
+				animate_attack(e);
+			}
+			break;
+		case event::DAMAGE:
+			if(animate_) {
+				animate_damage(e);
+			}
+			break;
+		case event::DEATH:
+			animate_death(e);
+			break;
+		}
 	}
+}
 
-	return stats;
+void battle::animate_time(const event& e)
+{
+	sub_time_ = 0.0;
+	while(sub_time_ < 1.0) {
+		initiative_bar_->set_current_time(e.time + sub_time_);
+		animation_frame(0.5);
+		pump_.process();
+	}
 }
 
-void battle::attack_character(battle_character& attacker,
-                              battle_character& defender,
-			      const battle_move& attack_move)
+void battle::animate_move(const event& e)
 {
-	attack_stats stats = get_attack_stats(attacker,defender,attack_move);
-	const_battle_character_ptr engaged_with = is_engaged(defender);
-	const bool otherwise_engaged = engaged_with &&
-	                 engaged_with->loc() != attacker.loc();
-
-	attacker.get_character().use_stamina(stats.stamina_used);
-	attacker.begin_facing_change(
-	  hex::get_main_direction(attacker.loc(),defender.loc()));
-
-	if(!otherwise_engaged) {
-		defender.begin_facing_change(
-		  hex::get_main_direction(defender.loc(),attacker.loc()));
+	battle_character& c = *e.actor;
+	begin_animation();
+
+	const GLfloat time = c.route_cost(e.route);
+
+	for(GLfloat t = 0; t < time; t += 0.1) {
+		initiative_bar_->focus_character(&c, t);
+		c.show_move(e.route, t);
+		animation_frame(0.1);
 	}
 
-	int random = rand()%100;
-	const int chance_to_hit = stats.attack - stats.defense;
+	initiative_bar_->focus_character(&c, 0.0);
 
-	const SDL_Rect slider_rect = {100, 650, 800, 100};
-	const bool use_slider = preference_sliders() && attacker.is_human();
-	bool applied_slider_result = false;
-	input::pump local_pump;
-	gui::slider slider(local_pump, slider_rect, stats.attack, stats.defense, use_slider);
+	c.show_move(e.route, -1.0);
+	end_animation();
+}
+
+void battle::animate_attack(const event& e)
+{
+	battle_character& attacker = *e.actor;
+	battle_character& defender = *e.target;
+	const attack_stats& stats = e.stats;
+	const int chance_to_hit = stats.attack - stats.defense;
 
 	GLfloat highlight[] = {1.0,0.0,0.0,0.5};
 	const GLfloat elapsed_time = stats.time_taken;
-	const GLfloat anim_time = use_slider ? slider.duration() : elapsed_time/5.0;
-	GLfloat begin_hit = use_slider ? -1.0 : 0.4;
-	GLfloat end_hit = use_slider ? -1.0 : 0.8;
-	attacker.begin_attack(defender);
+	const GLfloat anim_time = elapsed_time/5.0;
+	const GLfloat begin_hit = 0.4;
+	const GLfloat end_hit = 0.8;
 
 	graphics::const_model_ptr missile;
 	if(const equipment* weapon = attacker.get_character().weapon()) {
@@ -642,11 +622,12 @@ void battle::attack_character(battle_character& attacker,
 		}
 	}
 
+	if(hex::is_valid_direction(e.target_facing)) {
+		defender.show_facing_change(e.target_facing);
+	}
+
 	begin_animation();
 	for(GLfloat t = 0.0; t < anim_time; t += 0.08) {
-		local_pump.process();
-		slider.process();
-		slider.set_time(t);
 		initiative_bar_->focus_character(&attacker, t*(elapsed_time/anim_time));
 		if(missile_.get()) {
 			missile_->update();
@@ -655,45 +636,23 @@ void battle::attack_character(battle_character& attacker,
 		attacker.set_movement_time(cur_time);
 		defender.set_movement_time(cur_time);
 		attacker.set_attack_time(cur_time);
-		if(random > chance_to_hit &&
+		if(e.roll > chance_to_hit &&
 		   cur_time >= begin_hit && cur_time <= end_hit) {
 			defender.set_highlight(highlight);
 		}
 
-		if(use_slider && !applied_slider_result && slider.result() != gui::slider::PENDING) {
-			if(slider.result() == gui::slider::RED) {
-				random *= 2;
-			} else if(slider.result() == gui::slider::BLUE) {
-				random /= 2;
-			}
-
-			begin_hit = t;
-			end_hit = t + 0.4;
-		}
-		
-		animation_frame(0.02 * elapsed_time/anim_time, &slider);
+		animation_frame(0.02 * elapsed_time/anim_time);
 		defender.set_highlight(NULL);
 	}
 	end_animation();
 
 	missile_.reset();
-	attacker.end_attack();
-	attacker.end_facing_change();
 	defender.end_facing_change();
 
 	std::cerr << "time until next: " << stats.time_taken << "\n";
 	initiative_bar_->focus_character(&attacker, 0.0);
-	attacker.set_time_until_next_move(stats.time_taken);
-	(*focus_)->use_energy(attack_move.energy_required());
-
-	int damage = stats.damage;
-	if(random <= stats.defense) {
-		damage = 0;
-	} else if(random >= stats.defense*2) {
-		damage = stats.damage_critical;
-	}
 
-	std::cerr << "rand: " << random << "/" << stats.defense << " -> " << damage << "\n";
+	std::cerr << "rand: " << e.roll << "/" << stats.defense << " -> " << e.damage << "\n";
 
 	const SDL_Color red = {0xFF,0x0,0x0,0xFF};
 	const SDL_Color blue = {0x0,0x0,0xFF,0xFF};
@@ -703,145 +662,52 @@ void battle::attack_character(battle_character& attacker,
 	defender.get_pos(pos,&rotate);
 
         text::renderer& text_renderer = text::renderer::instance();
-	if(damage) {
-            text::rendered_text_ptr damage_tex = text_renderer.render(boost::lexical_cast<std::string>(damage), 20, red);
+	if(e.damage) {
+            text::rendered_text_ptr damage_tex = text_renderer.render(boost::lexical_cast<std::string>(e.damage), 20, red);
             graphics::floating_label::add(damage_tex->as_texture(),pos,move,50);
 	} else {
             text::rendered_text_ptr damage_tex = text_renderer.render("miss!", 20, blue);
             graphics::floating_label::add(damage_tex->as_texture(),pos,move,50);
 	}
-
-	defender.get_character().take_damage(damage);
-	handle_dead_character(defender);
-
-	//flush any remaining events
-	local_pump.process();
 }
 
-void battle::handle_dead_character(const battle_character& c)
+void battle::animate_damage(const event& e)
 {
-	if(!c.get_character().dead()) {
-		return;
-	}
-
-	elapse_time(0.0, 50);
-
-	initiative_bar_->remove_character(&c);
-
-	for(std::vector<battle_character_ptr>::iterator i = chars_.begin();
-	    i != chars_.end(); ++i) {
-		if(i->get() == &c) {
-			chars_.erase(i);
-			break;
-		}
-	}
-	bool found_player = false;
-	bool found_enemy = false;
-	foreach(const battle_character_ptr& ch, chars_) {
-		if(ch->is_human()) {
-			found_player = true;
-		} else {
-			found_enemy = true;
-		}
-	}
+	const SDL_Color red = {0xFF,0x0,0x0,0xFF};
+	const SDL_Color blue = {0x0,0x0,0xFF,0xFF};
+	const GLfloat move[3] = {0.0,0.0,0.01};
+	GLfloat pos[3];
+	GLfloat rotate;
+	e.actor->get_pos(pos,&rotate);
 
-	if(found_player && !found_enemy) {
-		result_ = PLAYER_WIN;
-	} else if(found_enemy && !found_player) {
-		result_ = PLAYER_LOSE;
-	}
+	text::renderer& renderer = text::renderer::instance();
+	graphics::floating_label::add(renderer.render(formatter() << e.damage, 20,
+	                                              e.damage <= 0 ? blue : red)->as_texture(),
+	                              pos, move, 1000);
 }
 
-void battle::target_mod(battle_character& caster,
-                        const hex::location& target,
-                        const battle_move& move)
+void battle::animate_death(const event& e)
 {
-    const int time_to_perform = move.get_stat("initiative",caster);
-#if 0
-    // FIXME: move particle emitter to renderer usw
-
-    if(graphics::particle_emitter_ptr missile = move.create_missile_emitter()) {
-        using hex::tile;
-        const hex::location& src = caster.loc();
-        assert(map_.is_loc_on_map(src));
-        assert(map_.is_loc_on_map(target));
-        const hex::tile& src_tile = map_.get_tile(src);
-        const hex::tile& dst_tile = map_.get_tile(target);
-        GLfloat src_pos[] = {tile::translate_x(src), tile::translate_y(src), tile::translate_height(src_tile.height())};
-        GLfloat dst_pos[] = {tile::translate_x(target), tile::translate_y(target), tile::translate_height(dst_tile.height())};
-        
-        const GLfloat nframes = 100.0;
-        
-        begin_animation();
-        for(GLfloat frame = 0.0; frame <= nframes; frame += 1.0) {
-            GLfloat pos[3];
-            for(int n = 0; n != 3; ++n) {
-                pos[n] = dst_pos[n]*(frame/nframes) + src_pos[n]*((nframes-frame)/nframes);
-            }
-            
-            missile->set_pos(pos);
-            missile->emit_particle(particle_system_);
-            animation_frame(time_to_perform/static_cast<GLfloat>(nframes));
-        }
-        end_animation();
-    }
-#endif
+	if(animate_) {
+		elapse_time(0.0, 50);
+	}
 
-    assert(move.mod());
-    const battle_modification& mod = *move.mod();
-    caster.set_time_until_next_move(time_to_perform);
-    caster.use_energy(move.energy_required());
-    const battle_modification::TARGET_TYPE type = mod.target();
-    const int radius = mod.radius();
-    std::vector<hex::location> locs;
-    std::vector<battle_character_ptr> affected_chars;
-    get_locations_in_radius(target, radius, locs);
-    foreach(battle_character_ptr ch, chars_) {
-        if(std::find(locs.begin(),locs.end(),ch->loc()) == locs.end()) {
-            continue;
-        }
-        
-        if(type == battle_modification::TARGET_ENEMY &&
-           !caster.is_enemy(*ch)) {
-            continue;
-        }
-        
-        if(type == battle_modification::TARGET_FRIEND &&
-           caster.is_enemy(*ch)) {
-            continue;
-        }
-        affected_chars.push_back(ch);
-    }
-    foreach(battle_character_ptr ch, affected_chars) {
-        mod.apply(caster, *ch, current_time_);
-        handle_dead_character(*ch);
-    }
-    
+	initiative_bar_->remove_character(e.actor.get());
+	dying_.erase(std::remove(dying_.begin(), dying_.end(), e.actor),
+	             dying_.end());
 }
 
-bool battle::can_make_move(const battle_character& c,
-                           const battle_move& move) const
+void battle::handle_dead_character(const battle_character& c)
 {
-	if(move.energy_required() > c.energy()) {
-		std::cerr << "CANNOT MAKE MOVE: " << move.energy_required() << " > " << c.energy() << "\n";
-		return false;
+	if(!c.get_character().dead()) {
+		return;
 	}
 
-	if(move.max_moves() > 0) {
-		battle_character::move_map moves;
-		c.get_possible_moves(moves, move, chars_);
-		return !moves.empty();
-	} else if(move.must_attack()) {
-		foreach(const battle_character_ptr& enemy, chars_) {
-			if(c.is_enemy(*enemy) && c.can_attack(*enemy, chars_)) {
-				return true;
-			}
-		}
-
-		return false;
+	if(battle_character_ptr ch = participant(c)) {
+		dying_.push_back(ch);
 	}
 
-	return true;
+	battle_engine::handle_dead_character(c);
 }
 
 bool battle::enter_move_mode()
@@ -864,7 +730,7 @@ bool battle::enter_attack_mode()
 	}
 
 	foreach(const battle_character_ptr& c, chars_) {
-		if(*focus_ != c && (*focus_)->is_enemy(*c) && (*focus_)->can_attack(*c, chars_)) {
+		if(*focus_ != c && (*focus_)->is_enemy(*c) && (*focus_)->can_attack(*c)) {
 			targets_.insert(c->loc());
 		}
 	}
@@ -891,24 +757,6 @@ bool battle::enter_target_mode()
 	return highlight_targets_;
 }
 
-const_battle_character_ptr battle::is_engaged(
-      const battle_character& c) const
-{
-	using hex::location;
-	const location loc = hex::tile_in_direction(c.loc(),c.facing());
-	foreach(const const_battle_character_ptr& a, chars_) {
-		if(a->loc() == loc) {
-			if(hex::tile_in_direction(a->loc(),a->facing()) == c.loc()){
-				return a;
-			} else {
-				return const_battle_character_ptr();
-			}
-		}
-	}
-
-	return const_battle_character_ptr();
-}
-
 bool battle::listener::process_event(const SDL_Event& event, bool claimed) {
     if(claimed) {
         claimed |= handle_stats_dialogs(event, claimed);
@@ -1019,7 +867,7 @@ void battle::listener::handle_time_cost_popup()
             if(battle_->map_.is_loc_on_map(loc)) {
                 /* move cost */
                 battle_->time_cost_widget_->set_tracker(&(battle_->hex_tracker_));
-                const int cost = battle_->current_move_->get_stat("initiative",*attacker);
+                const int cost = battle_->current_move_->get_stat(STAT_INITIATIVE,*attacker);
                 battle_->initiative_bar_->focus_character(attacker.get(), cost);
 #if 0
                 battle_->time_cost_widget_->set_time_cost(cost);
@@ -18,6 +18,7 @@
 #include <vector>
 
 #include "battle_character.hpp"
+#include "battle_engine.hpp"
 #include "battle_menu_fwd.hpp"
 #include "battle_missile.hpp"
 #include "battle_move_fwd.hpp"
@@ -44,7 +45,7 @@ namespace game_logic
 
 class battle_modification;
 
-class battle
+class battle : public battle_engine
 {
 public:
     battle(const std::vector<battle_character_ptr>& chars,
@@ -52,35 +53,17 @@ public:
     
     void play();
     void player_turn(battle_character& c);
-    const hex::gamemap& map() const { return map_; }
     
     void elapse_time(GLfloat anim_elapse, int frames, bool in_anim = false);
     void move_character(battle_character& c, const battle_character::route& r);
     void attack_character(battle_character& attacker,
                           battle_character& defender,
                           const battle_move& move);
-    void target_mod(battle_character& ch,
-                    const hex::location& target,
-                    const battle_move& move);
-    bool can_make_move(const battle_character& c,
-                       const battle_move& move) const;
+    int attack_roll(battle_character& attacker,
+                    battle_character& defender,
+                    const attack_stats& stats);
     
-    const std::vector<battle_character_ptr>& participants() const { return chars_; }
-    
-    static int movement_duration();
-    
-    struct attack_stats {
-        int attack, defense, damage, damage_critical, time_taken, stamina_used;
-    };
-    
-    attack_stats get_attack_stats(const battle_character& attacker,
-                                  const battle_character& defender,
-                                  const battle_move& move,
-                                  std::string* description=NULL,
-                                  hex::location from_loc=hex::location()) const;
-    int current_time() const { return current_time_; }
     GLfloat animation_time() const { return sub_time_; }
-    const battle_character_ptr active_character() const { return *focus_; }
     
     hex::camera& camera() { return camera_; }
     const hex::camera& camera() const { return camera_; }
@@ -101,12 +84,22 @@ private:
     void begin_animation();
     void end_animation();
     void animation_frame(GLfloat t, gui::slider* slider=NULL);
-    const_battle_character_ptr is_engaged(
-                             const battle_character& c) const;
     void handle_dead_character(const battle_character& c);
-    std::vector<battle_character_ptr> chars_;
-    std::vector<battle_character_ptr>::iterator focus_;
-    const hex::gamemap& map_;
+
+    //shows the events the rules have recorded since last time. When
+    //animate_ is false they are only caught up with, which is how the
+    //turns of computer controlled characters are resolved in fast mode.
+    void play_events();
+    void animate_time(const event& e);
+    void animate_move(const event& e);
+    void animate_attack(const event& e);
+    void animate_damage(const event& e);
+    void animate_death(const event& e);
+    bool fast_resolve_;
+    bool animate_;
+
+    //characters who have died, but whose deaths haven't been shown yet.
+    std::vector<battle_character_ptr> dying_;
     
     void rebuild_visible_tiles();
     std::vector<const hex::tile*> tiles_;
@@ -123,9 +116,6 @@ private:
     hex::camera camera_;
     hex::camera_controller camera_controller_;
     
-    enum BATTLE_RESULT { ONGOING, PLAYER_WIN, PLAYER_LOSE, QUIT };
-    BATTLE_RESULT result_;
-    
     std::vector<gui::widget_ptr> widgets_;
     std::map<battle_character_ptr, game_dialogs::mini_stats_dialog_ptr> stats_dialogs_;
     
@@ -133,7 +123,6 @@ private:
     
     const_battle_move_ptr current_move_;
     int keyed_selection_;
-    int current_time_;
     GLfloat sub_time_;
     
     graphics::location_tracker hex_tracker_;
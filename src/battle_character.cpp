@@ -12,6 +12,7 @@
 */
 #include "battle.hpp"
 #include "battle_character.hpp"
+#include "battle_grid.hpp"
 #include "battle_character_npc.hpp"
 #include "battle_character_pc.hpp"
 #include "battle_move.hpp"
@@ -19,6 +20,7 @@
 #include "foreach.hpp"
 #include "graphics_logic.hpp"
 #include "model.hpp"
+#include "pathfind.hpp"
 #include "surface.hpp"
 #include "surface_cache.hpp"
 #include "tile.hpp"
@@ -34,7 +36,7 @@ battle_character::battle_character(
                        character_ptr ch, const party& p,
                        const hex::location& loc, hex::DIRECTION facing,
                        const hex::gamemap& map, const game_time& time)
-    : char_(ch), party_(p), loc_(loc),
+    : char_(ch), party_(&p), loc_(loc), grid_(NULL),
       facing_(facing), old_facing_(facing),
       move_at_(ch->initiative()), time_in_move_(-1.0), map_(map),
       highlight_(NULL),
@@ -48,6 +50,17 @@ battle_character::battle_character(
     assert(old_facing_ >= hex::NORTH && old_facing_ <= hex::NULL_DIRECTION);
 }
 
+battle_character::battle_character(
+                       character_ptr ch, const hex::location& loc,
+                       hex::DIRECTION facing, const hex::gamemap& map)
+    : char_(ch), party_(NULL), loc_(loc), grid_(NULL),
+      facing_(facing), old_facing_(facing),
+      move_at_(ch->initiative()), time_in_move_(-1.0), map_(map),
+      highlight_(NULL), time_of_day_adjustment_(0), energy_(0)
+{
+    assert(old_facing_ >= hex::NORTH && old_facing_ <= hex::NULL_DIRECTION);
+}
+
 battle_character::~battle_character()
 {
 }
@@ -174,23 +187,43 @@ hex::location battle_character::get_loc_during_move(int time) const
 	return move_[index];
 }
 
+//moves a character to tiles nobody is standing on.
+class battle_character::move_calculator : public hex::path_cost_calculator
+{
+public:
+	explicit move_calculator(const battle_character& c)
+	  : char_(c), grid_(*c.grid_)
+	{}
+
+	int movement_cost(const hex::location& a, const hex::location& b) const {
+		return char_.move_cost(a, b);
+	}
+
+	bool allowed_to_move(const hex::location& a) const {
+		return !grid_.at(a);
+	}
+
+private:
+	const battle_character& char_;
+	const battle_grid& grid_;
+};
+
 void battle_character::get_possible_moves(
     battle_character::move_map& moves,
 	const battle_move& move,
 	const std::vector<battle_character_ptr>& chars) const
 {
-	moves.clear();
-
-	route r;
-	r.push_back(loc_);
-	get_possible_moves_internal(moves, chars, r, move.max_moves());
+	assert(grid_);
+	const move_calculator calc(*this);
+	hex::find_reachable(loc_, map_.size(), calc, move.max_moves(),
+	                    battle::movement_duration(), moves);
 
 	battle_character::move_map::iterator i = moves.begin();
 	while(i != moves.end()) {
 		if(move.must_attack()) {
 			bool found = false;
 			foreach(const battle_character_ptr& c, chars) {
-				if(is_enemy(*c) && can_attack(*c, chars, i->first)) {
+				if(is_enemy(*c) && can_attack(*c, i->first)) {
 					found = true;
 					break;
 				}
@@ -210,43 +243,6 @@ void battle_character::get_possible_moves(
 	}
 }
 
-void battle_character::get_possible_moves_internal(battle_character::move_map& locs, const std::vector<battle_character_ptr>& chars, battle_character::route& r, int max_distance) const
-{
-	const int cost = route_cost(r);
-	if(cost > battle::movement_duration()) {
-		return;
-	}
-
-	move_map::iterator cur = locs.find(r.back());
-	if(cur != locs.end() && route_cost(cur->second) <= cost) {
-		return;
-	}
-
-	locs[r.back()] = r;
-
-	if(r.size() == max_distance+1) {
-		return;
-	}
-
-	hex::location adj[6];
-	get_adjacent_tiles(r.back(), adj);
-	for(int n = 0; n != 6; ++n) {
-		bool occupied = false;
-		foreach(const battle_character_ptr& c, chars) {
-			if(c->loc() == adj[n]) {
-				occupied = true;
-				break;
-			}
-		}
-		if(map_.is_loc_on_map(adj[n]) == false || occupied || distance_between(adj[n],r.front()) > max_distance) {
-			continue;
-		}
-		r.push_back(adj[n]);
-		get_possible_moves_internal(locs, chars, r, max_distance);
-		r.pop_back();
-	}
-}
-
 int battle_character::route_cost(const route& r) const
 {
 	int res = 0;
@@ -290,7 +286,7 @@ int battle_character::arrival_time(const hex::location& loc) const
 void battle_character::commit_move()
 {
 	assert(move_.empty() == false);
-	loc_ = move_.back();
+	set_loc(move_.back());
 	reset_movement_plan();
 }
 
@@ -300,9 +296,9 @@ bool battle_character::is_enemy(const battle_character& c) const
 }
 
 bool battle_character::can_attack(const battle_character& c,
-				  const std::vector<battle_character_ptr>& chars,
                                   hex::location loc, bool draw) const
 {
+    assert(grid_);
     if(!loc.valid()) {
         loc = loc_;
     }
@@ -314,11 +310,9 @@ bool battle_character::can_attack(const battle_character& c,
             return false;
         }
         foreach(const hex::location& l, line) {
-            foreach(const battle_character_ptr& d, chars) {
-                if(this == d.get() || &c == d.get()) continue;
-                if(l == d->loc()) {
-                    return false;
-                }
+            const battle_character_ptr& d = grid_->at(l);
+            if(d && this != d.get() && &c != d.get()) {
+                return false;
             }
         }
         
@@ -331,12 +325,11 @@ bool battle_character::can_attack(const battle_character& c,
                 return false;
             }
             
-            foreach(const battle_character_ptr& engager, chars) {
-                if(engager->loc() == target_facing && c.is_enemy(*engager) &&
-                   (engager->facing()%6) == c.facing()) {
-                    //they are engaged with someone else, so we can attack
-                    return true;
-                }
+            const battle_character_ptr& engager = grid_->at(target_facing);
+            if(engager && c.is_enemy(*engager) &&
+               (engager->facing()%6) == c.facing()) {
+                //they are engaged with someone else, so we can attack
+                return true;
             }
             
             //they'd be able to turn toward us and engage, so we can't attack
@@ -358,7 +351,7 @@ void battle_character::end_move()
 {
 	set_time_until_next_move(route_cost(move_));
 	time_in_move_ = -1.0;
-	loc_ = move_.back();
+	set_loc(move_.back());
 	if(move_.size() > 1) {
 		old_facing_ = facing_ = get_adjacent_direction(move_[move_.size()-2],move_.back());
 		assert(hex::is_valid_direction(facing_));
@@ -366,6 +359,26 @@ void battle_character::end_move()
 	move_.clear();
 }
 
+void battle_character::show_move(const route& move, GLfloat time)
+{
+	if(time < 0.0) {
+		move_.clear();
+	} else if(move_ != move) {
+		move_ = move;
+	}
+
+	time_in_move_ = time;
+}
+
+void battle_character::set_loc(const hex::location& loc)
+{
+	const hex::location from = loc_;
+	loc_ = loc;
+	if(grid_) {
+		grid_->move(*this, from);
+	}
+}
+
 void battle_character::begin_attack(const battle_character& enemy)
 {
 	old_facing_ = facing_ = get_main_direction(loc_, enemy.loc());
@@ -377,17 +390,17 @@ void battle_character::end_attack()
 
 int battle_character::attack() const
 {
-	return get_character().attack() + mod_stat("attack");
+	return get_character().attack() + mod_stat(STAT_ATTACK);
 }
 
 int battle_character::defense() const
 {
-	return get_character().defense() + mod_stat("defense");
+	return get_character().defense() + mod_stat(STAT_DEFENSE);
 }
 
 int battle_character::defense(const std::string& damage_type) const
 {
-	return get_character().defense(damage_type) + mod_stat("defense");
+	return get_character().defense(damage_type) + mod_stat(STAT_DEFENSE);
 }
 
 int battle_character::defense_behind() const
@@ -396,21 +409,22 @@ int battle_character::defense_behind() const
 }
 
 int battle_character::stat(const std::string& s) const
+{
+	return stat(find_stat(s));
+}
+
+int battle_character::stat(stat_id s) const
 {
 	return get_character().stat(s) + mod_stat(s);
 }
 
-int battle_character::mod_stat(const std::string& s) const
+int battle_character::mod_stat(stat_id s) const
 {
-	int res = 0;
-	typedef std::multimap<std::string,stat_mod>::const_iterator itor;
-	std::pair<itor,itor> range(mods_.equal_range(s));
-	while(range.first != range.second) {
-		res += range.first->second.mod;
-		++range.first;
+	if(s < 0 || s >= mod_totals_.size()) {
+		return 0;
 	}
 
-	return res;
+	return mod_totals_[s];
 }
 
 std::string battle_character::status_text() const
@@ -475,12 +489,9 @@ int battle_character::move_cost(const hex::location& a,
 		return -1;
 	}
 
-	const hex::tile& t1 = map_.get_tile(a);
-	const hex::tile& t2 = map_.get_tile(b);
+	const int height_diff = map_.height(b) - map_.height(a);
 
-	const int height_diff = t2.height() - t1.height();
-
-	return char_->move_cost(t2.terrain(),t2.feature(),height_diff);
+	return char_->move_cost(map_.terrain(b),map_.feature(b),height_diff);
 }
 
 int battle_character::adjust_damage(int damage) const
@@ -492,30 +503,38 @@ int battle_character::adjust_damage(int damage) const
 
 void battle_character::update_time(int time)
 {
-	std::multimap<std::string,stat_mod>::iterator i = mods_.begin();
+	std::vector<stat_mod>::iterator i = mods_.begin();
 	while(i != mods_.end()) {
-		if(time >= i->second.expire) {
-			mods_.erase(i++);
+		if(time >= i->expire) {
+			mod_totals_[i->stat] -= i->mod;
+			i = mods_.erase(i);
 		} else {
 			++i;
 		}
 	}
 }
 
-void battle_character::add_modification(const std::string& stat,
+void battle_character::add_modification(stat_id stat,
                                         int expire, int mod)
 {
-	if(stat == "energy") {
+	if(stat == STAT_ENERGY) {
 		energy_ += mod;
 		return;
-	} else if(stat == "move_at") {
+	} else if(stat == STAT_MOVE_AT) {
 		move_at_ += mod;
 		return;
 	}
 
-	std::multimap<std::string,stat_mod>::iterator i = mods_.insert(std::pair<std::string,stat_mod>(stat,stat_mod()));
-	i->second.expire = expire;
-	i->second.mod = mod;
+	stat_mod m;
+	m.stat = stat;
+	m.expire = expire;
+	m.mod = mod;
+	mods_.push_back(m);
+	if(stat >= mod_totals_.size()) {
+		mod_totals_.resize(stat + 1);
+	}
+
+	mod_totals_[stat] += mod;
 }
 
 }
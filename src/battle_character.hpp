@@ -26,12 +26,14 @@
 #include "map_avatar.hpp"
 #include "model.hpp"
 #include "party.hpp"
+#include "stat_id.hpp"
 #include "tile_logic.hpp"
 
 namespace game_logic
 {
 
-class battle;
+class battle_engine;
+class battle_grid;
 class game_time;
 
 class battle_character : public hex::basic_drawable
@@ -48,13 +50,13 @@ public:
                           const hex::gamemap& map, const game_time& time);
     
     character& get_character() const { return *char_; }
-    const party& get_party() const { return party_; }
+    const party& get_party() const { assert(party_); return *party_; }
     const hex::location& loc() const { return loc_; }
     hex::DIRECTION facing() const { return facing_; }
     
     void draw() const;
     
-    void play_turn(battle& b) { do_turn(b); }
+    void play_turn(battle_engine& b) { do_turn(b); }
     bool is_human_controlled() const { return is_human(); }
     
     typedef std::vector<hex::location> route;
@@ -83,7 +85,6 @@ public:
     
     bool is_enemy(const battle_character& c) const;
     bool can_attack(const battle_character& c,
-                    const std::vector<battle_character_ptr>& chars,
 	                hex::location loc=hex::location(),
                     bool draw=false) const;
     
@@ -99,6 +100,15 @@ public:
     void set_movement_time(GLfloat time) { time_in_move_ = time; }
     GLfloat get_movement_time() { return time_in_move_; }
     void end_move();
+
+    //shows the character part of the way through a move which has
+    //already been made, so that it can be animated afterwards. A time
+    //below zero stops showing the move.
+    void show_move(const route& move, GLfloat time);
+
+    //shows the character turning from the given facing to the one it
+    //has now, until end_facing_change() is called.
+    void show_facing_change(hex::DIRECTION from) { old_facing_ = from; }
     
     void begin_attack(const battle_character& enemy);
     bool set_attack_time(GLfloat time) { return time > 3.0 && time < 4.0; }
@@ -112,14 +122,25 @@ public:
     int defense(const std::string& damage_type) const;
     int defense_behind() const;
     int stat(const std::string& s) const;
+    int stat(stat_id s) const;
     int adjust_damage(int damage) const;
-    int mod_stat(const std::string& s) const;
+    int mod_stat(stat_id s) const;
     std::string status_text() const;
     
     void set_time_until_next_move(int amount) { move_at_ += amount; }
     
     void update_time(int cur_time);
-    void add_modification(const std::string& stat, int expire, int mod);
+    void add_modification(stat_id stat, int expire, int mod);
+
+    struct stat_mod {
+        stat_id stat;
+        int expire;
+        int mod;
+    };
+
+    const std::vector<stat_mod>& modifications() const {
+        return mods_;
+    }
     int route_cost(const route& r) const;
     
     int energy() const { return energy_; }
@@ -127,14 +148,22 @@ public:
     hex::const_map_avatar_ptr avatar() const { return avatar_; }
     void update_position(int key) const;
     void update_rotation(int key) const;
+protected:
+    //a character which only takes part in the rules of a battle, without
+    //a party, a place in the game's time, or anything to draw.
+    battle_character(character_ptr ch, const hex::location& loc,
+                     hex::DIRECTION facing, const hex::gamemap& map);
 private:
-    void get_possible_moves_internal(move_map& locs, const std::vector<battle_character_ptr>& chars, route& r, int max_distance) const;
+    class move_calculator;
+    friend class battle_grid;
 
-    virtual void do_turn(battle& b) = 0;
+    virtual void do_turn(battle_engine& b) = 0;
     
     character_ptr const char_;
-    const party& party_;
+    const party* party_;
     hex::location loc_;
+    void set_loc(const hex::location& loc);
+    battle_grid* grid_;
     hex::DIRECTION facing_;
     hex::DIRECTION old_facing_;
     int move_at_;
@@ -151,12 +180,10 @@ private:
     int energy_;
     hex::const_map_avatar_ptr avatar_;
     
-    struct stat_mod {
-        int expire;
-        int mod;
-    };
-    
-    std::multimap<std::string,stat_mod> mods_;
+    std::vector<stat_mod> mods_;
+
+    //the total of the modifications to each stat.
+    std::vector<int> mod_totals_;
 };
 
 }
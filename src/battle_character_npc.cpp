@@ -12,12 +12,16 @@
 */
 #include <assert.h>
 #include <iostream>
+#include <map>
 
-#include "battle.hpp"
+#include "battle_engine.hpp"
 #include "battle_character_npc.hpp"
 #include "battle_move.hpp"
+#include "battle_search.hpp"
 #include "character.hpp"
 #include "foreach.hpp"
+#include "preferences.hpp"
+#include "threading.hpp"
 
 namespace game_logic
 {
@@ -35,7 +39,7 @@ bool battle_character_npc::is_human() const
 }
 
 namespace {
-int rate_attack_stats(const battle::attack_stats& stats) {
+int rate_attack_stats(const battle_engine::attack_stats& stats) {
 	if(stats.attack + stats.defense > 0) {
 		return ((stats.attack*100)/(stats.attack+stats.defense)) * stats.damage;
 	} else {
@@ -44,53 +48,181 @@ int rate_attack_stats(const battle::attack_stats& stats) {
 }
 }
 
-void battle_character_npc::do_turn(battle& b)
+namespace {
+//an attack the character could make: using one of its moves, from one
+//of the destinations that move reaches, on one of the participants.
+struct attack_option {
+	int move;
+	hex::location dst;
+	const battle_character::route* route;
+	int target;
+	bool possible;
+};
+
+//the stats of an attack only depend on the move, the target, the
+//difference in height between the attacker and target, and whether
+//the target is attacked from behind.
+struct attack_stats_key {
+	attack_stats_key(int m, int t, int h, bool b)
+	  : move(m), target(t), height_diff(h), behind(b)
+	{}
+	int move, target, height_diff;
+	bool behind;
+
+	bool operator<(const attack_stats_key& k) const {
+		if(move != k.move) {
+			return move < k.move;
+		} else if(target != k.target) {
+			return target < k.target;
+		} else if(height_diff != k.height_diff) {
+			return height_diff < k.height_diff;
+		} else {
+			return behind < k.behind;
+		}
+	}
+};
+
+struct attack_check {
+	const battle_character* attacker;
+	const std::vector<battle_character_ptr>* targets;
+	std::vector<attack_option>* options;
+};
+
+//finds whether one attack option is possible. Only reads the battle,
+//so options can be checked on several threads at once.
+void check_attack_option(void* data, int n)
 {
-	const std::vector<const_battle_move_ptr>& moves = get_character().battle_moves();
-	const_battle_move_ptr best_move;
-	hex::location best_dst;
-	battle_character_ptr best_target;
-	route best_route;
-	int best_rating = -1;
-	foreach(const const_battle_move_ptr& m, moves) {
-		if(m->can_attack() == false) {
+	const attack_check& check = *static_cast<attack_check*>(data);
+	attack_option& option = (*check.options)[n];
+	option.possible = check.attacker->can_attack(
+	                     *(*check.targets)[option.target], option.dst);
+}
+
+//chooses between the possible attack options by looking ahead, or
+//returns NULL if there wasn't time to look.
+const attack_option* search_attack_options(const battle_character& c,
+                            const battle_engine& b,
+                            const std::vector<attack_option>& options,
+                            bool log_think_time)
+{
+	battle_search search(b, c);
+	std::vector<const attack_option*> candidates;
+	foreach(const attack_option& option, options) {
+		if(option.possible && search.add_candidate(option.dst,
+		                 *option.route, option.target, option.move)) {
+			candidates.push_back(&option);
+		}
+	}
+
+	const int choice = search.search(b.ai_think_time(), b.ai_threads());
+	if(log_think_time) {
+		std::cerr << "npc search: " << candidates.size()
+		          << " candidates, " << search.depth() << " turns ahead, "
+		          << search.nodes() << " positions\n";
+	}
+
+	return choice == -1 ? NULL : candidates[choice];
+}
+}
+
+void battle_character_npc::do_turn(battle_engine& b)
+{
+	play_ai_turn(*this, b, preference_log_ai_think_time());
+}
+
+void play_ai_turn(battle_character& c, battle_engine& b, bool log_think_time)
+{
+	const Uint32 start_time = SDL_GetTicks();
+	const std::vector<const_battle_move_ptr>& moves = c.get_character().battle_moves();
+	const std::vector<battle_character_ptr>& chars = b.participants();
+
+	//collect every attack which might be made, in the order they are
+	//to be considered, so that the best one is chosen the same way
+	//however the checks are shared out between threads.
+	std::vector<battle_character::move_map> movements(moves.size());
+	std::vector<attack_option> options;
+	for(int m = 0; m != moves.size(); ++m) {
+		if(moves[m]->can_attack() == false) {
 			continue;
 		}
 
-		move_map movements;
-		if(m->max_moves() > 0) {
-			get_possible_moves(movements,*m,b.participants());
+		if(moves[m]->max_moves() > 0) {
+			c.get_possible_moves(movements[m],*moves[m],chars);
 		} else {
-			movements[loc()] = route();
+			movements[m][c.loc()] = battle_character::route();
 		}
 
-		typedef std::pair<hex::location,route> move_pair;
-		foreach(const move_pair& movement, movements) {
-			const hex::location& dst = movement.first;
-			foreach(const battle_character_ptr& c, b.participants()) {
-				if(!is_enemy(*c) || !can_attack(*c,b.participants(),dst)) {
+		for(battle_character::move_map::const_iterator i = movements[m].begin();
+		    i != movements[m].end(); ++i) {
+			for(int t = 0; t != chars.size(); ++t) {
+				if(!c.is_enemy(*chars[t])) {
 					continue;
 				}
 
-				const int rating = rate_attack_stats(
-				          b.get_attack_stats(*this,*c,*m,NULL,dst));
-				if(best_rating == -1 || rating > best_rating) {
-					best_move = m;
-					best_dst = dst;
-					best_target = c;
-					best_rating = rating;
-					best_route = movement.second;
-				}
+				attack_option option;
+				option.move = m;
+				option.dst = i->first;
+				option.route = &i->second;
+				option.target = t;
+				option.possible = false;
+				options.push_back(option);
 			}
 		}
 	}
 
-	if(best_target) {
-		if(best_dst.valid() && best_dst != loc()) {
-			b.move_character(*this,best_route);
+	attack_check check;
+	check.attacker = &c;
+	check.targets = &chars;
+	check.options = &options;
+	b.grid().suspend_counting();
+	threading::parallel_for(options.size(), check_attack_option, &check,
+	                        b.ai_threads());
+	b.grid().resume_counting();
+
+	const attack_option* best = NULL;
+	if(b.ai_think_time() > 0) {
+		best = search_attack_options(c, b, options, log_think_time);
+	}
+
+	std::map<attack_stats_key,int> ratings;
+	if(!best) {
+		int best_rating = -1;
+		foreach(const attack_option& option, options) {
+			if(!option.possible) {
+				continue;
+			}
+
+			const battle_character& target = *chars[option.target];
+			const attack_stats_key key(option.move, option.target,
+			      b.map().height(option.dst) - b.map().height(target.loc()),
+			      b.attacked_from_behind(target, option.dst));
+			std::map<attack_stats_key,int>::const_iterator r = ratings.find(key);
+			if(r == ratings.end()) {
+				r = ratings.insert(std::make_pair(key, rate_attack_stats(
+				      b.get_attack_stats(c,target,*moves[option.move],
+				                         NULL,option.dst)))).first;
+			}
+
+			if(best_rating == -1 || r->second > best_rating) {
+				best = &option;
+				best_rating = r->second;
+			}
+		}
+	}
+
+	if(log_think_time) {
+		std::cerr << "npc think time: " << (SDL_GetTicks() - start_time)
+		          << "ms for " << options.size() << " attack options, "
+		          << ratings.size() << " attack stats calculated\n";
+	}
+
+	if(best) {
+		const battle_character_ptr target = chars[best->target];
+		if(best->dst.valid() && best->dst != c.loc()) {
+			b.move_character(c,*best->route);
 		}
 
-		b.attack_character(*this,*best_target,*best_move);
+		b.attack_character(c,*target,*moves[best->move]);
 		return;
 	}
 
@@ -101,24 +233,24 @@ void battle_character_npc::do_turn(battle& b)
 
 		battle_character_ptr target;
 		int closest = -1;
-		foreach(const battle_character_ptr& c, b.participants()) {
-			if(!is_enemy(*c)) {
+		foreach(const battle_character_ptr& enemy, b.participants()) {
+			if(!c.is_enemy(*enemy)) {
 				continue;
 			}
 
-			if(closest == -1 || distance_between(loc(),c->loc()) < closest) {
-				closest = distance_between(loc(),c->loc());
-				target = c;
+			if(closest == -1 || distance_between(c.loc(),enemy->loc()) < closest) {
+				closest = distance_between(c.loc(),enemy->loc());
+				target = enemy;
 			}
 		}
 
 		assert(target);
 
 		closest = -1;
-		move_map movements;
-		route best_move;
-		get_possible_moves(movements,*m,b.participants());
-		typedef std::pair<hex::location,route> move_pair;
+		battle_character::move_map movements;
+		battle_character::route best_move;
+		c.get_possible_moves(movements,*m,b.participants());
+		typedef std::pair<hex::location,battle_character::route> move_pair;
 		foreach(const move_pair& movement, movements) {
 			const hex::location& dst = movement.first;
 			if(closest == -1 || distance_between(dst,target->loc()) < closest) {
@@ -127,13 +259,13 @@ void battle_character_npc::do_turn(battle& b)
 			}
 		}
 
-		if(closest < distance_between(loc(),target->loc())) {
-			b.move_character(*this, best_move);
+		if(closest < distance_between(c.loc(),target->loc())) {
+			b.move_character(c, best_move);
 			return;
 		}
 	}
 
-	set_time_until_next_move(1);
+	c.set_time_until_next_move(1);
 }
 
 }
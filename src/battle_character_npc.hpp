@@ -27,9 +27,15 @@ public:
 
 private:
 	bool is_human() const;
-	void do_turn(battle& b);
+	void do_turn(battle_engine& b);
 };
 
+//chooses and makes a move for a character, the way characters which
+//aren't controlled by the player do, optionally logging how long it
+//took to choose.
+void play_ai_turn(battle_character& c, battle_engine& b,
+                  bool log_think_time=false);
+
 }
 
 #endif
@@ -11,7 +11,7 @@
    See the COPYING file for more details.
 */
 #include "battle_character_pc.hpp"
-#include "battle.hpp"
+#include "battle_engine.hpp"
 #include "character.hpp"
 
 namespace game_logic
@@ -30,7 +30,7 @@ bool battle_character_pc::is_human() const
 	return true;
 }
 
-void battle_character_pc::do_turn(battle& b)
+void battle_character_pc::do_turn(battle_engine& b)
 {
 	b.player_turn(*this);
 }
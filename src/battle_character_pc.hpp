@@ -26,7 +26,7 @@ public:
 					    const hex::gamemap& map, const game_time& time);
 
 private:
-	void do_turn(battle& b);
+	void do_turn(battle_engine& b);
 	bool is_human() const;
 };
 
@@ -0,0 +1,36 @@
+/*
+   Copyright (C) 2007 by David White <dave.net>
+   Part of the Silver Tree Project
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 2 or later.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY.
+
+   See the COPYING file for more details.
+*/
+#include "battle_character_npc.hpp"
+#include "battle_character_sim.hpp"
+#include "character.hpp"
+
+namespace game_logic
+{
+
+battle_character_sim::battle_character_sim(character_ptr ch, bool player_side,
+                 const hex::location& loc, hex::DIRECTION facing,
+                 const hex::gamemap& map)
+  : battle_character(ch,loc,facing,map), player_side_(player_side)
+{
+}
+
+bool battle_character_sim::is_human() const
+{
+	return player_side_;
+}
+
+void battle_character_sim::do_turn(battle_engine& b)
+{
+	play_ai_turn(*this, b);
+}
+
+}
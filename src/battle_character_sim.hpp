@@ -0,0 +1,39 @@
+/*
+   Copyright (C) 2007 by David White <dave.net>
+   Part of the Silver Tree Project
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 2 or later.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY.
+
+   See the COPYING file for more details.
+*/
+#ifndef BATTLE_CHARACTER_SIM_INCLUDED
+#define BATTLE_CHARACTER_SIM_INCLUDED
+
+#include "battle_character.hpp"
+
+namespace game_logic
+{
+
+//a character in a simulated battle. Characters on both sides choose
+//their moves the way non-player characters do; the player's side is
+//only used to tell friends from enemies.
+class battle_character_sim : public battle_character
+{
+public:
+	battle_character_sim(character_ptr ch, bool player_side,
+	                     const hex::location& loc, hex::DIRECTION facing,
+	                     const hex::gamemap& map);
+
+private:
+	bool is_human() const;
+	void do_turn(battle_engine& b);
+
+	bool player_side_;
+};
+
+}
+
+#endif
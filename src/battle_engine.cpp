@@ -0,0 +1,468 @@
+/*
+   Copyright (C) 2007 by David White <dave.net>
+   Part of the Silver Tree Project
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 2 or later.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY.
+
+   See the COPYING file for more details.
+*/
+#include "battle_character_npc.hpp"
+#include "battle_engine.hpp"
+#include "battle_modification.hpp"
+#include "battle_move.hpp"
+#include "character.hpp"
+#include "foreach.hpp"
+#include "formatter.hpp"
+#include "preferences.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+
+namespace game_logic
+{
+
+namespace {
+
+bool battle_char_less(const const_battle_character_ptr& c1,
+                      const const_battle_character_ptr& c2)
+{
+	return c1->ready_to_move_at() < c2->ready_to_move_at();
+}
+
+}
+
+battle_engine::battle_engine(const std::vector<battle_character_ptr>& chars,
+                             const hex::gamemap& battle_map,
+                             unsigned int seed)
+  : chars_(chars), focus_(chars_.end()), map_(battle_map),
+    grid_(battle_map.size()), result_(ONGOING), current_time_(0),
+    turns_played_(0), ai_threads_(preference_ai_threads()),
+    ai_think_time_(preference_ai_think_time()), rng_(seed),
+    record_events_(false)
+{
+	foreach(const battle_character_ptr& c, chars_) {
+		grid_.add(c);
+	}
+}
+
+battle_engine::~battle_engine()
+{
+}
+
+void battle_engine::simulate(int max_time)
+{
+	while(result_ == ONGOING) {
+		begin_turn();
+		while(!focus_ready()) {
+			if(current_time_ >= max_time) {
+				return;
+			}
+
+			advance_time();
+		}
+
+		play_turn();
+	}
+}
+
+void battle_engine::player_turn(battle_character& c)
+{
+	play_ai_turn(c, *this);
+}
+
+void battle_engine::begin_turn()
+{
+	std::sort(chars_.begin(),chars_.end(),battle_char_less);
+	focus_ = chars_.begin();
+}
+
+bool battle_engine::focus_ready() const
+{
+	return current_time_ >= (*focus_)->ready_to_move_at();
+}
+
+void battle_engine::advance_time()
+{
+	// Check whether character modifications expired.
+	foreach(battle_character_ptr ch, chars_) {
+		ch->update_time(current_time_);
+	}
+
+	if(record_events_) {
+		post_event(event(event::TIME_PASSED, current_time_));
+	}
+
+	++current_time_;
+}
+
+void battle_engine::play_turn()
+{
+	++turns_played_;
+	(*focus_)->play_turn(*this);
+}
+
+void battle_engine::move_character(battle_character& c,
+                                   const battle_character::route& r)
+{
+	c.begin_move(r);
+	c.end_move();
+	if(record_events_) {
+		event e(event::MOVE, current_time_);
+		e.actor = participant(c);
+		e.route = r;
+		post_event(e);
+	}
+}
+
+void battle_engine::attack_character(battle_character& attacker,
+                                     battle_character& defender,
+                                     const battle_move& attack_move)
+{
+	const attack_stats stats = get_attack_stats(attacker,defender,attack_move);
+	const hex::DIRECTION target_facing = defender.facing();
+	begin_attack(attacker, defender, stats);
+	attacker.begin_attack(defender);
+	const int roll = attack_roll(attacker, defender, stats);
+	const int damage = attack_damage(stats, roll);
+
+	//the attack is posted before the damage is dealt, so that it comes
+	//before the defender's death.
+	if(record_events_) {
+		event e(event::ATTACK, current_time_);
+		e.actor = participant(attacker);
+		e.target = participant(defender);
+		e.stats = stats;
+		e.target_facing = target_facing;
+		e.roll = roll;
+		e.damage = damage;
+		post_event(e);
+	}
+
+	end_attack(attacker, defender, attack_move, stats, damage);
+}
+
+int battle_engine::attack_roll(battle_character& attacker,
+                               battle_character& defender,
+                               const attack_stats& stats)
+{
+	return roll_attack();
+}
+
+void battle_engine::begin_attack(battle_character& attacker,
+                                 battle_character& defender,
+                                 const attack_stats& stats)
+{
+	const_battle_character_ptr engaged_with = is_engaged(defender);
+	const bool otherwise_engaged = engaged_with &&
+	                 engaged_with->loc() != attacker.loc();
+
+	attacker.get_character().use_stamina(stats.stamina_used);
+	attacker.begin_facing_change(
+	  hex::get_main_direction(attacker.loc(),defender.loc()));
+
+	if(!otherwise_engaged) {
+		defender.begin_facing_change(
+		  hex::get_main_direction(defender.loc(),attacker.loc()));
+	}
+}
+
+int battle_engine::attack_damage(const attack_stats& stats, int roll) const
+{
+	if(roll <= stats.defense) {
+		return 0;
+	} else if(roll >= stats.defense*2) {
+		return stats.damage_critical;
+	} else {
+		return stats.damage;
+	}
+}
+
+void battle_engine::end_attack(battle_character& attacker,
+                               battle_character& defender,
+                               const battle_move& attack_move,
+                               const attack_stats& stats, int damage)
+{
+	attacker.end_attack();
+	attacker.end_facing_change();
+	defender.end_facing_change();
+
+	attacker.set_time_until_next_move(stats.time_taken);
+	(*focus_)->use_energy(attack_move.energy_required());
+
+	defender.get_character().take_damage(damage);
+	handle_dead_character(defender);
+}
+
+void battle_engine::show_damage(const battle_character& c, int damage)
+{
+	if(record_events_) {
+		event e(event::DAMAGE, current_time_);
+		e.actor = participant(c);
+		e.damage = damage;
+		post_event(e);
+	}
+}
+
+battle_engine::event battle_engine::next_event()
+{
+	assert(!events_.empty());
+	const event e = events_.front();
+	events_.pop_front();
+	return e;
+}
+
+battle_character_ptr battle_engine::participant(
+                                const battle_character& c) const
+{
+	foreach(const battle_character_ptr& ch, chars_) {
+		if(ch.get() == &c) {
+			return ch;
+		}
+	}
+
+	return battle_character_ptr();
+}
+
+void battle_engine::handle_dead_character(const battle_character& c)
+{
+	if(!c.get_character().dead()) {
+		return;
+	}
+
+	for(std::vector<battle_character_ptr>::iterator i = chars_.begin();
+	    i != chars_.end(); ++i) {
+		if(i->get() == &c) {
+			if(record_events_) {
+				event e(event::DEATH, current_time_);
+				e.actor = *i;
+				post_event(e);
+			}
+
+			grid_.remove(**i);
+			chars_.erase(i);
+			break;
+		}
+	}
+	bool found_player = false;
+	bool found_enemy = false;
+	foreach(const battle_character_ptr& ch, chars_) {
+		if(ch->is_human()) {
+			found_player = true;
+		} else {
+			found_enemy = true;
+		}
+	}
+
+	if(found_player && !found_enemy) {
+		result_ = PLAYER_WIN;
+	} else if(found_enemy && !found_player) {
+		result_ = PLAYER_LOSE;
+	}
+}
+
+int battle_engine::movement_duration()
+{
+	return 10;
+}
+
+battle_engine::attack_stats battle_engine::get_attack_stats(
+     const battle_character& attacker,
+	 const battle_character& defender,
+	 const battle_move& move,
+	 std::string* description,
+	 hex::location from_loc) const
+{
+	if(!from_loc.valid()) {
+		from_loc = attacker.loc();
+	}
+
+	const bool behind = attacked_from_behind(defender, from_loc);
+	const attack_stats stats = attack_stats_from(attacker, defender, move,
+	                                   from_loc, defender.loc(), behind);
+
+	if(description) {
+		const int chance_to_hit = std::min<int>(100, std::max<int>(0, stats.attack - stats.defense));
+		*description += formatter() << "Attack: " <<
+		                stats.attack << "\nDefense: " <<
+						stats.defense <<
+						(behind ? " (from behind!)" : "") << "\nChance to hit: " << chance_to_hit <<
+						"%\nDamage: " << stats.damage <<
+						"\nTime: " << stats.time_taken << "s";
+		if(stats.attack > stats.defense &&
+		   stats.damage_critical != stats.damage) {
+			const int chance_to_critical = std::min<int>(100, std::max<int>(0, stats.attack/2 - stats.defense));
+			*description += formatter() << "Chance to critical: " <<
+			                chance_to_critical <<
+							"%\nCritical damage: " <<
+							stats.damage_critical;
+		}
+
+	}
+
+	return stats;
+}
+
+battle_engine::attack_stats battle_engine::attack_stats_from(
+     const battle_character& attacker,
+	 const battle_character& defender,
+	 const battle_move& move,
+	 const hex::location& from_loc,
+	 const hex::location& target_loc,
+	 bool behind) const
+{
+	const int height_diff = map_.height(from_loc) -
+	                        map_.height(target_loc);
+	//std::cerr << "height diff: " << height_diff << "\n";
+	const character& ch = attacker.get_character();
+	attack_stats stats;
+	stats.attack = std::max<int>(ch.stat_mod_height(STAT_ATTACK,height_diff) +
+	    move.get_stat(STAT_ATTACK,attacker), 1);
+	stats.defense = std::max<int>(defender.defense(
+	                  attacker.get_character().damage_type()), 0);
+	stats.damage = std::max<int>(ch.stat_mod_height(STAT_DAMAGE,height_diff/2) +
+	                  attacker.adjust_damage(move.get_stat(STAT_DAMAGE,attacker)), 1);
+	stats.damage_critical = stats.damage;
+	stats.time_taken = ch.stat_mod_height(STAT_INITIATIVE,height_diff) +
+	                       move.get_stat(STAT_INITIATIVE,attacker);
+	stats.stamina_used = ch.stat_mod_height(STAT_STAMINA_USED,height_diff) +
+	                       move.get_stat(STAT_STAMINA_USED,attacker);
+	int resist_amount, resist_percent;
+	defender.get_character().get_resistance(
+	                        attacker.get_character().damage_type(),
+	                        &resist_amount, &resist_percent);
+	stats.damage -=
+	    (std::min(resist_amount,stats.damage)*resist_percent)/100;
+
+	if(behind) {
+		stats.defense = defender.defense_behind();
+	}
+
+	return stats;
+}
+
+void battle_engine::target_mod(battle_character& caster,
+                        const hex::location& target,
+                        const battle_move& move)
+{
+    const int time_to_perform = move.get_stat(STAT_INITIATIVE,caster);
+#if 0
+    // FIXME: move particle emitter to renderer usw
+
+    if(graphics::particle_emitter_ptr missile = move.create_missile_emitter()) {
+        using hex::tile;
+        const hex::location& src = caster.loc();
+        assert(map_.is_loc_on_map(src));
+        assert(map_.is_loc_on_map(target));
+        const hex::tile& src_tile = map_.get_tile(src);
+        const hex::tile& dst_tile = map_.get_tile(target);
+        GLfloat src_pos[] = {tile::translate_x(src), tile::translate_y(src), tile::translate_height(src_tile.height())};
+        GLfloat dst_pos[] = {tile::translate_x(target), tile::translate_y(target), tile::translate_height(dst_tile.height())};
+        
+        const GLfloat nframes = 100.0;
+        
+        begin_animation();
+        for(GLfloat frame = 0.0; frame <= nframes; frame += 1.0) {
+            GLfloat pos[3];
+            for(int n = 0; n != 3; ++n) {
+                pos[n] = dst_pos[n]*(frame/nframes) + src_pos[n]*((nframes-frame)/nframes);
+            }
+            
+            missile->set_pos(pos);
+            missile->emit_particle(particle_system_);
+            animation_frame(time_to_perform/static_cast<GLfloat>(nframes));
+        }
+        end_animation();
+    }
+#endif
+
+    assert(move.mod());
+    const battle_modification& mod = *move.mod();
+    caster.set_time_until_next_move(time_to_perform);
+    caster.use_energy(move.energy_required());
+    const battle_modification::TARGET_TYPE type = mod.target();
+    const int radius = mod.radius();
+    std::vector<hex::location> locs;
+    std::vector<battle_character_ptr> affected_chars;
+    get_locations_in_radius(target, radius, locs);
+    foreach(battle_character_ptr ch, chars_) {
+        if(std::find(locs.begin(),locs.end(),ch->loc()) == locs.end()) {
+            continue;
+        }
+        
+        if(type == battle_modification::TARGET_ENEMY &&
+           !caster.is_enemy(*ch)) {
+            continue;
+        }
+        
+        if(type == battle_modification::TARGET_FRIEND &&
+           caster.is_enemy(*ch)) {
+            continue;
+        }
+        affected_chars.push_back(ch);
+    }
+    foreach(battle_character_ptr ch, affected_chars) {
+        std::vector<int> damage;
+        mod.apply(caster, *ch, current_time_, &damage);
+        foreach(int amount, damage) {
+            show_damage(*ch, amount);
+        }
+        handle_dead_character(*ch);
+    }
+    
+}
+
+bool battle_engine::can_make_move(const battle_character& c,
+                           const battle_move& move) const
+{
+	if(move.energy_required() > c.energy()) {
+		std::cerr << "CANNOT MAKE MOVE: " << move.energy_required() << " > " << c.energy() << "\n";
+		return false;
+	}
+
+	if(move.max_moves() > 0) {
+		battle_character::move_map moves;
+		c.get_possible_moves(moves, move, chars_);
+		return !moves.empty();
+	} else if(move.must_attack()) {
+		foreach(const battle_character_ptr& enemy, chars_) {
+			if(c.is_enemy(*enemy) && c.can_attack(*enemy)) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	return true;
+}
+
+bool battle_engine::attacked_from_behind(const battle_character& defender,
+                                  const hex::location& from_loc) const
+{
+	if(!is_engaged(defender)) {
+		return false;
+	}
+
+	switch(abs(hex::get_adjacent_direction(defender.loc(),
+	                 from_loc) - defender.facing())) {
+	case 2:
+	case 3:
+	case 4:
+		return true;
+	default:
+		return false;
+	}
+}
+
+const_battle_character_ptr battle_engine::is_engaged(
+      const battle_character& c) const
+{
+	return grid_.engaged_with(c);
+}
+
+}
@@ -0,0 +1,186 @@
+/*
+   Copyright (C) 2007 by David White <dave.net>
+   Part of the Silver Tree Project
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 2 or later.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY.
+
+   See the COPYING file for more details.
+*/
+#ifndef BATTLE_ENGINE_HPP_INCLUDED
+#define BATTLE_ENGINE_HPP_INCLUDED
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "battle_character.hpp"
+#include "battle_grid.hpp"
+#include "battle_move_fwd.hpp"
+#include "gamemap.hpp"
+#include "rng.hpp"
+
+namespace game_logic
+{
+
+//the rules of a battle: whose turn it is, what happens when characters
+//move and attack, and who wins. Nothing is drawn and no input is read,
+//so a battle can be played out on its own with simulate(), while the
+//battle class puts the battle on screen on top of these rules.
+class battle_engine
+{
+public:
+	battle_engine(const std::vector<battle_character_ptr>& chars,
+	              const hex::gamemap& battle_map, unsigned int seed);
+	virtual ~battle_engine();
+
+	enum BATTLE_RESULT { ONGOING, PLAYER_WIN, PLAYER_LOSE, QUIT };
+	BATTLE_RESULT result() const { return result_; }
+
+	//plays turns until one side has won, or until the battle has gone on
+	//for max_time, in which case the result is still ONGOING.
+	void simulate(int max_time);
+
+	//called to play the turn of a human controlled character. When there
+	//is nobody to ask, the character plays like any other.
+	virtual void player_turn(battle_character& c);
+
+	virtual void move_character(battle_character& c,
+	                            const battle_character::route& r);
+	virtual void attack_character(battle_character& attacker,
+	                              battle_character& defender,
+	                              const battle_move& move);
+	void target_mod(battle_character& ch,
+	                const hex::location& target,
+	                const battle_move& move);
+	bool can_make_move(const battle_character& c,
+	                   const battle_move& move) const;
+
+	const hex::gamemap& map() const { return map_; }
+	const std::vector<battle_character_ptr>& participants() const { return chars_; }
+	const battle_grid& grid() const { return grid_; }
+	battle_grid& grid() { return grid_; }
+
+	static int movement_duration();
+
+	struct attack_stats {
+		int attack, defense, damage, damage_critical, time_taken, stamina_used;
+	};
+
+	//something which has happened in the battle. The rules play each
+	//move out at once and record what happened as events, so that they
+	//can be shown afterwards at whatever pace suits, or not at all.
+	struct event {
+		enum TYPE { TIME_PASSED, MOVE, ATTACK, DAMAGE, DEATH };
+		event(TYPE t, int tm) : type(t), time(tm),
+		            target_facing(hex::NULL_DIRECTION), roll(0), damage(0)
+		{}
+		TYPE type;
+		int time;
+		battle_character_ptr actor, target;
+
+		//the route of a move.
+		battle_character::route route;
+
+		//an attack, with the way the target faced before it, what was
+		//rolled and the damage dealt. DAMAGE events also have damage.
+		attack_stats stats;
+		hex::DIRECTION target_facing;
+		int roll, damage;
+	};
+
+	//events are only recorded when something will take them, since
+	//otherwise they would pile up.
+	void record_events(bool value) { record_events_ = value; }
+	bool has_events() const { return !events_.empty(); }
+	event next_event();
+
+	attack_stats get_attack_stats(const battle_character& attacker,
+	                              const battle_character& defender,
+	                              const battle_move& move,
+	                              std::string* description=NULL,
+	                              hex::location from_loc=hex::location()) const;
+
+	//the stats of an attack made from from_loc on a defender standing
+	//at target_loc, which needn't be where either of them is now.
+	attack_stats attack_stats_from(const battle_character& attacker,
+	                               const battle_character& defender,
+	                               const battle_move& move,
+	                               const hex::location& from_loc,
+	                               const hex::location& target_loc,
+	                               bool behind) const;
+	bool attacked_from_behind(const battle_character& defender,
+	                          const hex::location& from_loc) const;
+	int current_time() const { return current_time_; }
+	int turns_played() const { return turns_played_; }
+
+	//the number of threads characters use to evaluate their moves.
+	int ai_threads() const { return ai_threads_; }
+	void set_ai_threads(int n) { ai_threads_ = n; }
+
+	//how many milliseconds characters may spend looking ahead to
+	//choose their moves, or 0 to choose greedily.
+	int ai_think_time() const { return ai_think_time_; }
+	void set_ai_think_time(int ms) { ai_think_time_ = ms; }
+	const battle_character_ptr active_character() const { return *focus_; }
+
+protected:
+	//puts the character who moves next in focus.
+	void begin_turn();
+
+	//whether the character in focus is ready to move yet.
+	bool focus_ready() const;
+
+	//moves the battle on by one unit of time.
+	void advance_time();
+
+	void play_turn();
+
+	const_battle_character_ptr is_engaged(const battle_character& c) const;
+
+	//the parts of an attack, so that they can be shown as they happen:
+	//the characters turn to face each other, the attack is rolled with a
+	//number from 0 to 99, and the damage is dealt.
+	void begin_attack(battle_character& attacker,
+	                  battle_character& defender,
+	                  const attack_stats& stats);
+	int roll_attack() { return rng_(100); }
+
+	//the roll for an attack once the characters are facing each other.
+	virtual int attack_roll(battle_character& attacker,
+	                        battle_character& defender,
+	                        const attack_stats& stats);
+	int attack_damage(const attack_stats& stats, int roll) const;
+	void end_attack(battle_character& attacker,
+	                battle_character& defender,
+	                const battle_move& move,
+	                const attack_stats& stats, int damage);
+
+	//called when a modification inflicts damage on a character, for the
+	//damage to be shown.
+	void show_damage(const battle_character& c, int damage);
+
+	virtual void handle_dead_character(const battle_character& c);
+
+	void post_event(const event& e) { events_.push_back(e); }
+	battle_character_ptr participant(const battle_character& c) const;
+
+	std::vector<battle_character_ptr> chars_;
+	std::vector<battle_character_ptr>::iterator focus_;
+	const hex::gamemap& map_;
+	battle_grid grid_;
+	BATTLE_RESULT result_;
+	int current_time_;
+	int turns_played_;
+	int ai_threads_;
+	int ai_think_time_;
+	rng rng_;
+	bool record_events_;
+	std::deque<event> events_;
+};
+
+}
+
+#endif
@@ -0,0 +1,94 @@
+/*
+   Copyright (C) 2007 by David White <dave.net>
+   Part of the Silver Tree Project
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 2 or later.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY.
+
+   See the COPYING file for more details.
+*/
+#include "battle_character.hpp"
+#include "battle_grid.hpp"
+#include "foreach.hpp"
+
+namespace game_logic
+{
+
+battle_grid::battle_grid(const hex::location& dim)
+  : dim_(dim), occupants_(dim.x()*dim.y()), lookups_(0),
+    counting_(true)
+{
+}
+
+battle_grid::~battle_grid()
+{
+	foreach(const battle_character_ptr& c, occupants_) {
+		if(c && c->grid_ == this) {
+			c->grid_ = NULL;
+		}
+	}
+}
+
+void battle_grid::add(const battle_character_ptr& c)
+{
+	c->grid_ = this;
+	if(is_loc_on_grid(c->loc())) {
+		occupants_[index(c->loc())] = c;
+	}
+}
+
+void battle_grid::remove(battle_character& c)
+{
+	if(c.grid_ != this) {
+		return;
+	}
+
+	c.grid_ = NULL;
+	if(is_loc_on_grid(c.loc()) && occupants_[index(c.loc())].get() == &c) {
+		occupants_[index(c.loc())].reset();
+	}
+}
+
+void battle_grid::move(const battle_character& c, const hex::location& from)
+{
+	if(from == c.loc() || !is_loc_on_grid(from) ||
+	   occupants_[index(from)].get() != &c) {
+		return;
+	}
+
+	battle_character_ptr ptr;
+	ptr.swap(occupants_[index(from)]);
+	if(is_loc_on_grid(c.loc())) {
+		occupants_[index(c.loc())] = ptr;
+	}
+}
+
+const battle_character_ptr& battle_grid::at(const hex::location& loc) const
+{
+	static const battle_character_ptr nobody;
+	if(counting_) {
+		++lookups_;
+	}
+
+	if(!is_loc_on_grid(loc)) {
+		return nobody;
+	}
+
+	return occupants_[index(loc)];
+}
+
+const_battle_character_ptr battle_grid::engaged_with(
+                                 const battle_character& c) const
+{
+	const battle_character_ptr& a =
+	          at(hex::tile_in_direction(c.loc(), c.facing()));
+	if(a && hex::tile_in_direction(a->loc(), a->facing()) == c.loc()) {
+		return a;
+	}
+
+	return const_battle_character_ptr();
+}
+
+}
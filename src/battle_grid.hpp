@@ -0,0 +1,76 @@
+/*
+   Copyright (C) 2007 by David White <dave.net>
+   Part of the Silver Tree Project
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 2 or later.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY.
+
+   See the COPYING file for more details.
+*/
+#ifndef BATTLE_GRID_HPP_INCLUDED
+#define BATTLE_GRID_HPP_INCLUDED
+
+#include <boost/utility.hpp>
+#include <vector>
+
+#include "battle_character_fwd.hpp"
+#include "tile_logic.hpp"
+
+namespace game_logic
+{
+
+//which character is standing on each hex of a battle map. Characters
+//added to the grid keep it up to date themselves whenever they
+//change location, so finding the character on a hex, or the one a
+//character is engaged with, doesn't need a scan over every participant.
+class battle_grid : boost::noncopyable
+{
+public:
+	explicit battle_grid(const hex::location& dim);
+	~battle_grid();
+
+	void add(const battle_character_ptr& c);
+	void remove(battle_character& c);
+
+	//called by a character in the grid when it moves from 'from' to its
+	//current location.
+	void move(const battle_character& c, const hex::location& from);
+
+	//the character standing at loc, or a null pointer if there is none.
+	const battle_character_ptr& at(const hex::location& loc) const;
+
+	//the character c is facing, if that character is facing c in turn.
+	//Engagement follows directly from the occupants and their facing,
+	//so there is nothing extra to keep up to date when characters turn.
+	const_battle_character_ptr engaged_with(const battle_character& c) const;
+
+	//the number of lookups made since the grid was made; each one of
+	//them would otherwise have been a scan over the participants.
+	int lookups() const { return lookups_; }
+
+	//while counting is suspended the grid isn't modified by lookups, so
+	//it may be read from several threads at once.
+	void suspend_counting() { counting_ = false; }
+	void resume_counting() { counting_ = true; }
+
+private:
+	int index(const hex::location& loc) const {
+		return loc.y()*dim_.x() + loc.x();
+	}
+
+	bool is_loc_on_grid(const hex::location& loc) const {
+		return loc.x() >= 0 && loc.y() >= 0 &&
+		       loc.x() < dim_.x() && loc.y() < dim_.y();
+	}
+
+	hex::location dim_;
+	std::vector<battle_character_ptr> occupants_;
+	mutable int lookups_;
+	bool counting_;
+};
+
+}
+
+#endif
@@ -10,13 +10,17 @@
 
    See the COPYING file for more details.
 */
+#include <algorithm>
 #include <iostream>
+#include <sstream>
 #include <stdlib.h>
 
 #include "base_terrain.hpp"
 #include "battle_map_generator.hpp"
+#include "filesystem.hpp"
 #include "foreach.hpp"
 #include "gamemap.hpp"
+#include "preferences.hpp"
 #include "terrain_feature.hpp"
 #include "tile.hpp"
 #include "tile_logic.hpp"
@@ -60,12 +64,171 @@ void calculate_route(const hex::location& src, const hex::location& dst,
 	}
 }
 
+//the area of the world map a battle map is made from, and the size of
+//the battle map.
+const int SourceRadius = 10;
+const hex::location SourceDim(SourceRadius*2 + 1, SourceRadius*2 + 1);
+const hex::location BattleDim(100, 100);
+
+//battle maps which have been made recently. Fights often break out
+//again in the same place, and making a map takes a while.
+const int MaxCachedMaps = 4;
+
+struct cached_map {
+	hex::location loc;
+	unsigned int seed;
+	unsigned int source_hash;
+	boost::shared_ptr<const hex::gamemap> map;
+};
+
+std::vector<cached_map> map_cache;
+
+unsigned int hash_string(unsigned int h, const std::string& str)
+{
+	foreach(char c, str) {
+		h = (h ^ static_cast<unsigned char>(c))*16777619U;
+	}
+
+	return (h ^ 0xFF)*16777619U;
+}
+
+//a hash of everything in the area of the world a battle map is made
+//from, so that a cached map isn't used once the world has changed.
+unsigned int hash_source(const hex::gamemap& world_map,
+                         const hex::location& loc)
+{
+	unsigned int h = 2166136261U;
+	for(int y = loc.y() - SourceRadius; y <= loc.y() + SourceRadius; ++y) {
+		for(int x = loc.x() - SourceRadius; x <= loc.x() + SourceRadius; ++x) {
+			const hex::location src(x, y);
+			if(!world_map.is_loc_on_map(src)) {
+				h = (h ^ 0xFF)*16777619U;
+				continue;
+			}
+
+			const hex::tile& t = world_map.get_tile(src);
+			h = (h ^ static_cast<unsigned int>(t.height()))*16777619U;
+			h = hash_string(h, t.terrain() ? t.terrain()->id() : std::string());
+			h = hash_string(h, t.feature() ? t.feature()->id() : std::string());
+		}
+	}
+
+	return h;
 }
 
-boost::shared_ptr<hex::gamemap> generate_battle_map(
-           const hex::gamemap& world_map, const hex::location& loc)
+std::string cache_file_name(const std::string& dir, const hex::location& loc,
+                            unsigned int seed, unsigned int source_hash)
 {
-	return hex::generate_zoom_map(world_map, hex::location(loc.x()-10,loc.y()-10), hex::location(21,21), hex::location(100,100), 2.0, 1.0);
+	std::ostringstream s;
+	s << dir << "/battle-map-" << loc.x() << "-" << loc.y() << "-"
+	  << seed << "-" << std::hex << source_hash << ".map";
+	return s.str();
+}
+
+//the most battle maps kept in the --battle-map-cache directory. Once
+//there are more, the ones written longest ago are removed.
+const int MaxCacheFiles = 64;
+
+void trim_cache_dir(const std::string& dir)
+{
+	std::vector<std::string> files;
+	sys::get_files_in_dir(dir, &files);
+	std::vector<std::pair<time_t,std::string> > maps;
+	foreach(const std::string& file, files) {
+		if(file.compare(0, 11, "battle-map-") == 0 &&
+		   file.size() > 4 && file.compare(file.size() - 4, 4, ".map") == 0) {
+			const std::string path = dir + "/" + file;
+			maps.push_back(std::make_pair(sys::file_mod_time(path), path));
+		}
+	}
+
+	if(maps.size() <= MaxCacheFiles) {
+		return;
+	}
+
+	std::sort(maps.begin(), maps.end());
+	for(int n = 0; n < maps.size() - MaxCacheFiles; ++n) {
+		sys::remove_file(maps[n].second);
+	}
+}
+
+boost::shared_ptr<const hex::gamemap> read_cache_file(const std::string& fname)
+{
+	if(!sys::file_exists(fname)) {
+		return boost::shared_ptr<const hex::gamemap>();
+	}
+
+	try {
+		boost::shared_ptr<const hex::gamemap> res(
+		                      new hex::gamemap(sys::read_file(fname)));
+		if(res->size() == BattleDim) {
+			return res;
+		}
+	} catch(hex::gamemap::parse_error&) {
+	}
+
+	std::cerr << "ignoring bad cached battle map '" << fname << "'\n";
+	return boost::shared_ptr<const hex::gamemap>();
+}
+
+}
+
+unsigned int battle_map_seed(const hex::location& loc)
+{
+	unsigned int h = 2166136261U;
+	h = (h ^ static_cast<unsigned int>(loc.x()))*16777619U;
+	h = (h ^ static_cast<unsigned int>(loc.y()))*16777619U;
+	return h;
+}
+
+boost::shared_ptr<const hex::gamemap> generate_battle_map(
+           const hex::gamemap& world_map, const hex::location& loc,
+           unsigned int seed)
+{
+	const unsigned int source_hash = hash_source(world_map, loc);
+	for(std::vector<cached_map>::iterator i = map_cache.begin();
+	    i != map_cache.end(); ++i) {
+		if(i->loc == loc && i->seed == seed && i->source_hash == source_hash) {
+			//move it to the front, so the least recently used map is
+			//always at the back.
+			const cached_map found = *i;
+			map_cache.erase(i);
+			map_cache.insert(map_cache.begin(), found);
+			return found.map;
+		}
+	}
+
+	std::string cache_dir = preference_battle_map_cache();
+	std::string fname;
+	boost::shared_ptr<const hex::gamemap> map;
+	if(!cache_dir.empty()) {
+		cache_dir = sys::get_dir(cache_dir);
+		fname = cache_file_name(cache_dir, loc, seed, source_hash);
+		map = read_cache_file(fname);
+	}
+
+	if(!map) {
+		map = hex::generate_zoom_map(world_map,
+		        hex::location(loc.x()-SourceRadius, loc.y()-SourceRadius),
+		        SourceDim, BattleDim, 2.0, 1.0, seed,
+		        std::max(1, preference_ai_threads()));
+		if(!fname.empty()) {
+			sys::write_file(fname, map->write());
+			trim_cache_dir(cache_dir);
+		}
+	}
+
+	cached_map entry;
+	entry.loc = loc;
+	entry.seed = seed;
+	entry.source_hash = source_hash;
+	entry.map = map;
+	map_cache.insert(map_cache.begin(), entry);
+	if(map_cache.size() > MaxCachedMaps) {
+		map_cache.pop_back();
+	}
+
+	return map;
 	hex::location adj[6];
 	get_adjacent_tiles(loc,adj);
 
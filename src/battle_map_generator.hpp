@@ -25,8 +25,18 @@ class location;
 
 namespace game_logic
 {
-	boost::shared_ptr<hex::gamemap> generate_battle_map(
-	         const hex::gamemap& world_map, const hex::location& loc);
+	//makes the map for a battle at loc on the world map. The same seed
+	//always gives the same map for the same part of the world. Recently
+	//made maps are kept, and also written to the directory given by
+	//--battle-map-cache if there is one, so they are only made once.
+	boost::shared_ptr<const hex::gamemap> generate_battle_map(
+	         const hex::gamemap& world_map, const hex::location& loc,
+	         unsigned int seed);
+
+	//the seed the game makes the battle map at loc with. It only
+	//depends on the place, so fighting there again finds the map in
+	//the cache.
+	unsigned int battle_map_seed(const hex::location& loc);
 }
 
 #endif
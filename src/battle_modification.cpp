@@ -1,10 +1,7 @@
 #include "battle_character.hpp"
 #include "battle_modification.hpp"
 #include "character.hpp"
-#include "floating_label.hpp"
-#include "formatter.hpp"
 #include "formula.hpp"
-#include "text.hpp"
 #include "wml_node.hpp"
 
 namespace game_logic
@@ -61,14 +58,16 @@ battle_modification::battle_modification(wml::const_node_ptr node)
 		} else if(i->first == "radius") {
 			radius_.reset(new formula(i->second));
 		} else {
-			mods_[i->first].reset(new formula(i->second));
+			mods_.push_back(std::make_pair(intern_stat(i->first),
+			                formula_ptr(new formula(i->second))));
 		}
 	}
 }
 
 void battle_modification::apply(battle_character& src,
                                 battle_character& target,
-								int current_time) const
+								int current_time,
+								std::vector<int>* damage) const
 {
 	mod_callable callable(target.get_character(), src.get_character());
 	int duration = -1;
@@ -76,23 +75,15 @@ void battle_modification::apply(battle_character& src,
 		duration = duration_->execute(callable).as_int();
 	}
 
-	const SDL_Color red = {0xFF,0x0,0x0,0xFF};
-	const SDL_Color blue = {0x0,0x0,0xFF,0xFF};
-	const GLfloat move[3] = {0.0,0.0,0.01};
-	GLfloat pos[3];
-	GLfloat rotate;
-	target.get_pos(pos,&rotate);
-
-	for(std::map<std::string,formula_ptr>::const_iterator i = mods_.begin();
+	for(std::vector<stat_formula>::const_iterator i = mods_.begin();
 	    i != mods_.end(); ++i) {
 		const int value = i->second->execute(callable).as_int();
 
-		if(i->first == "inflict_damage") {
-                    text::renderer& renderer = text::renderer::instance();
-                    target.get_character().take_damage(value);
-                    graphics::floating_label::add(renderer.render(formatter() << value, 20, 
-                                                                   value <= 0 ? blue : red)->as_texture(), 
-                                                  pos, move, 1000);
+		if(i->first == STAT_INFLICT_DAMAGE) {
+			target.get_character().take_damage(value);
+			if(damage) {
+				damage->push_back(value);
+			}
 		} else {
 			target.add_modification(i->first, current_time+duration, value);
 		}
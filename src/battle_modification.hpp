@@ -15,11 +15,13 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 #include <boost/shared_ptr.hpp>
 
 #include "battle_character_fwd.hpp"
 #include "formula_fwd.hpp"
+#include "stat_id.hpp"
 #include "wml_node_fwd.hpp"
 
 namespace game_logic
@@ -29,13 +31,17 @@ class battle_modification
 {
 public:
 	explicit battle_modification(wml::const_node_ptr node);
-	void apply(battle_character& src, battle_character& target, int current_time) const;
+	//applies the modification to target. Any damage inflicted is
+	//added to damage, if it is given.
+	void apply(battle_character& src, battle_character& target, int current_time,
+	           std::vector<int>* damage=NULL) const;
 	enum TARGET_TYPE { TARGET_SELF, TARGET_ENEMY, TARGET_FRIEND, TARGET_ALL };
 	TARGET_TYPE target() const { return target_; }
 	int range() const;
 	int radius() const;
 private:
-	std::map<std::string,formula_ptr> mods_;
+	typedef std::pair<stat_id,formula_ptr> stat_formula;
+	std::vector<stat_formula> mods_;
 	formula_ptr duration_;
 	formula_ptr range_;
 	formula_ptr radius_;
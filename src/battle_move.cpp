@@ -42,7 +42,7 @@ const_battle_move_ptr battle_move::standard_pass()
 	res->min_moves_ = 0;
 	res->can_attack_ = false;
 	res->must_attack_ = false;
-	res->stats_["initiative"].reset(new formula("initiative/2"));
+	res->set_stat("initiative", const_formula_ptr(new formula("initiative/2")));
 	return res;
 }
 
@@ -60,7 +60,7 @@ battle_move::battle_move(wml::const_node_ptr node)
 	if(stats) {
 		for(wml::node::const_attr_iterator i = stats->begin_attr();
 		    i != stats->end_attr(); ++i) {
-			stats_[i->first] = const_formula_ptr(new formula(i->second));
+			set_stat(i->first, const_formula_ptr(new formula(i->second)));
 		}
 	}
 
@@ -70,14 +70,27 @@ battle_move::battle_move(wml::const_node_ptr node)
 	}
 }
 
+void battle_move::set_stat(const std::string& stat, const const_formula_ptr& f)
+{
+	const stat_id id = intern_stat(stat);
+	if(id >= stats_.size()) {
+		stats_.resize(id + 1);
+	}
+
+	stats_[id] = f;
+}
+
 int battle_move::get_stat(const std::string& stat,
                           const battle_character& c) const
 {
-	std::map<std::string,const_formula_ptr>::const_iterator i =
-	         stats_.find(stat);
-	if(i != stats_.end()) {
+	return get_stat(find_stat(stat), c);
+}
+
+int battle_move::get_stat(stat_id stat, const battle_character& c) const
+{
+	if(stat >= 0 && stat < stats_.size() && stats_[stat]) {
 		const character::final_stat_callable callable(c.get_character());
-		return i->second->execute(callable).as_int() + c.mod_stat(stat);
+		return stats_[stat]->execute(callable).as_int() + c.mod_stat(stat);
 	} else {
 		return c.stat(stat);
 	}
@@ -2,12 +2,14 @@
 #define BATTLE_MOVE_HPP_INCLUDED
 
 #include <map>
+#include <vector>
 
 #include "battle_character_fwd.hpp"
 #include "battle_modification.hpp"
 #include "battle_move_fwd.hpp"
 #include "formula_fwd.hpp"
 #include "particle_emitter_fwd.hpp"
+#include "stat_id.hpp"
 #include "wml_node.hpp"
 
 namespace game_logic
@@ -26,6 +28,7 @@ public:
 	bool can_attack() const { return can_attack_; }
 	bool must_attack() const { return must_attack_; }
 	int get_stat(const std::string& stat, const battle_character& c) const;
+	int get_stat(stat_id stat, const battle_character& c) const;
 	int energy_required() const { return energy_required_; }
 
 	const battle_modification_ptr& mod() const { return mod_; }
@@ -39,7 +42,10 @@ private:
 	int min_moves_;
 	bool can_attack_;
 	bool must_attack_;
-	std::map<std::string,const_formula_ptr> stats_;
+	void set_stat(const std::string& stat, const const_formula_ptr& f);
+
+	//the formulas for the move's stats, indexed by stat.
+	std::vector<const_formula_ptr> stats_;
 	battle_modification_ptr mod_;
 	wml::const_node_ptr missile_emitter_;
 	int energy_required_;
@@ -0,0 +1,399 @@
+/*
+   Copyright (C) 2007 by David White <dave.net>
+   Part of the Silver Tree Project
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 2 or later.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY.
+
+   See the COPYING file for more details.
+*/
+#include <algorithm>
+#include <cassert>
+
+#include "battle_engine.hpp"
+#include "battle_move.hpp"
+#include "battle_search.hpp"
+#include "character.hpp"
+#include "foreach.hpp"
+#include "threading.hpp"
+
+namespace game_logic
+{
+
+namespace {
+//looking further ahead than this is never worth the time.
+const int MaxDepth = 32;
+
+//the time a character which can't reach anyone waits for, so that it
+//doesn't move again for the rest of the search.
+const int Never = 1 << 28;
+
+//how much winning is worth, compared to hitpoints.
+const double WinValue = 100000.0;
+
+struct search_result {
+	double value;
+	int nodes;
+	bool aborted, cut_off;
+};
+
+struct search_task {
+	const battle_search* search;
+	int depth;
+	Uint32 deadline;
+	std::vector<search_result>* results;
+};
+}
+
+class battle_search::searcher
+{
+public:
+	searcher(const battle_search& s, const scenario& sc, Uint32 deadline)
+	  : search_(s), scenario_(sc), state_(s.state_),
+	    side_(s.state_.units()[s.index_].player_side),
+	    deadline_(deadline), nodes_(0), aborted_(false), cut_off_(false)
+	{}
+
+	//the value of unit a.unit making the attack atk, averaged over
+	//whether it misses, hits or strikes critically.
+	double attack_value(const battle_state::action& a, const attack& atk,
+	                    int depth);
+
+	int nodes() const { return nodes_; }
+	bool aborted() const { return aborted_; }
+	bool cut_off() const { return cut_off_; }
+
+private:
+	double value(int depth);
+	double evaluate() const;
+
+	const battle_search& search_;
+	const scenario& scenario_;
+	battle_state state_;
+	bool side_;
+	Uint32 deadline_;
+	int nodes_;
+	bool aborted_, cut_off_;
+};
+
+double battle_search::searcher::attack_value(const battle_state::action& a,
+                                             const attack& atk, int depth)
+{
+	//an attack misses on a roll from 0 to 99 no higher than the
+	//defense, and strikes critically on one at least twice as high.
+	int defense;
+	if(state_.attacked_from_behind(atk.target, atk.from)) {
+		defense = atk.defense_behind;
+	} else {
+		defense = std::max(0, atk.defense +
+		            state_.stat_mod(atk.target, STAT_DEFENSE));
+	}
+
+	const int misses = std::min(100, defense + 1);
+	const int criticals = std::max(0, 100 - std::max(defense + 1, defense*2));
+	const int hits = 100 - misses - criticals;
+
+	const int damage[] = {0, atk.damage, atk.damage_critical};
+	int chances[] = {misses, hits, criticals};
+	if(atk.damage == atk.damage_critical) {
+		chances[1] += chances[2];
+		chances[2] = 0;
+	}
+
+	battle_state::action act = a;
+	act.target = atk.target;
+	act.time_taken = atk.time_taken;
+	act.stamina_used = atk.stamina_used;
+	act.energy_used = atk.energy_used;
+
+	double res = 0.0;
+	battle_state::undo_record undo;
+	for(int n = 0; n != 3; ++n) {
+		if(chances[n] == 0) {
+			continue;
+		}
+
+		act.damage = damage[n];
+		state_.apply(act, undo);
+		res += chances[n]*value(depth - 1);
+		state_.undo(undo);
+	}
+
+	return res/100.0;
+}
+
+double battle_search::searcher::value(int depth)
+{
+	if((++nodes_ & 0xFF) == 0 && SDL_GetTicks() >= deadline_) {
+		aborted_ = true;
+	}
+
+	if(aborted_) {
+		return 0.0;
+	}
+
+	const int u = state_.next_unit();
+	if(state_.winner() || u == -1 ||
+	   state_.units()[u].move_at >= Never) {
+		return evaluate();
+	}
+
+	if(depth == 0) {
+		cut_off_ = true;
+		return evaluate();
+	}
+
+	const battle_state::unit& unit = state_.units()[u];
+	const bool maximize = unit.player_side == side_;
+	battle_state::action a;
+	a.unit = u;
+
+	double best = 0.0;
+	bool found = false;
+	foreach(const attack& atk, scenario_.attacks[u]) {
+		if(!state_.alive(atk.target) || atk.energy_used > unit.energy) {
+			continue;
+		}
+
+		const double v = attack_value(a, atk, depth);
+		if(!found || (maximize ? v > best : v < best)) {
+			best = v;
+			found = true;
+		}
+	}
+
+	if(found) {
+		return best;
+	}
+
+	//nobody is in reach, and since only the searching character moves,
+	//nobody ever will be.
+	battle_state::undo_record undo;
+	a.wait_time = Never;
+	state_.apply(a, undo);
+	const double res = value(depth);
+	state_.undo(undo);
+	return res;
+}
+
+double battle_search::searcher::evaluate() const
+{
+	//hitpoints count for each side, and so does having each character
+	//still standing, worth half of its full hitpoints.
+	double res = 0.0;
+	foreach(const battle_state::unit& u, state_.units()) {
+		if(u.hitpoints <= 0) {
+			continue;
+		}
+
+		const double v = u.hitpoints + u.max_hitpoints/2;
+		res += u.player_side == side_ ? v : -v;
+	}
+
+	const int winner = state_.winner();
+	if(winner) {
+		res += (winner == 1) == side_ ? WinValue : -WinValue;
+	}
+
+	return res;
+}
+
+battle_search::battle_search(const battle_engine& b,
+                             const battle_character& c)
+  : battle_(b), index_(-1), state_(b),
+    depth_(0), nodes_(0)
+{
+	const std::vector<battle_character_ptr>& chars = b.participants();
+	for(int n = 0; n != chars.size(); ++n) {
+		if(chars[n].get() == &c) {
+			index_ = n;
+		}
+	}
+
+	assert(index_ != -1);
+
+	//the attacks between everyone else don't depend on where the
+	//searching character goes.
+	others_attacks_.resize(chars.size());
+	for(int a = 0; a != chars.size(); ++a) {
+		for(int t = 0; t != chars.size(); ++t) {
+			if(a != index_ && t != index_ && chars[a]->is_enemy(*chars[t])) {
+				add_attacks(a, chars[a]->loc(), t, chars[t]->loc(),
+				            others_attacks_[a]);
+			}
+		}
+	}
+}
+
+int battle_search::get_scenario(const hex::location& dst)
+{
+	for(int n = 0; n != scenarios_.size(); ++n) {
+		if(scenarios_[n].dst == dst) {
+			return n;
+		}
+	}
+
+	const std::vector<battle_character_ptr>& chars = battle_.participants();
+	scenario s;
+	s.dst = dst;
+	s.attacks = others_attacks_;
+	for(int t = 0; t != chars.size(); ++t) {
+		if(chars[index_]->is_enemy(*chars[t])) {
+			add_attacks(index_, dst, t, chars[t]->loc(), s.attacks[index_]);
+			add_attacks(t, chars[t]->loc(), index_, dst, s.attacks[t]);
+		}
+	}
+
+	scenarios_.push_back(s);
+	return scenarios_.size() - 1;
+}
+
+battle_search::attack battle_search::make_attack(int attacker,
+               const hex::location& from, int target,
+               const hex::location& target_loc, int move) const
+{
+	const battle_character& a = *battle_.participants()[attacker];
+	const battle_character& t = *battle_.participants()[target];
+	const battle_move& m = *a.get_character().battle_moves()[move];
+	const battle_engine::attack_stats stats =
+	       battle_.attack_stats_from(a, t, m, from, target_loc, false);
+
+	attack res;
+	res.target = target;
+	res.move = move;
+	res.from = from;
+	res.damage = stats.damage;
+	res.damage_critical = stats.damage_critical;
+	res.time_taken = stats.time_taken;
+	res.stamina_used = stats.stamina_used;
+	res.energy_used = m.energy_required();
+	res.defense = stats.defense - t.mod_stat(STAT_DEFENSE);
+	res.defense_behind = t.defense_behind();
+	return res;
+}
+
+void battle_search::add_attacks(int attacker, const hex::location& from,
+                                int target, const hex::location& target_loc,
+                                std::vector<attack>& attacks) const
+{
+	const battle_character& a = *battle_.participants()[attacker];
+	const battle_character& t = *battle_.participants()[target];
+
+	//the searching character isn't really at target_loc, so whether it
+	//can be reached there is judged on the range of the attacker alone.
+	bool reachable;
+	if(target_loc == t.loc()) {
+		reachable = a.can_attack(t, from);
+	} else if(a.get_character().attack_range() > 1) {
+		reachable = battle_.map().has_line_of_sight(from, target_loc, NULL,
+		                            a.get_character().attack_range());
+	} else {
+		reachable = hex::tiles_adjacent(from, target_loc);
+	}
+
+	if(!reachable) {
+		return;
+	}
+
+	const std::vector<const_battle_move_ptr>& moves =
+	                              a.get_character().battle_moves();
+	for(int m = 0; m != moves.size(); ++m) {
+		if(moves[m]->can_attack() && moves[m]->min_moves() == 0) {
+			attacks.push_back(make_attack(attacker, from, target,
+			                              target_loc, m));
+		}
+	}
+}
+
+bool battle_search::add_candidate(const hex::location& dst,
+                                  const battle_character::route& route,
+                                  int target, int move)
+{
+	const battle_character& c = *battle_.participants()[index_];
+	if(c.get_character().battle_moves()[move]->energy_required() >
+	   c.energy()) {
+		return false;
+	}
+
+	candidate cand;
+	cand.scenario = get_scenario(dst);
+	cand.action.unit = index_;
+	cand.action.dst = dst;
+	if(route.size() > 1) {
+		cand.action.move_time = c.route_cost(route);
+		cand.action.move_facing = hex::get_adjacent_direction(
+		                      route[route.size()-2], route.back());
+	}
+
+	cand.atk = make_attack(index_, dst, target,
+	                       battle_.participants()[target]->loc(), move);
+	candidates_.push_back(cand);
+	return true;
+}
+
+void battle_search::search_candidate(void* data, int n)
+{
+	const search_task& task = *static_cast<search_task*>(data);
+	const battle_search& s = *task.search;
+	const candidate& cand = s.candidates_[n];
+	searcher search(s, s.scenarios_[cand.scenario], task.deadline);
+
+	search_result& result = (*task.results)[n];
+	result.value = search.attack_value(cand.action, cand.atk, task.depth);
+	result.nodes = search.nodes();
+	result.aborted = search.aborted();
+	result.cut_off = search.cut_off();
+}
+
+int battle_search::search(int max_ms, int nthreads)
+{
+	depth_ = 0;
+	nodes_ = 0;
+	if(candidates_.size() < 2) {
+		return candidates_.empty() ? -1 : 0;
+	}
+
+	//every candidate is searched to the same depth before any of them
+	//is searched deeper, so that their values can be compared.
+	std::vector<search_result> results(candidates_.size());
+	search_task task;
+	task.search = this;
+	task.deadline = SDL_GetTicks() + max_ms;
+	task.results = &results;
+
+	int best = -1;
+	for(int depth = 1; depth <= MaxDepth; ++depth) {
+		task.depth = depth;
+		threading::parallel_for(candidates_.size(), search_candidate,
+		                        &task, nthreads);
+
+		bool aborted = false, cut_off = false;
+		foreach(const search_result& r, results) {
+			nodes_ += r.nodes;
+			aborted = aborted || r.aborted;
+			cut_off = cut_off || r.cut_off;
+		}
+
+		if(aborted) {
+			break;
+		}
+
+		best = 0;
+		for(int n = 1; n != results.size(); ++n) {
+			if(results[n].value > results[best].value) {
+				best = n;
+			}
+		}
+
+		depth_ = depth;
+		if(!cut_off) {
+			break;
+		}
+	}
+
+	return best;
+}
+
+}
@@ -0,0 +1,110 @@
+/*
+   Copyright (C) 2007 by David White <dave.net>
+   Part of the Silver Tree Project
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 2 or later.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY.
+
+   See the COPYING file for more details.
+*/
+#ifndef BATTLE_SEARCH_HPP_INCLUDED
+#define BATTLE_SEARCH_HPP_INCLUDED
+
+#include <vector>
+
+#include "battle_character.hpp"
+#include "battle_state.hpp"
+#include "tile_logic.hpp"
+
+namespace game_logic
+{
+
+class battle_engine;
+
+//chooses between the attacks a character could make by looking ahead
+//over the turns which follow, on copies of the battle_state. Each side
+//is taken to make the attacks which are best for it, and each attack
+//to hit, miss or strike critically with the chance the rules give it
+//(an expectiminimax search).
+//
+//Everything the search needs from the characters' formulas is worked
+//out beforehand on the calling thread, so that the search itself can
+//be spread over threads. To keep that affordable, only the searching
+//character moves: everyone else attacks from where they stand now.
+class battle_search
+{
+public:
+	battle_search(const battle_engine& b, const battle_character& c);
+
+	//adds an attack the character could make on the participant with
+	//index target, using its battle move with index move, after moving
+	//to dst along route. Returns false if the attack can't be made.
+	bool add_candidate(const hex::location& dst,
+	                   const battle_character::route& route,
+	                   int target, int move);
+
+	int num_candidates() const { return candidates_.size(); }
+
+	//looks further and further ahead, until max_ms milliseconds have
+	//passed or the rest of the battle has been seen, and returns the
+	//index of the best candidate. Returns -1 if there wasn't time to
+	//look even one move ahead.
+	int search(int max_ms, int nthreads);
+
+	//how many turns ahead the last search looked, and how many
+	//positions it considered.
+	int depth() const { return depth_; }
+	int nodes() const { return nodes_; }
+
+private:
+	struct attack {
+		int target, move;
+		hex::location from;
+		int damage, damage_critical;
+		int time_taken, stamina_used, energy_used;
+		//the defense of the target against the attack without any of
+		//its modifications, and when attacked from behind.
+		int defense, defense_behind;
+	};
+
+	//the attacks each participant can make once the searching
+	//character has moved to dst.
+	struct scenario {
+		hex::location dst;
+		std::vector<std::vector<attack> > attacks;
+	};
+
+	struct candidate {
+		int scenario;
+		battle_state::action action;
+		attack atk;
+	};
+
+	class searcher;
+	static void search_candidate(void* data, int n);
+
+	int get_scenario(const hex::location& dst);
+	attack make_attack(int attacker, const hex::location& from,
+	                   int target, const hex::location& target_loc,
+	                   int move) const;
+
+	//adds the attacks the attacker can make on the target without
+	//moving, if it can reach the target from where they stand.
+	void add_attacks(int attacker, const hex::location& from,
+	                 int target, const hex::location& target_loc,
+	                 std::vector<attack>& attacks) const;
+
+	const battle_engine& battle_;
+	int index_;
+	battle_state state_;
+	std::vector<std::vector<attack> > others_attacks_;
+	std::vector<scenario> scenarios_;
+	std::vector<candidate> candidates_;
+	int depth_, nodes_;
+};
+
+}
+
+#endif
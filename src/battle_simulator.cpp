@@ -0,0 +1,289 @@
+/*
+   Copyright (C) 2007 by David White <dave.net>
+   Part of the Silver Tree Project
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 2 or later.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY.
+
+   See the COPYING file for more details.
+*/
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+
+#include <SDL.h>
+
+#ifndef _WIN32
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "battle_character_sim.hpp"
+#include "battle_engine.hpp"
+#include "battle_map_generator.hpp"
+#include "battle_simulator.hpp"
+#include "character.hpp"
+#include "filesystem.hpp"
+#include "foreach.hpp"
+#include "gamemap.hpp"
+#include "wml_node.hpp"
+
+namespace game_logic
+{
+
+battle_simulation::battle_simulation()
+  : map_file("data/maps/island1"), battles(100), seed(1), processes(0),
+    max_time(10000)
+{
+}
+
+namespace {
+
+struct battle_record {
+	int result;
+	int duration;
+	int turns;
+	int grid_lookups;
+	double seconds;
+};
+
+//where the nth character of a side starts: the sides face each other
+//in rows either side of the middle of the map.
+hex::location start_loc(const hex::gamemap& map, int side, int n)
+{
+	return hex::location(map.size().x()/2 - 6 + n,
+	                     map.size().y()/2 + (side == 0 ? -3 : 3));
+}
+
+battle_record play_battle(const battle_simulation& sim,
+                          const hex::gamemap& map, unsigned int seed)
+{
+	//formulas roll dice with rand(), so seed it too for the battle to be
+	//the same every time it's played.
+	srand(seed);
+
+	std::vector<battle_character_ptr> chars;
+	for(int side = 0; side != 2; ++side) {
+		for(int n = 0; n != sim.sides[side].size(); ++n) {
+			wml::node_ptr node(new wml::node("character"));
+			node->set_attr("id", sim.sides[side][n]);
+			const hex::location loc = start_loc(map, side, n);
+			chars.push_back(battle_character_ptr(new battle_character_sim(
+			            character::create(node), side == 0,
+			            loc, hex::SOUTH, map)));
+		}
+	}
+
+	const std::clock_t start = std::clock();
+	battle_engine b(chars, map, seed);
+
+	//the battles are already shared out between processes.
+	b.set_ai_threads(1);
+	b.simulate(sim.max_time);
+
+	battle_record res;
+	res.result = b.result();
+	res.duration = b.current_time();
+	res.turns = b.turns_played();
+	res.grid_lookups = b.grid().lookups();
+	res.seconds = double(std::clock() - start)/CLOCKS_PER_SEC;
+	return res;
+}
+
+void play_battles(const battle_simulation& sim, const hex::gamemap& map,
+                  int begin, int end, battle_record* records)
+{
+	for(int n = begin; n != end; ++n) {
+		records[n - begin] = play_battle(sim, map, sim.seed + n);
+	}
+}
+
+int number_of_processes(const battle_simulation& sim)
+{
+	int res = sim.processes;
+#ifndef _WIN32
+	if(res <= 0) {
+		res = sysconf(_SC_NPROCESSORS_ONLN);
+	}
+#endif
+	return std::max(1, std::min(res, sim.battles));
+}
+
+//plays every battle and puts the results in records. Each process
+//plays a contiguous range of battles and sends the results back
+//through a pipe. Separate processes are used rather than threads
+//because characters, items and formulas share reference counted data
+//which isn't safe to use from more than one thread.
+void play_all_battles(const battle_simulation& sim, const hex::gamemap& map,
+                      std::vector<battle_record>& records)
+{
+	records.resize(sim.battles);
+	const int nprocesses = number_of_processes(sim);
+	if(nprocesses == 1) {
+		play_battles(sim, map, 0, sim.battles, &records[0]);
+		return;
+	}
+
+#ifndef _WIN32
+	std::vector<pid_t> pids;
+	std::vector<int> fds;
+	std::cout << std::flush;
+	std::cerr << std::flush;
+	for(int p = 0; p != nprocesses; ++p) {
+		const int begin = (sim.battles*p)/nprocesses;
+		const int end = (sim.battles*(p+1))/nprocesses;
+		int pipe_fds[2];
+		if(pipe(pipe_fds) != 0) {
+			break;
+		}
+
+		const pid_t pid = fork();
+		if(pid == 0) {
+			close(pipe_fds[0]);
+			std::vector<battle_record> results(end - begin);
+			play_battles(sim, map, begin, end, &results[0]);
+			const char* data = reinterpret_cast<const char*>(&results[0]);
+			size_t remaining = results.size()*sizeof(battle_record);
+			while(remaining > 0) {
+				const ssize_t n = write(pipe_fds[1], data, remaining);
+				if(n <= 0) {
+					_exit(1);
+				}
+
+				data += n;
+				remaining -= n;
+			}
+
+			_exit(0);
+		}
+
+		close(pipe_fds[1]);
+		if(pid < 0) {
+			close(pipe_fds[0]);
+			break;
+		}
+
+		pids.push_back(pid);
+		fds.push_back(pipe_fds[0]);
+	}
+
+	//any battles which couldn't be given to another process are played
+	//in this one.
+	const int first_unplayed = (sim.battles*pids.size())/nprocesses;
+	play_battles(sim, map, first_unplayed, sim.battles,
+	             &records[0] + first_unplayed);
+
+	for(int p = 0; p != pids.size(); ++p) {
+		const int begin = (sim.battles*p)/nprocesses;
+		const int end = (sim.battles*(p+1))/nprocesses;
+		char* data = reinterpret_cast<char*>(&records[begin]);
+		size_t remaining = (end - begin)*sizeof(battle_record);
+		while(remaining > 0) {
+			const ssize_t n = read(fds[p], data, remaining);
+			if(n <= 0) {
+				break;
+			}
+
+			data += n;
+			remaining -= n;
+		}
+
+		close(fds[p]);
+		int status = 0;
+		waitpid(pids[p], &status, 0);
+		if(remaining > 0) {
+			std::cerr << "battle simulation process " << p
+			          << " failed; playing its battles again\n";
+			play_battles(sim, map, begin, end, &records[begin]);
+		}
+	}
+#else
+	play_battles(sim, map, 0, sim.battles, &records[0]);
+#endif
+}
+
+}
+
+bool simulate_battles(const battle_simulation& sim, std::ostream& out)
+{
+	if(sim.battles <= 0 || sim.sides[0].empty() || sim.sides[1].empty()) {
+		std::cerr << "battle simulation needs a number of battles and characters on both sides\n";
+		return false;
+	}
+
+	const std::string map_data = sys::read_file(sim.map_file);
+	if(map_data.empty()) {
+		std::cerr << "could not read battle map '" << sim.map_file << "'\n";
+		return false;
+	}
+
+	const hex::gamemap world_map(map_data);
+	const boost::shared_ptr<const hex::gamemap> map = generate_battle_map(
+	    world_map, hex::location(world_map.size().x()/2,
+	                             world_map.size().y()/2), sim.seed);
+
+	for(int side = 0; side != 2; ++side) {
+		for(int n = 0; n != sim.sides[side].size(); ++n) {
+			const hex::location loc = start_loc(*map, side, n);
+			if(!map->is_loc_on_map(loc)) {
+				std::cerr << "battle map is " << map->size().x() << "x"
+				          << map->size().y() << ", too small to place "
+				          << "character " << (n+1) << " of side "
+				          << (side+1) << " at " << loc.x() << ","
+				          << loc.y() << "\n";
+				return false;
+			}
+		}
+	}
+
+	const Uint32 start = SDL_GetTicks();
+	std::vector<battle_record> records;
+	play_all_battles(sim, *map, records);
+	const Uint32 elapsed = std::max<Uint32>(SDL_GetTicks() - start, 1);
+
+	int wins[2] = {0,0}, draws = 0;
+	double total_duration = 0.0, total_turns = 0.0, total_seconds = 0.0;
+	double total_lookups = 0.0;
+	double longest = 0.0;
+	foreach(const battle_record& r, records) {
+		if(r.result == battle_engine::PLAYER_WIN) {
+			++wins[0];
+		} else if(r.result == battle_engine::PLAYER_LOSE) {
+			++wins[1];
+		} else {
+			++draws;
+		}
+
+		total_duration += r.duration;
+		total_turns += r.turns;
+		total_lookups += r.grid_lookups;
+		total_seconds += r.seconds;
+		longest = std::max(longest, r.seconds);
+	}
+
+	const double n = records.size();
+	out << "simulated " << records.size() << " battles on "
+	    << number_of_processes(sim) << " processes\n";
+	for(int side = 0; side != 2; ++side) {
+		out << "side " << (side+1) << " (";
+		for(int c = 0; c != sim.sides[side].size(); ++c) {
+			out << (c ? "," : "") << sim.sides[side][c];
+		}
+		out << ") won " << wins[side] << " (" << (100.0*wins[side])/n << "%)\n";
+	}
+	out << "draws: " << draws << " (" << (100.0*draws)/n << "%)\n"
+	    << "average duration: " << total_duration/n << " time units, "
+	    << total_turns/n << " turns\n"
+	    << "occupant grid lookups: " << total_lookups/n
+	    << " per battle, each of them a scan over the participants before\n"
+	    << "time per battle: average " << (1000.0*total_seconds)/n
+	    << "ms, longest " << 1000.0*longest << "ms\n"
+	    << "throughput: " << (1000.0*n)/elapsed << " battles per second\n";
+	return true;
+}
+
+}
@@ -0,0 +1,55 @@
+/*
+   Copyright (C) 2007 by David White <dave.net>
+   Part of the Silver Tree Project
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 2 or later.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY.
+
+   See the COPYING file for more details.
+*/
+#ifndef BATTLE_SIMULATOR_HPP_INCLUDED
+#define BATTLE_SIMULATOR_HPP_INCLUDED
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace game_logic
+{
+
+//a batch of battles to be played out between the same two sides, with
+//nothing drawn and every character choosing its own moves, to find
+//out how evenly matched the sides are.
+struct battle_simulation
+{
+	battle_simulation();
+
+	//the character generator ids of the characters on each side. The
+	//first side counts as the player's.
+	std::vector<std::string> sides[2];
+
+	//the world map whose middle the battles are fought in.
+	std::string map_file;
+
+	int battles;
+
+	//battle n is played with seed+n, so any battle can be played again.
+	unsigned int seed;
+
+	//the number of processes to share the battles between, or 0 to use
+	//one for each processor.
+	int processes;
+
+	//battles still going on after this much time count as draws.
+	int max_time;
+};
+
+//plays the battles and writes the win rates, durations and timings to
+//out. Returns false if the battles couldn't be set up.
+bool simulate_battles(const battle_simulation& sim, std::ostream& out);
+
+}
+
+#endif
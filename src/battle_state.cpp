@@ -0,0 +1,212 @@
+/*
+   Copyright (C) 2007 by David White <dave.net>
+   Part of the Silver Tree Project
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 2 or later.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY.
+
+   See the COPYING file for more details.
+*/
+#include <algorithm>
+#include <cstdlib>
+
+#include "battle_engine.hpp"
+#include "battle_state.hpp"
+#include "character.hpp"
+#include "foreach.hpp"
+
+namespace game_logic
+{
+
+battle_state::battle_state(const battle_engine& b)
+  : time_(b.current_time())
+{
+	const std::vector<battle_character_ptr>& chars = b.participants();
+	units_.reserve(chars.size());
+	for(int n = 0; n != chars.size(); ++n) {
+		const battle_character& c = *chars[n];
+		unit u;
+		u.loc = c.loc();
+		u.facing = c.facing();
+		u.hitpoints = c.get_character().hitpoints();
+		u.max_hitpoints = c.get_character().max_hitpoints();
+		u.fatigue = c.get_character().fatigue();
+		u.energy = c.energy();
+		u.move_at = c.ready_to_move_at();
+		u.player_side = c.is_human();
+		units_.push_back(u);
+
+		foreach(const battle_character::stat_mod& m, c.modifications()) {
+			modification mod;
+			mod.unit = n;
+			mod.stat = m.stat;
+			mod.expire = m.expire;
+			mod.mod = m.mod;
+			mods_.push_back(mod);
+		}
+	}
+}
+
+int battle_state::next_unit() const
+{
+	int res = -1;
+	for(int n = 0; n != units_.size(); ++n) {
+		if(alive(n) && (res == -1 || units_[n].move_at < units_[res].move_at)) {
+			res = n;
+		}
+	}
+
+	return res;
+}
+
+int battle_state::winner() const
+{
+	bool found_player = false;
+	bool found_enemy = false;
+	for(int n = 0; n != units_.size(); ++n) {
+		if(!alive(n)) {
+			continue;
+		}
+
+		if(units_[n].player_side) {
+			found_player = true;
+		} else {
+			found_enemy = true;
+		}
+	}
+
+	if(found_player && !found_enemy) {
+		return 1;
+	} else if(found_enemy && !found_player) {
+		return 2;
+	} else {
+		return 0;
+	}
+}
+
+int battle_state::stat_mod(int n, stat_id stat) const
+{
+	int res = 0;
+	foreach(const modification& m, mods_) {
+		if(m.unit == n && m.stat == stat) {
+			res += m.mod;
+		}
+	}
+
+	return res;
+}
+
+int battle_state::unit_at(const hex::location& loc) const
+{
+	for(int n = 0; n != units_.size(); ++n) {
+		if(alive(n) && units_[n].loc == loc) {
+			return n;
+		}
+	}
+
+	return -1;
+}
+
+int battle_state::engaged_with(int n) const
+{
+	const unit& u = units_[n];
+	if(!hex::is_valid_direction(u.facing)) {
+		return -1;
+	}
+
+	const int a = unit_at(hex::tile_in_direction(u.loc, u.facing));
+	if(a != -1 && hex::is_valid_direction(units_[a].facing) &&
+	   hex::tile_in_direction(units_[a].loc, units_[a].facing) == u.loc) {
+		return a;
+	}
+
+	return -1;
+}
+
+bool battle_state::attacked_from_behind(int defender,
+                                        const hex::location& from) const
+{
+	if(engaged_with(defender) == -1) {
+		return false;
+	}
+
+	const unit& u = units_[defender];
+	switch(abs(hex::get_adjacent_direction(u.loc, from) - u.facing)) {
+	case 2:
+	case 3:
+	case 4:
+		return true;
+	default:
+		return false;
+	}
+}
+
+void battle_state::apply(const action& a, undo_record& u)
+{
+	u.time = time_;
+	u.actor = a.unit;
+	u.actor_before = units_[a.unit];
+	u.target = a.target;
+	if(a.target != -1) {
+		u.target_before = units_[a.target];
+	}
+
+	unit& actor = units_[a.unit];
+	time_ = std::max(time_, actor.move_at);
+
+	u.expired.clear();
+	std::vector<modification>::iterator keep = mods_.begin();
+	for(std::vector<modification>::iterator i = mods_.begin();
+	    i != mods_.end(); ++i) {
+		if(i->expire < time_) {
+			u.expired.push_back(*i);
+		} else {
+			*keep++ = *i;
+		}
+	}
+	mods_.erase(keep, mods_.end());
+
+	if(a.dst.valid() && a.dst != actor.loc) {
+		actor.loc = a.dst;
+		actor.move_at += a.move_time;
+		if(hex::is_valid_direction(a.move_facing)) {
+			actor.facing = a.move_facing;
+		}
+	}
+
+	if(a.target == -1) {
+		actor.move_at += a.wait_time;
+		return;
+	}
+
+	unit& target = units_[a.target];
+	const int engaged = engaged_with(a.target);
+	const bool otherwise_engaged = engaged != -1 &&
+	                               units_[engaged].loc != actor.loc;
+
+	actor.fatigue = std::max(0, actor.fatigue + a.stamina_used);
+	actor.facing = hex::get_main_direction(actor.loc, target.loc);
+	if(!otherwise_engaged) {
+		target.facing = hex::get_main_direction(target.loc, actor.loc);
+	}
+
+	actor.move_at += a.time_taken;
+	actor.energy = std::max(0, actor.energy - a.energy_used);
+	target.hitpoints = std::min(target.hitpoints - a.damage,
+	                            target.max_hitpoints);
+}
+
+void battle_state::undo(const undo_record& u)
+{
+	units_[u.actor] = u.actor_before;
+	if(u.target != -1) {
+		units_[u.target] = u.target_before;
+	}
+
+	time_ = u.time;
+	mods_.insert(mods_.end(), u.expired.begin(), u.expired.end());
+}
+
+}
@@ -0,0 +1,114 @@
+/*
+   Copyright (C) 2007 by David White <dave.net>
+   Part of the Silver Tree Project
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 2 or later.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY.
+
+   See the COPYING file for more details.
+*/
+#ifndef BATTLE_STATE_HPP_INCLUDED
+#define BATTLE_STATE_HPP_INCLUDED
+
+#include <vector>
+
+#include "stat_id.hpp"
+#include "tile_logic.hpp"
+
+namespace game_logic
+{
+
+class battle_engine;
+
+//a compact copy of the parts of a battle which change as it is played:
+//where the participants stand and which way they face, their hitpoints,
+//fatigue, energy and when they next move, and the modifications on
+//them. It refers to no characters or formulas, so it is cheap to copy
+//and copies can be played forward on any thread. Actions are applied
+//and then undone again, so that a search can use a single copy.
+class battle_state
+{
+public:
+	explicit battle_state(const battle_engine& b);
+
+	struct unit {
+		hex::location loc;
+		hex::DIRECTION facing;
+		int hitpoints, max_hitpoints;
+		int fatigue;
+		int energy;
+		int move_at;
+		bool player_side;
+	};
+
+	struct modification {
+		int unit;
+		stat_id stat;
+		int expire;
+		int mod;
+	};
+
+	//what a unit does on its turn: optionally move to dst, which takes
+	//move_time and leaves it facing move_facing, then either attack
+	//target, dealing the given damage, or wait until wait_time has
+	//passed if target is -1.
+	struct action {
+		action() : unit(-1), move_facing(hex::NULL_DIRECTION), move_time(0),
+		           target(-1), damage(0), time_taken(0), stamina_used(0),
+		           energy_used(0), wait_time(1)
+		{}
+		int unit;
+		hex::location dst;
+		hex::DIRECTION move_facing;
+		int move_time;
+		int target;
+		int damage, time_taken, stamina_used, energy_used;
+		int wait_time;
+	};
+
+	//everything needed to take an action back.
+	struct undo_record {
+		int time;
+		int actor, target;
+		unit actor_before, target_before;
+		std::vector<modification> expired;
+	};
+
+	const std::vector<unit>& units() const { return units_; }
+	int current_time() const { return time_; }
+
+	//the unit whose turn it is next, or -1 if nobody is left to move.
+	int next_unit() const;
+
+	//0 if both sides are still fighting, otherwise 1 if the player's
+	//side has won, and 2 if the other side has.
+	int winner() const;
+
+	bool alive(int n) const { return units_[n].hitpoints > 0; }
+
+	//the total of the modifications to stat on unit n.
+	int stat_mod(int n, stat_id stat) const;
+
+	//the unit which n is engaged with, or -1.
+	int engaged_with(int n) const;
+	bool attacked_from_behind(int defender, const hex::location& from) const;
+
+	//plays an action, which must be for next_unit(), moving the time on
+	//to when it is taken and expiring any modifications which have run
+	//out by then. The record is filled in so undo() can reverse it.
+	void apply(const action& a, undo_record& u);
+	void undo(const undo_record& u);
+
+private:
+	int unit_at(const hex::location& loc) const;
+
+	std::vector<unit> units_;
+	std::vector<modification> mods_;
+	int time_;
+};
+
+}
+
+#endif
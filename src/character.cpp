@@ -177,11 +177,20 @@ const std::string& character::portrait(bool for_bar) const
 int character::move_cost(hex::const_base_terrain_ptr terrain,
                          hex::const_terrain_feature_ptr feature,
                          int height_change) const
+{
+	return move_cost(move_cost_map_, terrain, feature, height_change,
+	                 speed(), climbing());
+}
+
+int character::move_cost(const std::map<std::string,int>& cost_map,
+                         hex::const_base_terrain_ptr terrain,
+                         hex::const_terrain_feature_ptr feature,
+                         int height_change, int speed, int climbing)
 {
 	int base_cost = terrain->default_cost();
 	const std::map<std::string,int>::const_iterator itor =
-	        move_cost_map_.find(terrain->name());
-	if(itor != move_cost_map_.end()) {
+	        cost_map.find(terrain->name());
+	if(itor != cost_map.end()) {
 		base_cost = itor->second;
 	}
 
@@ -192,8 +201,8 @@ int character::move_cost(hex::const_base_terrain_ptr terrain,
 	if(feature) {
 		int feature_cost = feature->default_cost();
 		const std::map<std::string,int>::const_iterator itor =
-		      move_cost_map_.find(feature->name());
-		if(itor != move_cost_map_.end()) {
+		      cost_map.find(feature->name());
+		if(itor != cost_map.end()) {
 			feature_cost = itor->second;
 		}
 
@@ -216,9 +225,9 @@ int character::move_cost(hex::const_base_terrain_ptr terrain,
 	}
 
 	height_change = abs(height_change);
-	const int climb_cost = 100 + (height_change*height_change*100)/climbing();
+	const int climb_cost = 100 + (height_change*height_change*100)/climbing;
 
-	return (climb_cost*base_cost)/(speed()*100);
+	return (climb_cost*base_cost)/(speed*100);
 }
 
 namespace {
@@ -230,20 +239,6 @@ const std::string IntelligenceAttribute = "intelligence";
 const std::string PerceptionAttribute = "perception";
 const std::string WillAttribute = "will";
 
-const std::string MaxHitpointsStat = "max_hitpoints";
-const std::string InitiativeStat = "initiative";
-const std::string AttackStat = "attack";
-const std::string DamageStat = "damage";
-const std::string DodgeStat = "dodge";
-const std::string ParryStat = "parry";
-const std::string SpeedStat = "speed";
-const std::string ClimbStat = "climb";
-const std::string VisionStat = "vision";
-const std::string StaminaStat = "stamina";
-const std::string ResistanceStat = "resistance";
-const std::string ResistancePercentStat = "resistance_percent";
-const std::string SkillPointsStat = "skill_points";
-
 int improvement_cost(int attr)
 {
 	if(attr < 10) {
@@ -367,7 +362,7 @@ void character::set_value(const std::string& key, const variant& value)
 
 int character::total_skill_points() const
 {
-	return stat(SkillPointsStat);
+	return stat(STAT_SKILL_POINTS);
 }
 
 void character::calculate_moves()
@@ -430,41 +425,60 @@ bool character::has_skill(const std::string& name) const
 
 int character::base_stat(const std::string& str) const
 {
-	return formula::evaluate(formula_registry::get_stat_calculation(str),*this).as_int();
+	return base_stat(find_stat(str));
+}
+
+int character::base_stat(stat_id id) const
+{
+	return formula::evaluate(formula_registry::get_stat_calculation(id),*this).as_int();
 }
 
 int character::stat(const std::string& str) const
+{
+	return stat(find_stat(str));
+}
+
+int character::stat(stat_id id) const
 {
 	const const_formula_ptr& penalty =
-	   formula_registry::get_fatigue_penalty(str);
+	   formula_registry::get_fatigue_penalty(id);
 	if(penalty) {
 		return penalty->execute(fatigue_penalty_callable(*this)).as_int();
 	} else {
-		return stat_before_fatigue(str);
+		return stat_before_fatigue(id);
 	}
 }
 
 int character::stat_before_fatigue(const std::string& str) const
 {
-	if(str == "fatigue") {
+	return stat_before_fatigue(find_stat(str));
+}
+
+int character::stat_before_fatigue(stat_id id) const
+{
+	if(id == STAT_FATIGUE) {
 		return fatigue();
 	}
 
-	return base_stat(str) + get_equipment_mod(str) + get_skill_mod(str);
+	return base_stat(id) + get_equipment_mod(id) + get_skill_mod(id);
 }
 
 int character::get_equipment_mod(const std::string& str) const
 {
-	const const_formula_ptr strength_penalty = formula_registry::get_strength_penalty(str);
+	return get_equipment_mod(find_stat(str));
+}
+
+int character::get_equipment_mod(stat_id id) const
+{
+	const const_formula_ptr& strength_penalty = formula_registry::get_strength_penalty(id);
 	int res = 0;
 	foreach(const item_ptr& item, equipment_) {
 		const game_logic::equipment* equip = item_as_equipment(item);
 		if(equip) {
-			res += equip->modify_stat(str);
+			res += equip->modify_stat(id);
 
 			if(strength_penalty) {
-				static const std::string IdealStrength = "ideal_strength";
-				const int shortfall = equip->modify_stat(IdealStrength) - get_attr(StrengthAttribute);
+				const int shortfall = equip->modify_stat(STAT_IDEAL_STRENGTH) - get_attr(StrengthAttribute);
 				if(shortfall > 0) {
 					strength_penalty_callable callable(shortfall);
 					res += strength_penalty->execute(callable).as_int();
@@ -477,10 +491,15 @@ int character::get_equipment_mod(const std::string& str) const
 }
 
 int character::get_skill_mod(const std::string& str) const
+{
+	return get_skill_mod(find_stat(str));
+}
+
+int character::get_skill_mod(stat_id id) const
 {
 	int res = 0;
 	foreach(const const_skill_ptr& skill, skills_) {
-		res += skill->effect_on_stat(*this, str);
+		res += skill->effect_on_stat(*this, id);
 	}
 
 	return res;
@@ -488,7 +507,12 @@ int character::get_skill_mod(const std::string& str) const
 
 int character::stat_mod_height(const std::string& str, int height_diff) const
 {
-	return formula::evaluate(formula_registry::get_height_advantage(str),
+	return stat_mod_height(find_stat(str), height_diff);
+}
+
+int character::stat_mod_height(stat_id id, int height_diff) const
+{
+	return formula::evaluate(formula_registry::get_height_advantage(id),
 	            map_formula_callable(this).add("height",
 						                       variant(height_diff))).as_int();
 }
@@ -500,37 +524,37 @@ int character::vision_cost(hex::const_base_terrain_ptr terrain) const
 
 int character::initiative() const
 {
-	return stat(InitiativeStat);
+	return stat(STAT_INITIATIVE);
 }
 
 int character::max_hitpoints() const
 {
-	return std::max<int>(1,stat(MaxHitpointsStat));
+	return std::max<int>(1,stat(STAT_MAX_HITPOINTS));
 }
 
 int character::speed() const
 {
-	return stat(SpeedStat);
+	return stat(STAT_SPEED);
 }
 
 int character::climbing() const
 {
-	return stat(ClimbStat);
+	return stat(STAT_CLIMB);
 }
 
 int character::vision() const
 {
-	return stat(VisionStat);
+	return stat(STAT_VISION);
 }
 
 int character::experience_required() const
 {
-	return stat("experience_required");
+	return stat(STAT_EXPERIENCE_REQUIRED);
 }
 
 int character::damage() const
 {
-	return stat(DamageStat);
+	return stat(STAT_DAMAGE);
 }
 
 const std::string& character::damage_type() const
@@ -546,7 +570,7 @@ const std::string& character::damage_type() const
 
 int character::attack() const
 {
-	return stat(AttackStat);
+	return stat(STAT_ATTACK);
 }
 
 int character::defense(const std::string& damage_type) const
@@ -561,17 +585,17 @@ int character::defense_behind() const
 
 int character::dodge() const
 {
-	return stat(DodgeStat);
+	return stat(STAT_DODGE);
 }
 
 int character::parry(const std::string& damage_type) const
 {
-	const int base = base_stat(ParryStat) + get_skill_mod(ParryStat);
+	const int base = base_stat(STAT_PARRY) + get_skill_mod(STAT_PARRY);
 	int best = 0;
 	foreach(const item_ptr& item, equipment_) {
 		const game_logic::equipment* equip = item_as_equipment(item);
 		if(equip) {
-			const int equip_parry = equip->modify_stat(ParryStat);
+			const int equip_parry = equip->modify_stat(STAT_PARRY);
 			if(equip_parry > 0) {
 				const int res = ((base + equip_parry) * equip->parry_against(damage_type))/100;
 				if(res > best) {
@@ -592,11 +616,11 @@ void character::get_resistance(const std::string& damage_type,
 
 	foreach(const item_ptr& item, equipment_) {
 		const game_logic::equipment* equip = item_as_equipment(item);
-		*amount += equip->modify_stat(ResistanceStat);
+		*amount += equip->modify_stat(STAT_RESISTANCE);
 		bool present;
 		int perc = equip->modify_stat(damage_type,&present);
 		if(!present) {
-			perc = equip->modify_stat(ResistancePercentStat);
+			perc = equip->modify_stat(STAT_RESISTANCE_PERCENT);
 		}
 
 		*percent += perc;
@@ -605,7 +629,7 @@ void character::get_resistance(const std::string& damage_type,
 
 int character::stamina() const
 {
-	return stat(StaminaStat);
+	return stat(STAT_STAMINA);
 }
 
 bool character::take_damage(int amount)
@@ -643,7 +667,7 @@ bool character::award_experience(int xp)
 		const int old_maxhp = max_hitpoints();
 		++level_;
 		hitpoints_ += max_hitpoints() - old_maxhp;
-		improvement_points_ += formula_registry::get_stat_calculation("improvement_points")->execute(*this).as_int();
+		improvement_points_ += formula_registry::get_stat_calculation(STAT_IMPROVEMENT_POINTS)->execute(*this).as_int();
 		return true;
 	} else {
 		return false;
@@ -652,10 +676,9 @@ bool character::award_experience(int xp)
 
 int character::attack_range() const
 {
-	static const std::string RangeStat = "range";
 	const game_logic::equipment* w = weapon();
 	if(w) {
-		return w->modify_stat(RangeStat);
+		return w->modify_stat(STAT_RANGE);
 	} else {
 		return 0;
 	}
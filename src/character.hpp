@@ -24,6 +24,7 @@
 #include "formula_callable.hpp"
 #include "item_fwd.hpp"
 #include "skill_fwd.hpp"
+#include "stat_id.hpp"
 #include "terrain_feature_fwd.hpp"
 #include "wml_node_fwd.hpp"
 
@@ -43,6 +44,15 @@ public:
 	int move_cost(hex::const_base_terrain_ptr terrain,
 	              hex::const_terrain_feature_ptr feature,
 	              int height_change) const;
+
+	//calculates a movement cost from a set of per-terrain costs and the
+	//speed and climbing of the character. This lets callers which
+	//calculate many movement costs evaluate speed() and climbing() once.
+	static int move_cost(const std::map<std::string,int>& cost_map,
+	                     hex::const_base_terrain_ptr terrain,
+	                     hex::const_terrain_feature_ptr feature,
+	                     int height_change, int speed, int climbing);
+	const std::map<std::string,int>& move_cost_map() const { return move_cost_map_; }
 	int vision_cost(hex::const_base_terrain_ptr terrain) const;
 	int vision() const;
 	const std::string& description() const { return description_; }
@@ -98,12 +108,20 @@ public:
 	void learn_skill(const std::string& name);
 	bool has_skill(const std::string& name) const;
 
+	//stats can be looked up by name, for formulas and WML, but looking
+	//them up by number is much quicker.
 	int base_stat(const std::string& str) const;
+	int base_stat(stat_id id) const;
 	int stat(const std::string& str) const;
+	int stat(stat_id id) const;
 	int stat_before_fatigue(const std::string& str) const;
+	int stat_before_fatigue(stat_id id) const;
 	int get_equipment_mod(const std::string& str) const;
+	int get_equipment_mod(stat_id id) const;
 	int get_skill_mod(const std::string& str) const;
+	int get_skill_mod(stat_id id) const;
 	int stat_mod_height(const std::string& str, int height_diff) const;
+	int stat_mod_height(stat_id id, int height_diff) const;
 
 	const std::vector<item_ptr>& equipment() const { return equipment_; }
 	int attack_range() const;
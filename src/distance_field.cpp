@@ -0,0 +1,131 @@
+/*
+   Copyright (C) 2007 by David White <dave.net>
+   Part of the Silver Tree Project
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 2 or later.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY.
+
+   See the COPYING file for more details.
+*/
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+#include "distance_field.hpp"
+
+namespace game_logic
+{
+
+namespace {
+const int Unreachable = std::numeric_limits<int>::max();
+
+hex::DIRECTION opposite(int dir)
+{
+	return static_cast<hex::DIRECTION>((dir + 3)%6);
+}
+
+typedef std::pair<int,int> heap_entry;
+}
+
+distance_field::distance_field(const_movement_cost_grid_ptr grid,
+                               const hex::location& target)
+  : grid_(grid), target_(target), width_(grid->map().size().x())
+{
+	build();
+}
+
+int distance_field::distance(const hex::location& loc) const
+{
+	if(!grid_->map().is_loc_on_map(loc)) {
+		return -1;
+	}
+
+	const int res = dist_[index(loc)];
+	return res == Unreachable ? -1 : res;
+}
+
+void distance_field::set_target(const hex::location& target)
+{
+	if(target == target_) {
+		return;
+	}
+
+	const int step = grid_->cost(target_, target);
+	target_ = target;
+	if(step < 0) {
+		build();
+		return;
+	}
+
+	//going to the old target and then stepping to the new one is
+	//always possible, so the old distances plus the cost of the step
+	//are an upper bound on the new distances. Only hexes which have a
+	//cheaper route to the new target need to be visited.
+	for(std::vector<int>::iterator i = dist_.begin(); i != dist_.end(); ++i) {
+		if(*i != Unreachable) {
+			*i += step;
+		}
+	}
+
+	std::vector<heap_entry> heap;
+	if(grid_->map().is_loc_on_map(target_)) {
+		dist_[index(target_)] = 0;
+		heap.push_back(heap_entry(0, index(target_)));
+	}
+
+	propagate(heap);
+}
+
+void distance_field::build()
+{
+	dist_.assign(grid_->map().size().x()*grid_->map().size().y(), Unreachable);
+
+	std::vector<heap_entry> heap;
+	if(grid_->map().is_loc_on_map(target_)) {
+		dist_[index(target_)] = 0;
+		heap.push_back(heap_entry(0, index(target_)));
+	}
+
+	propagate(heap);
+}
+
+void distance_field::propagate(std::vector<heap_entry>& heap)
+{
+	//a Dijkstra search outwards from the target, following moves
+	//backwards: a hex is reached from its neighbour in direction n
+	//at the cost of moving from the neighbour in the opposite direction.
+	std::greater<heap_entry> cmp;
+	while(!heap.empty()) {
+		std::pop_heap(heap.begin(), heap.end(), cmp);
+		const heap_entry top = heap.back();
+		heap.pop_back();
+		if(top.first != dist_[top.second]) {
+			continue;
+		}
+
+		const hex::location loc(top.second%width_, top.second/width_);
+		hex::location adj[6];
+		hex::get_adjacent_tiles(loc, adj);
+		for(int n = 0; n != 6; ++n) {
+			if(!grid_->map().is_loc_on_map(adj[n])) {
+				continue;
+			}
+
+			const int cost = grid_->cost(adj[n], opposite(n));
+			if(cost < 0) {
+				continue;
+			}
+
+			const int i = index(adj[n]);
+			if(top.first + cost < dist_[i]) {
+				dist_[i] = top.first + cost;
+				heap.push_back(heap_entry(dist_[i], i));
+				std::push_heap(heap.begin(), heap.end(), cmp);
+			}
+		}
+	}
+}
+
+}
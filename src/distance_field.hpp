@@ -0,0 +1,70 @@
+/*
+   Copyright (C) 2007 by David White <dave.net>
+   Part of the Silver Tree Project
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 2 or later.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY.
+
+   See the COPYING file for more details.
+*/
+#ifndef DISTANCE_FIELD_HPP_INCLUDED
+#define DISTANCE_FIELD_HPP_INCLUDED
+
+#include <boost/shared_ptr.hpp>
+#include <utility>
+#include <vector>
+
+#include "movement_cost_grid.hpp"
+#include "tile_logic.hpp"
+
+namespace game_logic
+{
+
+//the cost of the cheapest route from every hex on a map to a single
+//target hex, for parties moving according to one movement_cost_grid.
+//Any number of parties heading for the same target can follow the
+//same field, instead of each searching for its own route.
+class distance_field
+{
+public:
+	distance_field(const_movement_cost_grid_ptr grid,
+	               const hex::location& target);
+
+	const hex::location& target() const { return target_; }
+	const movement_cost_grid& grid() const { return *grid_; }
+	const const_movement_cost_grid_ptr& grid_ptr() const { return grid_; }
+
+	//returns false if the map has been modified since the field was built.
+	bool is_current() const { return grid_->is_current(); }
+
+	//the cost of the cheapest route from loc to the target, or -1 if
+	//the target can't be reached from loc.
+	int distance(const hex::location& loc) const;
+
+	//moves the target of the field. If the new target is adjacent to
+	//the old one, only the hexes whose distance goes down are visited,
+	//otherwise the field is calculated again from scratch.
+	void set_target(const hex::location& target);
+
+private:
+	void build();
+	void propagate(std::vector<std::pair<int,int> >& heap);
+
+	int index(const hex::location& loc) const {
+		return loc.y()*width_ + loc.x();
+	}
+
+	const_movement_cost_grid_ptr grid_;
+	hex::location target_;
+	int width_;
+	std::vector<int> dist_;
+};
+
+typedef boost::shared_ptr<distance_field> distance_field_ptr;
+typedef boost::shared_ptr<const distance_field> const_distance_field_ptr;
+
+}
+
+#endif
@@ -12,6 +12,8 @@
 */
 #include "battle.hpp"
 #include "battle_character.hpp"
+#include "battle_character_sim.hpp"
+#include "battle_engine.hpp"
 #include "battle_map_generator.hpp"
 #include "character.hpp"
 #include "dialog.hpp"
@@ -74,8 +76,12 @@ void handle_encounter(party_ptr p1, party_ptr p2,
         }
         
         if(p1->is_human_controlled()) {
-            game_dialogs::post_battle_dialog d(p1, xp2, p2->money());
-            d.show();
+            if(!preference_headless()) {
+                game_dialogs::post_battle_dialog d(p1, xp2, p2->money());
+                d.show();
+            } else {
+                p1->award(xp2, p2->money(), p1->members());
+            }
             p2->encounter(*p1, "win_battle");
         } else {
             p2->encounter(*p1, "lose_battle");
@@ -106,8 +112,44 @@ void handle_encounter(party_ptr p1, party_ptr p2,
     }
 }
 
+namespace {
+//the longest a battle is played for when nobody is watching it.
+const int MaxHeadlessBattleTime = 10000;
+
+//plays the battle out by its rules alone, with everyone choosing their
+//moves the way non-player characters do.
+bool play_headless_battle(party_ptr p1, party_ptr p2, const std::vector<character_ptr>& c1, const std::vector<character_ptr>& c2, const hex::location& loc)
+{
+    boost::shared_ptr<const hex::gamemap> battle_map =
+        generate_battle_map(p1->game_world().map(),loc,
+                            battle_map_seed(loc));
+
+    std::vector<battle_character_ptr> chars;
+    for(std::vector<character_ptr>::const_iterator i = c1.begin(); i != c1.end(); ++i) {
+        hex::location loc(44 + i - c1.begin(),47);
+        chars.push_back(battle_character_ptr(new battle_character_sim(
+                                    *i,true,loc,hex::SOUTH,*battle_map)));
+    }
+
+    for(std::vector<character_ptr>::const_iterator i = c2.begin(); i != c2.end(); ++i) {
+        hex::location loc(44 + i - c2.begin(),53);
+        chars.push_back(battle_character_ptr(new battle_character_sim(
+                                    *i,false,loc,hex::SOUTH,*battle_map)));
+    }
+
+    battle_engine b(chars,*battle_map,rand());
+    b.simulate(MaxHeadlessBattleTime);
+    p1->game_world().record_battle(p2->is_destroyed());
+    return p2->is_destroyed();
+}
+}
+
 bool play_battle(party_ptr p1, party_ptr p2, const std::vector<character_ptr>& c1, const std::vector<character_ptr>& c2, const hex::location& loc)
 {
+    if(preference_headless()) {
+        return play_headless_battle(p1, p2, c1, c2, loc);
+    }
+
     //zoom in to the battle
     const GLfloat start_zoom = p1->game_world().camera().zoom();
     p1->game_world().renderer().reset_timing();
@@ -120,8 +162,9 @@ bool play_battle(party_ptr p1, party_ptr p2, const std::vector<character_ptr>& c
 		p1->game_world().update_camera_controller();
     }
     
-    boost::shared_ptr<hex::gamemap> battle_map =
-        generate_battle_map(p1->game_world().map(),loc);
+    boost::shared_ptr<const hex::gamemap> battle_map =
+        generate_battle_map(p1->game_world().map(),loc,
+                            battle_map_seed(loc));
     
     std::cerr << "generate map at " << loc.x() << "," << loc.y() << "\n";
     
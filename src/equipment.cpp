@@ -12,6 +12,7 @@
 */
 #include "equipment.hpp"
 #include "map_utils.hpp"
+#include "stat_id.hpp"
 #include "wml_node.hpp"
 #include "wml_utils.hpp"
 
@@ -46,6 +47,14 @@ equipment::equipment(ITEM_TYPE type, const wml::const_node_ptr& node)
 		try {
 			const int res = boost::lexical_cast<int>(i->second);
 			stats_[i->first] = res;
+			const stat_id id = intern_stat(i->first);
+			if(id >= stat_values_.size()) {
+				stat_values_.resize(id + 1);
+				has_stat_.resize(id + 1);
+			}
+
+			stat_values_[id] = res;
+			has_stat_[id] = true;
 		} catch(boost::bad_lexical_cast& e) {
 			//not an error -- anything that can't be converted to
 			//a number isn't a stat.
@@ -64,18 +73,22 @@ equipment::equipment(ITEM_TYPE type) : item(type)
 {}
 
 int equipment::modify_stat(const std::string& stat, bool *present) const
+{
+	return modify_stat(find_stat(stat), present);
+}
+
+int equipment::modify_stat(stat_id id, bool *present) const
 {
 	bool dummy;
 	if(!present) {
 		present = &dummy;
 	}
-	const std::map<std::string,int>::const_iterator i = stats_.find(stat);
-	if(i == stats_.end()) {
+	if(id < 0 || id >= has_stat_.size() || !has_stat_[id]) {
 		*present = false;
 		return 0;
 	} else {
 		*present = true;
-		return i->second;
+		return stat_values_[id];
 	}
 }
 
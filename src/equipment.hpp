@@ -18,6 +18,7 @@
 
 #include "formula.hpp"
 #include "item.hpp"
+#include "stat_id.hpp"
 #include "wml_node_fwd.hpp"
 
 namespace game_logic
@@ -32,6 +33,7 @@ public:
 	virtual item_ptr clone() const { return item_ptr(new equipment(*this)); }
 
 	int modify_stat(const std::string& stat, bool* present=NULL) const;
+	int modify_stat(stat_id id, bool* present=NULL) const;
 	const std::map<std::string,int>& stats() const { return stats_; }
 	const std::string& missile() const { return missile_; }
 	const std::string& damage_type() const { return damage_type_; }
@@ -40,6 +42,10 @@ public:
 private:
 	variant get_value(const std::string& key) const;
 	std::map<std::string,int> stats_;
+
+	//the same stats, indexed by number.
+	std::vector<int> stat_values_;
+	std::vector<bool> has_stat_;
 	std::map<std::string,int> parry_against_;
 	std::string damage_type_;
 	std::string missile_;
@@ -1,7 +1,9 @@
 #include <iostream>
+#include <map>
 
 #include "event_handler.hpp"
 #include "foreach.hpp"
+#include "formatter.hpp"
 #include "global_game_state.hpp"
 #include "party.hpp"
 #include "wml_command.hpp"
@@ -12,8 +14,45 @@
 namespace game_logic
 {
 
+namespace {
+std::map<std::string,event_id>& event_ids()
+{
+	static std::map<std::string,event_id> ids;
+	return ids;
+}
+
+std::vector<std::string>& event_names()
+{
+	static std::vector<std::string> names;
+	return names;
+}
+}
+
+event_id get_event_id(const std::string& name)
+{
+	std::map<std::string,event_id>::const_iterator i = event_ids().find(name);
+	if(i != event_ids().end()) {
+		return i->second;
+	}
+
+	const event_id id = event_names().size();
+	event_ids()[name] = id;
+	event_names().push_back(name);
+	return id;
+}
+
+const std::string& get_event_name(event_id id)
+{
+	return event_names()[id];
+}
+
+int num_event_ids()
+{
+	return event_names().size();
+}
+
 event_handler::event_handler(wml::const_node_ptr node)
-    : node_(node),
+    : has_npc_filter_(false), npc_filter_(0), node_(node),
 	  first_time_only_(wml::get_bool(node, "first_time_only", false)),
 	  already_run_(wml::get_bool(node, "already_run", false))
 {
@@ -36,9 +75,15 @@ event_handler::event_handler(wml::const_node_ptr node)
 	}
 }
 
-void event_handler::handle(const formula_callable& info, world& world)
+void event_handler::handle(const formula_callable& info, world& world,
+                           const party* npc)
 {
-	if(first_time_only_ && already_run_) {
+	if(!wants(npc)) {
+		return;
+	}
+
+	if(has_npc_filter_ && !npc &&
+	   !npc_filter_formula_->execute(info).as_bool()) {
 		return;
 	}
 
@@ -62,6 +107,30 @@ void event_handler::add_filter(formula_ptr f)
 	filters_.push_back(f);
 }
 
+void event_handler::set_npc_filter(int party_id)
+{
+	const std::string filter = formatter() << "npc.unique_id = " << party_id;
+	has_npc_filter_ = true;
+	npc_filter_ = party_id;
+	npc_filter_formula_.reset(new formula(filter));
+
+	//the filter is written out as a formula like any other.
+	wml::node_ptr node = wml::deep_copy(node_);
+	wml::node_ptr filter_node(new wml::node("filter"));
+	filter_node->set_attr("filter", filter);
+	node->add_child(filter_node);
+	node_ = node;
+}
+
+bool event_handler::wants(const party* npc) const
+{
+	if(first_time_only_ && already_run_) {
+		return false;
+	}
+
+	return !has_npc_filter_ || !npc || npc->id() == npc_filter_;
+}
+
 wml::const_node_ptr event_handler::write() const
 {
 	if(first_time_only_ && already_run_) {
@@ -1,6 +1,7 @@
 #ifndef EVENT_HANDLER_HPP_INCLUDED
 #define EVENT_HANDLER_HPP_INCLUDED
 
+#include <string>
 #include <vector>
 
 #include "formula.hpp"
@@ -10,19 +11,43 @@
 namespace game_logic
 {
 
+class party;
 class world;
 
+//events are known by ids, handed out as their names are first seen, so
+//that firing one doesn't need its name looked up.
+typedef int event_id;
+event_id get_event_id(const std::string& name);
+const std::string& get_event_name(event_id id);
+int num_event_ids();
+
 class event_handler
 {
 public:
 	explicit event_handler(wml::const_node_ptr node);
-	void handle(const formula_callable& info, world& world);
+
+	//npc is the npc party the event involves, if the caller knows it.
+	void handle(const formula_callable& info, world& world,
+	            const party* npc=NULL);
 
 	void add_filter(formula_ptr f);
+
+	//makes the handler handle only events involving the npc party with
+	//the given id. When the party is known this is checked without
+	//running a formula, or making a callable to run it on.
+	void set_npc_filter(int party_id);
+
+	//whether handling an event involving npc would do anything. If npc
+	//is NULL, whether it might.
+	bool wants(const party* npc) const;
+
 	wml::const_node_ptr write() const;
 
 private:
 	std::vector<formula_ptr> filters_;
+	bool has_npc_filter_;
+	int npc_filter_;
+	formula_ptr npc_filter_formula_;
 	std::vector<const_wml_command_ptr> commands_;
 	wml::const_node_ptr node_;
 	bool first_time_only_;
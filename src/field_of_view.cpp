@@ -0,0 +1,480 @@
+/*
+   Copyright (C) 2007 by David White <dave.net>
+   Part of the Silver Tree Project
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 2 or later.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY.
+
+   See the COPYING file for more details.
+*/
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+
+#include "field_of_view.hpp"
+#include "gamemap.hpp"
+#include "threading.hpp"
+#include "tile.hpp"
+
+#ifdef UNIT_TEST_FIELD_OF_VIEW
+#include "SDL.h"
+#include "filesystem.hpp"
+#include "foreach.hpp"
+#endif
+
+namespace hex
+{
+
+namespace {
+
+//a tile a line of sight passes through, relative to where it starts.
+struct line_step {
+	int x, y;
+	double enter, exit;
+};
+
+//the tiles on the line of sight from a tile to every tile around it.
+//tile_line visits the same tiles with the same fractions for lines
+//moved by any number of rows or an even number of columns, so one set
+//of lines is enough for all tiles in even columns, and one for all tiles
+//in odd columns.
+struct line_template {
+	line_template() : radius(-1)
+	{}
+
+	int radius;
+	std::vector<line_step> steps;
+
+	//the lines run from steps[begin[n]] to steps[begin[n+1]], where n is
+	//the index of the target in a square of side radius*2+1 around the
+	//start of the line.
+	std::vector<int> begin;
+};
+
+typedef boost::shared_ptr<const line_template> const_line_template_ptr;
+
+//fields of view may be calculated on any thread. A template is never
+//changed once it's been handed out, only replaced by a bigger one, so
+//the lock is only held to look it up or to replace it.
+threading::mutex templates_mutex;
+const_line_template_ptr templates[2];
+
+const_line_template_ptr get_line_template(int parity, int radius)
+{
+	{
+		threading::lock l(templates_mutex);
+		if(templates[parity] && templates[parity]->radius >= radius) {
+			return templates[parity];
+		}
+	}
+
+	boost::shared_ptr<line_template> ptr(new line_template);
+	line_template& res = *ptr;
+	res.radius = radius;
+
+	//start far enough from the edge of the map that no lines pass through
+	//negative rows or columns.
+	const location base(radius*2 + 2 + parity, radius*2 + 2);
+	for(int y = -radius; y <= radius; ++y) {
+		for(int x = -radius; x <= radius; ++x) {
+			res.begin.push_back(res.steps.size());
+			const location target(base.x() + x, base.y() + y);
+			if(distance_between(base, target) > radius) {
+				continue;
+			}
+
+			for(tile_line line(base, target); !line.done(); line.next()) {
+				if(line.loc() == target) {
+					break;
+				}
+
+				line_step step;
+				step.x = line.loc().x() - base.x();
+				step.y = line.loc().y() - base.y();
+				step.enter = line.enter();
+				step.exit = line.exit();
+				assert(std::abs(step.x) <= radius + 1 &&
+				       std::abs(step.y) <= radius + 1);
+				res.steps.push_back(step);
+			}
+		}
+	}
+
+	res.begin.push_back(res.steps.size());
+
+	threading::lock l(templates_mutex);
+	if(!templates[parity] || templates[parity]->radius < radius) {
+		templates[parity] = ptr;
+	}
+
+	return ptr;
+}
+
+//from this radius up, the set of visible locations is updated rather
+//than built again, since most of it stays the same after a move to an
+//adjacent tile. Below it, comparing the old and new sets costs more
+//than it saves.
+const int IncrementalRadius = 10;
+
+//whether loc is in the set of visible locations of a field of view.
+bool in_visible_locs(const location& loc, const location& center,
+                     int radius, int limit, const std::vector<bool>& visible)
+{
+	if(radius < 0) {
+		return false;
+	}
+
+	if(loc == center) {
+		return true;
+	}
+
+	const int x = loc.x() - center.x() + radius;
+	const int y = loc.y() - center.y() + radius;
+	const int width = radius*2 + 1;
+	return x >= 0 && y >= 0 && x < width && y < width &&
+	       visible[y*width + x] && distance_between(center, loc) <= limit;
+}
+
+}
+
+field_of_view::field_of_view()
+  : map_(NULL), revision_(0), radius_(0), locs_stale_(false),
+    locs_radius_(-1), locs_limit_(0)
+{
+}
+
+void field_of_view::calculate(const gamemap& map, const location& center,
+                              int radius)
+{
+	map_ = &map;
+	revision_ = map.revision();
+	center_ = center;
+	radius_ = radius;
+	dim_ = map.size();
+	locs_stale_ = true;
+
+	const int width = radius*2 + 1;
+	visible_.assign(width*width, false);
+	if(!map.is_loc_on_map(center)) {
+		return;
+	}
+
+	//lines of sight to tiles inside the radius may pass through tiles
+	//just outside of it.
+	const int margin = radius + 1;
+	const int height_width = margin*2 + 1;
+	heights_.resize(height_width*height_width);
+	GLfloat highest = 0.0;
+	bool first = true;
+	for(int y = -margin; y <= margin; ++y) {
+		for(int x = -margin; x <= margin; ++x) {
+			const location loc(center.x() + x, center.y() + y);
+			if(map.is_loc_on_map(loc)) {
+				const GLfloat h = map.vision_height(loc);
+				heights_[(y + margin)*height_width + x + margin] = h;
+				if(first || h > highest) {
+					highest = h;
+					first = false;
+				}
+			}
+		}
+	}
+
+	const const_line_template_ptr template_ptr =
+	                     get_line_template(center.x()%2, radius);
+	const line_template& lines = *template_ptr;
+	const int lines_width = lines.radius*2 + 1;
+
+	//the same test gamemap::tile_in_the_way() makes, on the same tiles.
+	const GLfloat h1 = tile::translate_height(map.height(center)+3);
+	for(int y = -radius; y <= radius; ++y) {
+		for(int x = -radius; x <= radius; ++x) {
+			const location target(center.x() + x, center.y() + y);
+			if(!map.is_loc_on_map(target) ||
+			   distance_between(center, target) > radius) {
+				continue;
+			}
+
+			//the line is never lower than both of its ends, so nothing
+			//can be in the way if they're both as high as everything
+			//around the center.
+			const GLfloat h2 = tile::translate_height(map.height(target)+3);
+			if(h1 >= highest && h2 >= highest) {
+				visible_[(y + radius)*width + x + radius] = true;
+				continue;
+			}
+
+			const int n = (y + lines.radius)*lines_width + x + lines.radius;
+			bool blocked = false, off_map = false;
+			for(int i = lines.begin[n]; i != lines.begin[n+1]; ++i) {
+				const line_step& step = lines.steps[i];
+				const int sx = center.x() + step.x;
+				const int sy = center.y() + step.y;
+				if(sx < 0 || sy < 0 || sx >= dim_.x() || sy >= dim_.y()) {
+					off_map = true;
+					break;
+				}
+
+				const GLfloat lowest = h2 > h1 ? h1 + (h2 - h1)*step.enter
+				                               : h1 + (h2 - h1)*step.exit;
+				if(heights_[(step.y + margin)*height_width + step.x + margin] > lowest) {
+					blocked = true;
+					break;
+				}
+			}
+
+			//lines running along the top edge of the map are rounded
+			//onto the map, rather than off it, so they don't follow the
+			//template. There are few enough of them to ask the map.
+			if(off_map) {
+				blocked = !map.has_line_of_sight(center, target);
+			}
+
+			visible_[(y + radius)*width + x + radius] = !blocked;
+		}
+	}
+}
+
+bool field_of_view::is_current(const gamemap& map) const
+{
+	return map_ == &map && revision_ == map.revision();
+}
+
+const std::set<location>& field_of_view::visible_locs() const
+{
+	if(!locs_stale_) {
+		return locs_;
+	}
+
+	locs_stale_ = false;
+	if(radius_ < IncrementalRadius) {
+		locs_radius_ = -1;
+		locs_.clear();
+		locs_.insert(center_);
+	}
+
+	//find the last ring the set reaches, adding what's in each ring
+	//unless the set is to be updated. A ring counts as having something
+	//visible in it if any of it is off the map.
+	int limit = 0;
+	bool found = true;
+	std::vector<location> ring;
+	while(found && limit + 1 < radius_) {
+		++limit;
+		found = false;
+		ring.clear();
+		get_tile_ring(center_, limit, ring);
+		for(std::vector<location>::const_iterator i = ring.begin();
+		    i != ring.end(); ++i) {
+			if(i->x() < 0 || i->y() < 0 || i->x() >= dim_.x() ||
+			   i->y() >= dim_.y()) {
+				found = true;
+			} else if(is_visible(*i)) {
+				found = true;
+				if(radius_ < IncrementalRadius) {
+					locs_.insert(*i);
+				}
+			}
+		}
+	}
+
+	if(radius_ < IncrementalRadius) {
+		return locs_;
+	}
+
+	//only remove what's no longer in the set and add what's new.
+	if(locs_radius_ < 0) {
+		locs_.clear();
+	}
+
+	for(int x = locs_center_.x() - locs_limit_;
+	    x <= locs_center_.x() + locs_limit_ && locs_radius_ >= 0; ++x) {
+		for(int y = locs_center_.y() - locs_limit_;
+		    y <= locs_center_.y() + locs_limit_; ++y) {
+			const location loc(x, y);
+			if(in_visible_locs(loc, locs_center_, locs_radius_,
+			                   locs_limit_, locs_visible_) &&
+			   !in_visible_locs(loc, center_, radius_, limit, visible_)) {
+				locs_.erase(loc);
+			}
+		}
+	}
+
+	for(int x = center_.x() - limit; x <= center_.x() + limit; ++x) {
+		for(int y = center_.y() - limit; y <= center_.y() + limit; ++y) {
+			const location loc(x, y);
+			if(in_visible_locs(loc, center_, radius_, limit, visible_) &&
+			   !in_visible_locs(loc, locs_center_, locs_radius_,
+			                    locs_limit_, locs_visible_)) {
+				locs_.insert(loc);
+			}
+		}
+	}
+
+	locs_center_ = center_;
+	locs_radius_ = radius_;
+	locs_limit_ = limit;
+	locs_visible_ = visible_;
+
+	return locs_;
+}
+
+#ifdef UNIT_TEST_FIELD_OF_VIEW
+
+namespace {
+
+//the way parties used to find the tiles they could see.
+void ray_visible_locs(const gamemap& m, const location& center, int range,
+                      std::set<location>& res)
+{
+	res.clear();
+	res.insert(center);
+	bool found = true;
+	for(int radius = 1; found && radius < range; ++radius) {
+		found = false;
+		std::vector<location> locs;
+		get_tile_ring(center, radius, locs);
+		foreach(const location& loc, locs) {
+			if(m.has_line_of_sight(center, loc)) {
+				found = true;
+				if(m.is_loc_on_map(loc)) {
+					res.insert(loc);
+				}
+			}
+		}
+	}
+}
+
+}
+
+void unit_test_field_of_view()
+{
+	const gamemap m(sys::read_file("data/maps/island1"));
+
+	std::vector<location> centers;
+	for(int x = 0; x < m.size().x(); x += 7) {
+		for(int y = 0; y < m.size().y(); y += 7) {
+			centers.push_back(location(x,y));
+		}
+	}
+
+	//include the edges of the map, where lines are rounded differently.
+	for(int x = 0; x < m.size().x(); ++x) {
+		centers.push_back(location(x,0));
+		centers.push_back(location(x,m.size().y()-1));
+	}
+
+	const int radii[] = {5, 10, 20};
+	field_of_view fov;
+	foreach(int radius, radii) {
+		int visible = 0, lines = 0;
+		foreach(const location& center, centers) {
+			fov.calculate(m, center, radius);
+			assert(fov.is_current(m));
+			std::vector<location> locs;
+			get_locations_in_radius(center, radius + 1, locs);
+			foreach(const location& loc, locs) {
+				if(!m.is_loc_on_map(loc) ||
+				   distance_between(center, loc) > radius) {
+					assert(!fov.is_visible(loc));
+					continue;
+				}
+
+				const bool los = m.has_line_of_sight(center, loc);
+				assert(fov.is_visible(loc) == los);
+				visible += los;
+				++lines;
+			}
+		}
+
+		const int repeats = 5;
+		int start = SDL_GetTicks();
+		for(int r = 0; r != repeats; ++r) {
+			foreach(const location& center, centers) {
+				fov.calculate(m, center, radius);
+			}
+		}
+
+		const int fov_ms = SDL_GetTicks() - start;
+		start = SDL_GetTicks();
+		for(int r = 0; r != repeats; ++r) {
+			foreach(const location& center, centers) {
+				std::vector<location> locs;
+				get_locations_in_radius(center, radius, locs);
+				foreach(const location& loc, locs) {
+					m.has_line_of_sight(center, loc);
+				}
+			}
+		}
+
+		const int rays_ms = SDL_GetTicks() - start;
+		const double count = repeats*centers.size();
+		std::cerr << "field of view: radius " << radius << ": "
+		          << visible << "/" << lines << " tiles visible; "
+		          << (fov_ms*1000.0/count) << "us per field of view, "
+		          << (rays_ms*1000.0/count) << "us casting rays\n";
+	}
+
+	//walk across the map and back, a tile at a time, the way a party
+	//would, finding what can be seen after every step.
+	std::vector<location> walk;
+	for(tile_line line(location(1,1), location(m.size().x()-2, m.size().y()-2));
+	    !line.done(); line.next()) {
+		walk.push_back(line.loc());
+	}
+
+	for(tile_line line(location(m.size().x()-2, 1), location(1, m.size().y()-2));
+	    !line.done(); line.next()) {
+		walk.push_back(line.loc());
+	}
+
+	foreach(int radius, radii) {
+		field_of_view moving;
+		std::set<location> rays;
+		foreach(const location& loc, walk) {
+			moving.calculate(m, loc, radius);
+			ray_visible_locs(m, loc, radius, rays);
+			assert(moving.visible_locs() == rays);
+		}
+
+		const int repeats = 50;
+		int start = SDL_GetTicks();
+		for(int r = 0; r != repeats; ++r) {
+			foreach(const location& loc, walk) {
+				moving.calculate(m, loc, radius);
+				moving.visible_locs();
+			}
+		}
+
+		const int moving_ms = SDL_GetTicks() - start;
+		start = SDL_GetTicks();
+		for(int r = 0; r != repeats; ++r) {
+			foreach(const location& loc, walk) {
+				ray_visible_locs(m, loc, radius, rays);
+			}
+		}
+
+		const int rays_ms = SDL_GetTicks() - start;
+		const double steps = repeats*walk.size();
+		std::cerr << "field of view: radius " << radius << ": per step "
+		          << (moving_ms*1000.0/steps) << "us, "
+		          << (rays_ms*1000.0/steps) << "us casting rays\n";
+	}
+
+	//the set must also be right when the radius changes between
+	//updating it and building it again.
+	field_of_view changing;
+	std::set<location> rays;
+	for(int n = 0; n != walk.size(); ++n) {
+		const int radius = radii[n%3];
+		changing.calculate(m, walk[n], radius);
+		ray_visible_locs(m, walk[n], radius, rays);
+		assert(changing.visible_locs() == rays);
+	}
+}
+
+#endif
+
+}
@@ -0,0 +1,98 @@
+/*
+   Copyright (C) 2007 by David White <dave.net>
+   Part of the Silver Tree Project
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 2 or later.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY.
+
+   See the COPYING file for more details.
+*/
+#ifndef FIELD_OF_VIEW_HPP_INCLUDED
+#define FIELD_OF_VIEW_HPP_INCLUDED
+
+#include <boost/shared_ptr.hpp>
+#include <GL/glew.h>
+#include <set>
+#include <vector>
+
+#include "tile_logic.hpp"
+
+namespace hex
+{
+
+class gamemap;
+
+//the tiles on a map within some radius of a tile which can be seen from
+//it. A tile is visible exactly when gamemap::has_line_of_sight() says it
+//is, but the tiles each line of sight passes through are only worked out
+//once for every radius, and then reused for every field of view.
+class field_of_view
+{
+public:
+	field_of_view();
+
+	//calculates the field of view from center. Every tile is looked at
+	//again, since moving the center changes every line of sight, but the
+	//buffers are reused, and for larger radii the set returned by
+	//visible_locs() is brought up to date rather than built again, so
+	//it's cheapest to keep using the same field of view for a moving
+	//viewpoint.
+	void calculate(const gamemap& map, const location& center, int radius);
+
+	const location& center() const { return center_; }
+	int radius() const { return radius_; }
+
+	//returns true if this field of view was calculated on the given map,
+	//and the map hasn't been modified since.
+	bool is_current(const gamemap& map) const;
+
+	//returns false for tiles off the map or outside the radius.
+	bool is_visible(const location& loc) const {
+		const int x = loc.x() - center_.x() + radius_;
+		const int y = loc.y() - center_.y() + radius_;
+		const int width = radius_*2 + 1;
+		return x >= 0 && y >= 0 && x < width && y < width &&
+		       visible_[y*width + x];
+	}
+
+	//the center, and the visible tiles in each ring around it out to the
+	//first ring with nothing visible in it, stopping short of the radius.
+	const std::set<location>& visible_locs() const;
+
+private:
+	const gamemap* map_;
+	int revision_;
+	location center_;
+	int radius_;
+
+	location dim_;
+	std::vector<bool> visible_;
+
+	//made from visible_ the first time it's asked for after each
+	//calculation.
+	mutable std::set<location> locs_;
+	mutable bool locs_stale_;
+
+	//what the set was last brought up to date with, if it was updated
+	//rather than built again.
+	mutable location locs_center_;
+	mutable int locs_radius_, locs_limit_;
+	mutable std::vector<bool> locs_visible_;
+
+	//the height of the terrain that blocks vision on each tile around the
+	//center, reused between calculations.
+	std::vector<GLfloat> heights_;
+};
+
+typedef boost::shared_ptr<field_of_view> field_of_view_ptr;
+typedef boost::shared_ptr<const field_of_view> const_field_of_view_ptr;
+
+#ifdef UNIT_TEST_FIELD_OF_VIEW
+void unit_test_field_of_view();
+#endif
+
+}
+
+#endif
@@ -12,6 +12,7 @@
 */
 #include "filesystem.hpp"
 
+#include <cstdio>
 #include <fstream>
 #include <sstream>
 
@@ -536,4 +537,19 @@ void write_file(const std::string& fname, const std::string& data)
 	file << data;
 }
 
+time_t file_mod_time(const std::string& fname)
+{
+	struct stat st;
+	if(::stat(fname.c_str(), &st) != 0) {
+		return 0;
+	}
+
+	return st.st_mtime;
+}
+
+bool remove_file(const std::string& fname)
+{
+	return std::remove(fname.c_str()) == 0;
+}
+
 }
@@ -13,6 +13,7 @@
 #ifndef FILESYSTEM_HPP_INCLUDED
 #define FILESYSTEM_HPP_INCLUDED
 
+#include <ctime>
 #include <string>
 #include <vector>
 #include <stdexcept>
@@ -52,6 +53,12 @@ void write_file(const std::string& fname, const std::string& data);
 bool file_exists(const std::string& fname);
 std::string find_file(const std::string& name);
 
+//returns when the file was last written to, or 0 if it doesn't exist.
+time_t file_mod_time(const std::string& fname);
+
+//deletes the file, and returns false if it couldn't be deleted.
+bool remove_file(const std::string& fname);
+
 }
 
 #endif
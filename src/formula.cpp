@@ -46,6 +46,11 @@ map_formula_callable& map_formula_callable::add(const std::string& key,
 	return *this;
 }
 
+void map_formula_callable::clear()
+{
+	values_.clear();
+}
+
 variant map_formula_callable::get_value(const std::string& key) const
 {
 	return map_get_value_default(values_, key,
@@ -49,6 +49,9 @@ class map_formula_callable : public formula_callable {
 public:
 	explicit map_formula_callable(const formula_callable* fallback=NULL);
 	map_formula_callable& add(const std::string& key, const variant& value);
+
+	//removes everything added, releasing any references it held.
+	void clear();
 private:
 	variant get_value(const std::string& key) const;
 	void get_inputs(std::vector<formula_input>* inputs) const;
@@ -1,5 +1,8 @@
+#include <vector>
+
 #include "formula.hpp"
 #include "formula_registry.hpp"
+#include "stat_id.hpp"
 #include "wml_node.hpp"
 #include "wml_utils.hpp"
 
@@ -8,7 +11,8 @@ namespace formula_registry
 using namespace game_logic;
 
 namespace {
-typedef std::map<std::string,ptr> formula_map;
+//formulas indexed by the stat they are for.
+typedef std::vector<ptr> formula_map;
 formula_map stat_calculation;
 formula_map strength_penalty;
 formula_map fatigue_penalty;
@@ -17,20 +21,31 @@ formula_map height_advantage;
 ptr track_formula;
 
 const ptr NullFormula;
+
+void add_formula(formula_map& m, const std::string& stat,
+                 const std::string& str)
+{
+	const stat_id id = intern_stat(stat);
+	if(id >= m.size()) {
+		m.resize(id + 1);
+	}
+
+	m[id] = ptr(new formula(str));
+}
 }
 
 void load(const wml::const_node_ptr& node)
 {
 	for(wml::node::const_attr_iterator i = node->begin_attr();
 	    i != node->end_attr(); ++i) {
-		stat_calculation[i->first] = ptr(new formula(i->second));
+		add_formula(stat_calculation, i->first, i->second);
 	}
 
 	wml::const_node_ptr penalties = node->get_child("ideal_strength_penalties");
 	if(penalties) {
 		for(wml::node::const_attr_iterator i = penalties->begin_attr();
 		    i != penalties->end_attr(); ++i) {
-			strength_penalty[i->first] = ptr(new formula(i->second));
+			add_formula(strength_penalty, i->first, i->second);
 		}
 	}
 
@@ -38,7 +53,7 @@ void load(const wml::const_node_ptr& node)
 	if(penalties) {
 		for(wml::node::const_attr_iterator i = penalties->begin_attr();
 		    i != penalties->end_attr(); ++i) {
-			fatigue_penalty[i->first] = ptr(new formula(i->second));
+			add_formula(fatigue_penalty, i->first, i->second);
 		}
 	}
 
@@ -46,7 +61,7 @@ void load(const wml::const_node_ptr& node)
 	if(height) {
 		for(wml::node::const_attr_iterator i = height->begin_attr();
 		    i != height->end_attr(); ++i) {
-			height_advantage[i->first] = ptr(new formula(i->second));
+			add_formula(height_advantage, i->first, i->second);
 		}
 	}
 
@@ -64,13 +79,15 @@ const ptr& get_track_formula()
 }
 
 #define FORMULA_ACCESSOR(name) \
-const ptr& get_##name(const std::string& key) { \
-	const formula_map::const_iterator itor = name.find(key); \
-	if(itor != name.end()) { \
-		return itor->second; \
+const ptr& get_##name(stat_id id) { \
+	if(id >= 0 && id < name.size()) { \
+		return name[id]; \
 	} else { \
 		return NullFormula; \
 	} \
+} \
+const ptr& get_##name(const std::string& key) { \
+	return get_##name(find_stat(key)); \
 }
 
 FORMULA_ACCESSOR(stat_calculation);
@@ -4,12 +4,20 @@
 #include <string>
 
 #include "formula_fwd.hpp"
+#include "stat_id.hpp"
 #include "wml_node_fwd.hpp"
 
 namespace formula_registry
 {
 typedef game_logic::const_formula_ptr ptr;
 void load(const wml::const_node_ptr& node);
+
+//the formulas for a stat, looked up by number or, for stats named in
+//formulas and WML, by name.
+const ptr& get_stat_calculation(game_logic::stat_id id);
+const ptr& get_strength_penalty(game_logic::stat_id id);
+const ptr& get_fatigue_penalty(game_logic::stat_id id);
+const ptr& get_height_advantage(game_logic::stat_id id);
 const ptr& get_stat_calculation(const std::string& key);
 const ptr& get_strength_penalty(const std::string& key);
 const ptr& get_fatigue_penalty(const std::string& key);
@@ -15,11 +15,19 @@
 #include "string_utils.hpp"
 #include "terrain_feature.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <iostream>
 #include <sstream>
 
+#include "foreach.hpp"
+
+#ifdef UNIT_TEST_LINE_OF_SIGHT
+#include "filesystem.hpp"
+#include "SDL.h"
+#endif
+
 namespace hex
 {
 
@@ -27,14 +35,14 @@ namespace {
 const int cliff_height = 10;
 }
 
-gamemap::gamemap(const std::string& data)
+gamemap::gamemap(const std::string& data) : revision_(0)
 {
 	parse(data);
 }
 
 gamemap::gamemap(const std::vector<tile>& tiles,
                  const location& dim)
-  : map_(tiles), dim_(dim)
+  : map_(tiles), dim_(dim), revision_(0)
 {
 	assert(dim_.x()*dim_.y() == map_.size());
 	init_tiles();
@@ -44,6 +52,7 @@ void gamemap::copy_from(const gamemap& m)
 {
 	map_ = m.map_;
 	dim_ = m.dim_;
+	++revision_;
 
 	assert(dim_.x()*dim_.y() == map_.size());
 	init_tiles();
@@ -69,6 +78,18 @@ bool gamemap::is_loc_on_map(const location& loc) const
 	       loc.x() < dim_.x() && loc.y() < dim_.y();
 }
 
+const_base_terrain_ptr gamemap::terrain(const location& loc) const
+{
+	const int n = terrains_[index(loc)];
+	return n ? base_terrain::get_by_index(n - 1) : const_base_terrain_ptr();
+}
+
+const_terrain_feature_ptr gamemap::feature(const location& loc) const
+{
+	const int n = features_[index(loc)];
+	return n ? terrain_feature::get_by_index(n - 1) : const_terrain_feature_ptr();
+}
+
 const tile* gamemap::closest_tile(GLfloat* xloc, GLfloat* yloc, bool return_null_outside_border) const
 {
 	GLfloat& x = *xloc;
@@ -200,6 +221,46 @@ void gamemap::init_tiles()
 	    i != map_.end(); ++i) {
 		i->init_particles();
 	}
+
+	init_terrain();
+}
+
+void gamemap::init_terrain()
+{
+	const int size = map_.size();
+	heights_.resize(size);
+	terrains_.resize(size);
+	features_.resize(size);
+	vision_heights_.resize(size);
+	cliffs_.resize(size);
+	passable_.resize(size);
+	for(std::vector<tile>::const_iterator i = map_.begin();
+	    i != map_.end(); ++i) {
+		update_terrain(i->loc());
+	}
+}
+
+void gamemap::update_terrain(const location& loc)
+{
+	const int n = index(loc);
+	const tile& t = map_[n];
+	heights_[n] = t.height();
+	terrains_[n] = t.terrain() ? t.terrain()->index() + 1 : 0;
+	features_[n] = t.feature() ? t.feature()->index() + 1 : 0;
+	assert(t.terrain() == terrain(loc) && t.feature() == feature(loc));
+	vision_heights_[n] = t.height_at_point_vision(tile::translate_x(loc),
+	                                              tile::translate_y(loc));
+	cliffs_[n] = 0;
+	passable_[n] = 0;
+	for(int dir = 0; dir != 6; ++dir) {
+		if(t.has_cliff(static_cast<DIRECTION>(dir))) {
+			cliffs_[n] |= 1 << dir;
+		}
+
+		if(t.is_passable(static_cast<DIRECTION>(dir))) {
+			passable_[n] |= 1 << dir;
+		}
+	}
 }
 
 void gamemap::draw() const
@@ -223,6 +284,7 @@ void gamemap::adjust_height(const hex::location& loc, int adjust)
 	const unsigned int index = loc.y()*dim_.x() + loc.x();
 	assert(index < map_.size());
 	map_[index].adjust_height(adjust);
+	++revision_;
 	hex::location locs[7];
 	get_adjacent_tiles(loc,&locs[1]);
 	locs[0] = loc;
@@ -276,6 +338,16 @@ void gamemap::adjust_height(const hex::location& loc, int adjust)
 			t.init_normals();
 		}
 	}
+
+	//whether a tile can be left in a direction depends on cliffs on the
+	//tile it leads to, so tiles two away are affected too.
+	std::vector<location> affected;
+	get_locations_in_radius(loc, 2, affected);
+	foreach(const location& a, affected) {
+		if(is_loc_on_map(a)) {
+			update_terrain(a);
+		}
+	}
 }
 
 void gamemap::set_terrain(const hex::location& loc, const std::string& terrain_id)
@@ -283,6 +355,8 @@ void gamemap::set_terrain(const hex::location& loc, const std::string& terrain_i
 	const unsigned int index = loc.y()*dim_.x() + loc.x();
 	assert(index < map_.size());
 	map_[index].set_terrain(terrain_id);
+	update_terrain(loc);
+	++revision_;
 	hex::location adj[6];
 	get_adjacent_tiles(loc,adj);
 	for(int n = 0; n != 6; ++n) {
@@ -299,6 +373,8 @@ void gamemap::set_feature(const hex::location& loc, const std::string& feature_i
 	const unsigned int index = loc.y()*dim_.x() + loc.x();
 	assert(index < map_.size());
 	map_[index].set_feature(feature_id);
+	update_terrain(loc);
+	++revision_;
 }
 
 bool gamemap::has_line_of_sight(const location& a, const location& b, 
@@ -315,8 +391,62 @@ location gamemap::tile_in_the_way(const location& a, const location& b,
         return location();
     }
     
-    const tile& t1 = get_tile(a);
-    const tile& t2 = get_tile(b);
+    //the line runs between points just above the center of each tile.
+    const GLfloat h1 = tile::translate_height(height(a)+3);
+    const GLfloat h2 = tile::translate_height(height(b)+3);
+    
+    const GLfloat xdiff = tile::translate_x(b) - tile::translate_x(a);
+    const GLfloat ydiff = tile::translate_y(b) - tile::translate_y(a);
+    const GLfloat distance = std::sqrt(xdiff*xdiff + ydiff*ydiff);
+    
+    //visit every tile the line passes through. A tile is in the way if
+    //the line passes below the top of it anywhere inside it, and since the
+    //line is straight, it's lowest at one end of the part inside the tile.
+    //A tile on the way is out of range if any of it that the line passes
+    //through is, and b is in range if the line reaches it within range.
+    //This is what sampling points along the line, the way lines of sight
+    //used to be found, gives as the samples are made closer together.
+    for(tile_line line(a, b); !line.done(); line.next()) {
+        const location& loc = line.loc();
+        if(loc == b) {
+            if(range != -1 && distance*line.enter() > range) {
+                return loc;
+            }
+            
+            break;
+        }
+        
+        if(range != -1 && distance*line.exit() > range) {
+            return loc;
+        }
+        
+        if(tiles != NULL) {
+            tiles->push_back(loc);
+        }
+        
+        const GLfloat lowest = h2 > h1 ? h1 + (h2 - h1)*line.enter()
+                                       : h1 + (h2 - h1)*line.exit();
+        if(vision_height(loc) > lowest) {
+            return loc;
+        }
+    }
+    
+    return location();
+}
+
+#ifdef UNIT_TEST_LINE_OF_SIGHT
+
+namespace {
+
+//the way tile_in_the_way used to find the tiles on the line, by sampling
+//points along it, spacing tiles apart. It used to sample every half a
+//tile. Kept to compare against.
+location sampled_tile_in_the_way(const gamemap& m, const location& a,
+                                 const location& b, int range,
+                                 GLfloat spacing=0.5)
+{
+    const tile& t1 = m.get_tile(a);
+    const tile& t2 = m.get_tile(b);
     
     const GLfloat x1 = tile::translate_x(a);
     const GLfloat y1 = tile::translate_y(a);
@@ -326,23 +456,11 @@ location gamemap::tile_in_the_way(const location& a, const location& b,
     const GLfloat y2 = tile::translate_y(b);
     const GLfloat h2 = tile::translate_height(t2.height()+3);
     
-    const GLfloat distance = std::sqrt((x2-x1)*(x2-x1) + (y2-y1)*(y2-y1));
-    
-    {
-        GLfloat x = x1;
-        GLfloat y = y1;
-        assert(closest_tile(&x,&y) == &t1);
-        x = x2;
-        y = y2;
-        assert(closest_tile(&x,&y) == &t2);
-    }
-    
     const GLfloat xdiff = x2 - x1;
     const GLfloat ydiff = y2 - y1;
     const GLfloat dist = std::sqrt(xdiff*xdiff + ydiff*ydiff);
-    const GLfloat increment = 0.5/dist;
+    const GLfloat increment = spacing/dist;
     
-    assert(increment > 0.0);
     for(GLfloat step = 0.0; step < 1.0; step += increment) {
         const GLfloat scale1 = (1.0 - step);
         const GLfloat scale2 = step;
@@ -353,8 +471,9 @@ location gamemap::tile_in_the_way(const location& a, const location& b,
         GLfloat xloc = x;
         GLfloat yloc = y;
         
-        const tile* t = closest_tile(&xloc,&yloc);
-        if(t == NULL || (range != -1 && distance*step > range)) {
+        const tile* t = m.closest_tile(&xloc,&yloc);
+        assert(t);
+        if(range != -1 && dist*step > range) {
             return t->loc();
         }
         
@@ -362,13 +481,7 @@ location gamemap::tile_in_the_way(const location& a, const location& b,
             break;
         }
         
-        if(tiles != NULL && 
-           (tiles->empty() || tiles->back() != t->loc())) {
-            tiles->push_back(t->loc());
-        }
-        
-        const GLfloat hapv = t->height_at_point_vision(x,y);
-        if(hapv > h) {
+        if(t->height_at_point_vision(x,y) > h) {
             return t->loc();
         }
     }
@@ -376,4 +489,174 @@ location gamemap::tile_in_the_way(const location& a, const location& b,
     return location();
 }
 
+//whether the exact line and the line sampled every spacing tiles could
+//fairly disagree about the line from a to b, where one of them stops at
+//stop1 and the other at stop2. Where the two first part ways, the height
+//or range test is too close to call, the line only clips a tile for so
+//short a way that samples can step over it, or it runs along the border
+//between two tiles, so rounding decides which one it's in.
+bool close_call(const gamemap& m, const location& a, const location& b,
+                int range, GLfloat spacing,
+                const location& stop1, const location& stop2)
+{
+    const GLfloat h1 = tile::translate_height(m.get_tile(a).height()+3);
+    const GLfloat h2 = tile::translate_height(m.get_tile(b).height()+3);
+    const GLfloat xdiff = tile::translate_x(b) - tile::translate_x(a);
+    const GLfloat ydiff = tile::translate_y(b) - tile::translate_y(a);
+    const GLfloat distance = std::sqrt(xdiff*xdiff + ydiff*ydiff);
+    const GLfloat y1 = tile::translate_y(a);
+    
+    std::vector<location> locs;
+    std::vector<GLfloat> enters, exits;
+    int parted = -1;
+    for(tile_line line(a, b); !line.done(); line.next()) {
+        if(parted == -1 && (line.loc() == stop1 || line.loc() == stop2)) {
+            parted = locs.size();
+        }
+        
+        locs.push_back(line.loc());
+        enters.push_back(line.enter());
+        exits.push_back(line.exit());
+    }
+    
+    //if neither stops on the line, the sampled line has strayed off it.
+    int begin = 0, end = locs.size();
+    if(parted != -1) {
+        begin = std::max(0, parted - 1);
+        end = std::min<int>(locs.size(), parted + 2);
+    }
+    
+    //between two samples the height of the line changes by this much.
+    const GLfloat height_step = std::fabs(h2 - h1)*spacing/distance + 0.001;
+    for(int n = begin; n != end; ++n) {
+        if((n == parted && (exits[n] - enters[n])*distance <= spacing) ||
+           (range != -1 && std::fabs(distance*enters[n] - range) <= spacing) ||
+           (range != -1 && std::fabs(distance*exits[n] - range) <= spacing)) {
+            return true;
+        }
+        
+        const GLfloat center = tile::translate_y(locs[n]);
+        const GLfloat enter_y = y1 + ydiff*enters[n] - center;
+        const GLfloat exit_y = y1 + ydiff*exits[n] - center;
+        if(std::fabs(std::fabs(enter_y) - 0.5) < 0.001 &&
+           std::fabs(enter_y - exit_y) < 0.001) {
+            return true;
+        }
+        
+        const GLfloat vision = m.get_tile(locs[n]).height_at_point_vision(0, 0);
+        const GLfloat enter = h1 + (h2 - h1)*enters[n];
+        const GLfloat exit = h1 + (h2 - h1)*exits[n];
+        if(locs[n] != b && (std::fabs(vision - enter) <= height_step ||
+                            std::fabs(vision - exit) <= height_step)) {
+            return true;
+        }
+    }
+    
+    return false;
+}
+}
+
+void unit_test_line_of_sight()
+{
+    const gamemap m(sys::read_file("data/maps/island1"));
+    
+    std::vector<location> from, to;
+    for(int x = 0; x < m.size().x(); x += 7) {
+        for(int y = 0; y < m.size().y(); y += 7) {
+            std::vector<location> targets;
+            get_locations_in_radius(location(x,y), 12, targets);
+            foreach(const location& loc, targets) {
+                if(m.is_loc_on_map(loc)) {
+                    from.push_back(location(x,y));
+                    to.push_back(loc);
+                }
+            }
+        }
+    }
+    
+    //the exact line often stops at a different tile from the line sampled
+    //every half a tile, the way it used to be. The sampled line steps over
+    //the parts of tiles between samples, and compares heights only at the
+    //samples, so it misses tiles the line passes below the top of near
+    //an edge. The exact line finds the first tile which is in the way at
+    //any point, which is where the sampled line stops as the samples get
+    //closer together. So the two must agree once the samples are a
+    //hundredth of a tile apart, except where it's too close to call.
+    const GLfloat FineSpacing = 0.01;
+    int agree = 0, exact_only = 0, sampled_only = 0, different = 0;
+    int fine_agree = 0, close_calls = 0;
+    const int ranges[] = {-1, 6};
+    foreach(int range, ranges) {
+        for(int n = 0; n != from.size(); ++n) {
+            const location& a = from[n];
+            const location& b = to[n];
+            
+            std::vector<location> line;
+            const location blocked = m.tile_in_the_way(a, b, &line, range);
+            for(int i = 1; i < line.size(); ++i) {
+                assert(tiles_adjacent(line[i-1], line[i]));
+            }
+            
+            if(!m.is_loc_on_map(blocked) && a != b) {
+                assert(!line.empty() && line.front() == a);
+                assert(tiles_adjacent(line.back(), b));
+            }
+            
+            const location sampled = sampled_tile_in_the_way(m, a, b, range);
+            if(blocked == sampled) {
+                ++agree;
+            } else if(!m.is_loc_on_map(sampled)) {
+                ++exact_only;
+            } else if(!m.is_loc_on_map(blocked)) {
+                ++sampled_only;
+            } else {
+                ++different;
+            }
+            
+            const location fine =
+                sampled_tile_in_the_way(m, a, b, range, FineSpacing);
+            if(blocked == fine) {
+                ++fine_agree;
+            } else {
+                assert(close_call(m, a, b, range, FineSpacing,
+                                  blocked, fine));
+                ++close_calls;
+            }
+        }
+    }
+    
+    std::cerr << "line of sight: against samples every half a tile, "
+              << agree << " agree, " << exact_only
+              << " blocked only by the exact line, " << sampled_only
+              << " blocked only by the sampled line, " << different
+              << " blocked at different tiles\n"
+              << "line of sight: against samples every " << FineSpacing
+              << " tiles, " << fine_agree << " agree, " << close_calls
+              << " too close to call\n";
+    
+    const int repeats = 10;
+    int start = SDL_GetTicks();
+    for(int r = 0; r != repeats; ++r) {
+        for(int n = 0; n != from.size(); ++n) {
+            m.tile_in_the_way(from[n], to[n]);
+        }
+    }
+    
+    const int exact_ms = SDL_GetTicks() - start;
+    start = SDL_GetTicks();
+    for(int r = 0; r != repeats; ++r) {
+        for(int n = 0; n != from.size(); ++n) {
+            sampled_tile_in_the_way(m, from[n], to[n], -1);
+        }
+    }
+    
+    const int sampled_ms = SDL_GetTicks() - start;
+    const int rays = repeats*from.size();
+    std::cerr << "line of sight: exact " << (rays*1000.0/std::max(exact_ms, 1))
+              << " rays/sec, sampled " << (rays*1000.0/std::max(sampled_ms, 1))
+              << " rays/sec\n";
+}
+
+#endif
+
 }
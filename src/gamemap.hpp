@@ -17,6 +17,8 @@
 #include <vector>
 #include <GL/glew.h>
 
+#include "base_terrain_fwd.hpp"
+#include "terrain_feature_fwd.hpp"
 #include "tile.hpp"
 #include "tile_logic.hpp"
 
@@ -33,10 +35,34 @@ public:
     std::string write() const;
     
     const location& size() const { return dim_; }
+
+    //a number which changes every time the map is modified, so that
+    //anything calculated from the map can tell when it's out of date.
+    int revision() const { return revision_; }
     const tile& get_tile(const location& loc) const;
     tile& get_tile(const location& loc);
     bool is_loc_on_map(const location& loc) const;
 
+    //the terrain of the map as game logic sees it. This is kept in
+    //arrays apart from the tiles, which hold everything needed to draw
+    //the map, so that searching the map doesn't have to go through it.
+    //loc must be on the map.
+    int index(const location& loc) const { return loc.y()*dim_.x() + loc.x(); }
+    int height(const location& loc) const { return heights_[index(loc)]; }
+    const_base_terrain_ptr terrain(const location& loc) const;
+    const_terrain_feature_ptr feature(const location& loc) const;
+
+    //the height of the top of what's on a tile, for lines of sight.
+    GLfloat vision_height(const location& loc) const { return vision_heights_[index(loc)]; }
+
+    bool is_passable(const location& loc, DIRECTION dir) const {
+        return (passable_[index(loc)] & (1 << dir)) != 0;
+    }
+
+    bool is_cliff(const location& loc, DIRECTION dir) const {
+        return (cliffs_[index(loc)] & (1 << dir)) != 0;
+    }
+
     const tile* closest_tile(GLfloat* x, GLfloat* y, bool return_null_outside_border=true) const;
     
     struct parse_error {
@@ -66,11 +92,26 @@ private:
 
 	void parse(const std::string& data);
 	void init_tiles();
+	void init_terrain();
+	void update_terrain(const location& loc);
 
 	std::vector<tile> map_;
 	location dim_;
+	int revision_;
+
+	//indexes of terrains and features are stored plus one, so that
+	//zero can mean none. There can be more kinds of each than fit in a
+	//byte.
+	std::vector<short> heights_;
+	std::vector<unsigned short> terrains_, features_;
+	std::vector<GLfloat> vision_heights_;
+	std::vector<unsigned char> cliffs_, passable_;
 };
 
+#ifdef UNIT_TEST_LINE_OF_SIGHT
+void unit_test_line_of_sight();
+#endif
+
 typedef boost::shared_ptr<gamemap> gamemap_ptr;
 typedef boost::shared_ptr<const gamemap> const_gamemap_ptr;
 
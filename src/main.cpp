@@ -26,6 +26,7 @@
 #include <fcntl.h>
 #include <unistd.h>
 
+#include "battle_simulator.hpp"
 #include "camera.hpp"
 #include "character.hpp"
 #include "character_generator.hpp"
@@ -39,61 +40,35 @@
 #include "wml_node.hpp"
 #include "base_terrain.hpp"
 #include "party.hpp"
+#include "path_service.hpp"
 #include "preferences.hpp"
 #include "skill.hpp"
+#include "spatial_grid.hpp"
+#include "string_utils.hpp"
 #include "terrain_feature.hpp"
 #include "text_gui.hpp"
+#include "timing_wheel.hpp"
 #include "texture.hpp"
 #include "titlescreen.hpp"
 #include "translate.hpp"
 #include "world.hpp"
+#include "world_loader.hpp"
+#include "world_simulator.hpp"
 #include "audio/audio.hpp"
 
-extern "C" int main(int argc, char** argv)
-{
-	if(!parse_args(argc, argv)) {
-		return -1;
-	}
-
-	if(SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER | SDL_INIT_NOPARACHUTE) < 0) {
-		std::cerr << "could not init SDL\n";
-		return -1;
-	}
-
-	if(SDL_SetVideoMode(preference_screen_width(),preference_screen_height(),0,SDL_OPENGL | preference_fullscreen()) == NULL) {
-		std::cerr << "could not set video mode\n";
-		return -1;
-	}
-
-	{
-	const std::string data = sys::read_file("data/translate.cfg");
-	if(data.empty() == false) {
-		wml::node_ptr cfg(wml::parse_wml(data));
-		for(wml::node::const_attr_iterator i = cfg->begin_attr();
-		    i != cfg->end_attr(); ++i) {
-			i18n::add_translation(i->first,i->second);
-		}
-	}
-	}
-
-	graphics::texture::manager texture_manager;
-	gui::text::init();
-
-#ifdef AUDIO
-    audio::init_audio();
-#endif
-
-#ifdef UNIT_TEST_FORMULA
-    game_logic::unit_test_formulae();
-#endif
+namespace {
 
+//reads data/rules.cfg, which describes items, characters, skills,
+//terrain and the calculations the game uses.
+bool load_rules()
+{
 	wml::node_ptr rules_cfg;
 
 	try {
 		rules_cfg = wml::parse_wml(sys::read_file("data/rules.cfg"));
 	} catch(...) {
 		std::cerr << "error parsing rules WML...\n";
-		return -1;
+		return false;
 	}
 
 	game_logic::item::initialize(rules_cfg->get_child("item_registry"));
@@ -103,7 +78,7 @@ extern "C" int main(int argc, char** argv)
 	wml::const_node_ptr skills_cfg = rules_cfg->get_child("skills");
 	if(!skills_cfg) {
 		std::cerr << "could not find skills in rules\n";
-		return -1;
+		return false;
 	}
 
 	for(wml::node::const_child_range range = skills_cfg->get_child_range("skill"); range.first != range.second; ++range.first) {
@@ -114,7 +89,7 @@ extern "C" int main(int argc, char** argv)
 	wml::const_node_ptr terrain_cfg = rules_cfg->get_child("terrains");
 	if(!terrain_cfg) {
 		std::cerr << "could not find terrain in rules\n";
-		return -1;
+		return false;
 	}
 
 	wml::node::const_all_child_iterator cfg1 = terrain_cfg->begin_children();
@@ -131,11 +106,135 @@ extern "C" int main(int argc, char** argv)
 	wml::const_node_ptr calculations_cfg = rules_cfg->get_child("calculations");
 	if(!calculations_cfg) {
 		std::cerr << "could not find calculations in rules\n";
-		return -1;
+		return false;
 	}
 
 	formula_registry::load(calculations_cfg);
 
+	return true;
+}
+
+int simulate_battles()
+{
+	if(SDL_Init(SDL_INIT_TIMER | SDL_INIT_NOPARACHUTE) < 0) {
+		std::cerr << "could not init SDL\n";
+		return -1;
+	}
+
+	if(!load_rules()) {
+		return -1;
+	}
+
+	game_logic::battle_simulation sim;
+	sim.sides[0] = util::split(preference_battle_side(1));
+	sim.sides[1] = util::split(preference_battle_side(2));
+	sim.map_file = preference_battle_map();
+	sim.battles = preference_simulate_battles();
+	sim.seed = preference_battle_seed();
+	sim.processes = preference_battle_processes();
+
+	const bool res = game_logic::simulate_battles(sim, std::cout);
+	SDL_Quit();
+	return res ? 0 : -1;
+}
+
+int simulate_world()
+{
+	if(SDL_Init(SDL_INIT_TIMER | SDL_INIT_NOPARACHUTE) < 0) {
+		std::cerr << "could not init SDL\n";
+		return -1;
+	}
+
+	if(!load_rules()) {
+		return -1;
+	}
+
+	std::string file = preference_scenario_file();
+	if(!preference_save_file().empty()) {
+		file = preference_save_file();
+	}
+
+	const bool res = game_logic::simulate_world(file,
+	                      preference_simulate_days(), preference_world_seed(),
+	                      std::cout);
+	game_logic::world_loader::get().shutdown(std::cerr);
+	game_logic::path_service::get().shutdown(std::cerr);
+	SDL_Quit();
+	return res ? 0 : -1;
+}
+
+}
+
+extern "C" int main(int argc, char** argv)
+{
+	if(!parse_args(argc, argv)) {
+		return -1;
+	}
+
+	if(preference_simulate_battles() > 0) {
+		return simulate_battles();
+	}
+
+	if(preference_headless()) {
+		return simulate_world();
+	}
+
+	if(SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER | SDL_INIT_NOPARACHUTE) < 0) {
+		std::cerr << "could not init SDL\n";
+		return -1;
+	}
+
+	if(SDL_SetVideoMode(preference_screen_width(),preference_screen_height(),0,SDL_OPENGL | preference_fullscreen()) == NULL) {
+		std::cerr << "could not set video mode\n";
+		return -1;
+	}
+
+	{
+	const std::string data = sys::read_file("data/translate.cfg");
+	if(data.empty() == false) {
+		wml::node_ptr cfg(wml::parse_wml(data));
+		for(wml::node::const_attr_iterator i = cfg->begin_attr();
+		    i != cfg->end_attr(); ++i) {
+			i18n::add_translation(i->first,i->second);
+		}
+	}
+	}
+
+	graphics::texture::manager texture_manager;
+	gui::text::init();
+
+#ifdef AUDIO
+    audio::init_audio();
+#endif
+
+#ifdef UNIT_TEST_FORMULA
+    game_logic::unit_test_formulae();
+#endif
+
+	if(!load_rules()) {
+		return -1;
+	}
+
+#ifdef UNIT_TEST_LINE_OF_SIGHT
+	hex::unit_test_line_of_sight();
+#endif
+
+#ifdef UNIT_TEST_FIELD_OF_VIEW
+	hex::unit_test_field_of_view();
+#endif
+
+#ifdef UNIT_TEST_FIND_REACHABLE
+	hex::unit_test_find_reachable();
+#endif
+
+#ifdef UNIT_TEST_TIMING_WHEEL
+	util::unit_test_timing_wheel();
+#endif
+
+#ifdef UNIT_TEST_SPATIAL_GRID
+	hex::unit_test_spatial_grid();
+#endif
+
 	GLfloat intensity = 1.0;
 	GLfloat ambient_light[] = {intensity,intensity,intensity,1.0};
 	GLfloat diffuse_light[] = {1.0,1.0,1.0,1.0};
@@ -218,6 +317,8 @@ extern "C" int main(int argc, char** argv)
 				w = w->play();
 			}
 		} catch(game_logic::world::new_game_exception new_game) {
+			//worlds kept from the old game mustn't turn up in the new one.
+			game_logic::world_loader::get().clear();
 			save_file = new_game.filename();
 			continue;
 		} catch(game_logic::world::quit_exception) {
@@ -227,6 +328,9 @@ extern "C" int main(int argc, char** argv)
 		break;
 	}
 
+	game_logic::world_loader::get().shutdown(std::cerr);
+	game_logic::path_service::get().shutdown(std::cerr);
+
 	SDL_Quit();
 	return 0;
 }
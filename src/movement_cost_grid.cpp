@@ -0,0 +1,118 @@
+/*
+   Copyright (C) 2007 by David White <dave.net>
+   Part of the Silver Tree Project
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 2 or later.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY.
+
+   See the COPYING file for more details.
+*/
+#include <algorithm>
+#include <limits>
+
+#include "character.hpp"
+#include "foreach.hpp"
+#include "movement_cost_grid.hpp"
+#include "tile.hpp"
+
+namespace game_logic
+{
+
+movement_profile::movement_profile(const std::vector<character_ptr>& members)
+{
+	foreach(const character_ptr& c, members) {
+		member m;
+		m.speed = c->speed();
+		m.climbing = c->climbing();
+		m.costs = c->move_cost_map();
+		members_.push_back(m);
+	}
+
+	//the party's cost doesn't depend on the order of its members
+	std::sort(members_.begin(), members_.end());
+}
+
+int movement_profile::move_cost(hex::const_base_terrain_ptr terrain,
+                                hex::const_terrain_feature_ptr feature,
+                                int height_change) const
+{
+	int res = -1;
+	foreach(const member& m, members_) {
+		const int cost = character::move_cost(m.costs, terrain, feature,
+		                                      height_change,
+		                                      m.speed, m.climbing);
+		if(cost < 0) {
+			return -1;
+		}
+
+		if(res == -1 || cost > res) {
+			res = cost;
+		}
+	}
+
+	return res;
+}
+
+bool movement_profile::operator==(const movement_profile& p) const
+{
+	return members_ == p.members_;
+}
+
+bool movement_profile::operator<(const movement_profile& p) const
+{
+	return members_ < p.members_;
+}
+
+movement_cost_grid::movement_cost_grid(const hex::gamemap& m,
+                                       const movement_profile& profile)
+  : map_(m), profile_(profile), revision_(m.revision()),
+    width_(m.size().x())
+{
+	build();
+}
+
+int movement_cost_grid::cost(const hex::location& src,
+                             const hex::location& dst) const
+{
+	if(!map_.is_loc_on_map(src) || !map_.is_loc_on_map(dst)) {
+		return -1;
+	}
+
+	const hex::DIRECTION dir = hex::get_adjacent_direction(src, dst);
+	if(dir == hex::NULL_DIRECTION) {
+		return -1;
+	}
+
+	return cost(src, dir);
+}
+
+void movement_cost_grid::build()
+{
+	costs_.resize(map_.size().x()*map_.size().y()*6);
+
+	std::vector<short>::iterator out = costs_.begin();
+	for(int y = 0; y != map_.size().y(); ++y) {
+		for(int x = 0; x != map_.size().x(); ++x) {
+			const hex::location src(x, y);
+			hex::location adj[6];
+			hex::get_adjacent_tiles(src, adj);
+			for(int n = 0; n != 6; ++n, ++out) {
+				if(!map_.is_loc_on_map(adj[n]) ||
+				   !map_.is_passable(src, static_cast<hex::DIRECTION>(n))) {
+					*out = -1;
+					continue;
+				}
+
+				const int cost = profile_.move_cost(map_.terrain(adj[n]),
+				                                    map_.feature(adj[n]),
+				                      map_.height(adj[n]) - map_.height(src));
+				*out = static_cast<short>(std::min<int>(cost,
+				                   std::numeric_limits<short>::max()));
+			}
+		}
+	}
+}
+
+}
@@ -0,0 +1,112 @@
+/*
+   Copyright (C) 2007 by David White <dave.net>
+   Part of the Silver Tree Project
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 2 or later.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY.
+
+   See the COPYING file for more details.
+*/
+#ifndef MOVEMENT_COST_GRID_HPP_INCLUDED
+#define MOVEMENT_COST_GRID_HPP_INCLUDED
+
+#include <boost/shared_ptr.hpp>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base_terrain_fwd.hpp"
+#include "character_fwd.hpp"
+#include "gamemap.hpp"
+#include "terrain_feature_fwd.hpp"
+#include "tile_logic.hpp"
+
+namespace game_logic
+{
+
+//everything about a group of characters which determines how much it
+//costs them to move over terrain. Two parties with equal profiles have
+//the same movement cost between any two hexes, and so can share
+//a movement_cost_grid.
+class movement_profile
+{
+public:
+	movement_profile() {}
+	explicit movement_profile(const std::vector<character_ptr>& members);
+
+	//the cost for the group to move, which is the cost of the slowest
+	//member, or -1 if any member can't make the move.
+	int move_cost(hex::const_base_terrain_ptr terrain,
+	              hex::const_terrain_feature_ptr feature,
+	              int height_change) const;
+
+	bool operator==(const movement_profile& p) const;
+	bool operator<(const movement_profile& p) const;
+
+private:
+	struct member {
+		int speed;
+		int climbing;
+		std::map<std::string,int> costs;
+
+		bool operator==(const member& m) const {
+			return speed == m.speed && climbing == m.climbing &&
+			       costs == m.costs;
+		}
+
+		bool operator<(const member& m) const {
+			if(speed != m.speed) {
+				return speed < m.speed;
+			}
+
+			if(climbing != m.climbing) {
+				return climbing < m.climbing;
+			}
+
+			return costs < m.costs;
+		}
+	};
+
+	std::vector<member> members_;
+};
+
+//the cost of moving from every hex on a map to each of its six
+//neighbours for a given movement profile. Costs are calculated once
+//when the grid is built, so that pathfinding only has to read an array.
+class movement_cost_grid
+{
+public:
+	movement_cost_grid(const hex::gamemap& m, const movement_profile& profile);
+
+	const movement_profile& profile() const { return profile_; }
+	const hex::gamemap& map() const { return map_; }
+
+	//returns false if the map has been modified since the grid was built.
+	bool is_current() const { return revision_ == map_.revision(); }
+
+	int cost(const hex::location& src, hex::DIRECTION dir) const {
+		return costs_[(src.y()*width_ + src.x())*6 + dir];
+	}
+
+	//the cost of moving between two hexes, or -1 if they are not
+	//adjacent, not on the map, or the move is impossible.
+	int cost(const hex::location& src, const hex::location& dst) const;
+
+private:
+	void build();
+
+	const hex::gamemap& map_;
+	movement_profile profile_;
+	int revision_;
+	int width_;
+	std::vector<short> costs_;
+};
+
+typedef boost::shared_ptr<movement_cost_grid> movement_cost_grid_ptr;
+typedef boost::shared_ptr<const movement_cost_grid> const_movement_cost_grid_ptr;
+
+}
+
+#endif
@@ -13,22 +13,30 @@
 #include "battle.hpp"
 #include "battle_character.hpp"
 #include "battle_map_generator.hpp"
-#include "global_game_state.hpp"
 #include "foreach.hpp"
 #include "gamemap.hpp"
 #include "npc_party.hpp"
+#include "preferences.hpp"
 #include "shop_dialog.hpp"
 #include "tile_logic.hpp"
 #include "wml_node.hpp"
 #include "wml_utils.hpp"
 #include "world.hpp"
 
+#include <algorithm>
 #include <cstdlib>
 #include <iostream>
 
 namespace game_logic
 {
 
+namespace {
+//how long, in seconds of game time at a scale of one, a party nobody
+//is near waits between turns: long enough to cross a few dozen hexes
+//of open ground.
+const int WaitInterval = 300;
+}
+
 npc_party::npc_party(wml::const_node_ptr node, world& game_world)
     : party(node,game_world), aggressive_(wml::get_bool(node,"aggressive")),
       rest_(wml::get_bool(node,"rest",false))
@@ -85,12 +93,15 @@ void npc_party::encounter(party& p, const std::string& type)
 		return;
 	}
 
-	map_formula_callable_ptr callable(new map_formula_callable);
+	const event_id id = get_event_id(type);
+	if(!game_world().has_event_handlers(id, this)) {
+		return;
+	}
+
+	map_formula_callable_ptr callable = game_world().event_callable();
 	callable->add("pc", variant(&p))
-	         .add("npc", variant(this))
-	         .add("world", variant(&game_world()))
-	         .add("var", variant(&global_game_state::get().get_variables()));
-	game_world().fire_event(type, *callable);
+	         .add("npc", variant(this));
+	game_world().fire_event(id, *callable, this);
 }
 
 void npc_party::set_value(const std::string& key, const variant& value)
@@ -115,22 +126,50 @@ void npc_party::set_value(const std::string& key, const variant& value)
 party::TURN_RESULT npc_party::do_turn()
 {
   //const int start_ticks = SDL_GetTicks();
+
+	//a party which has been waiting first goes as far along its route
+	//as it would have got by now.
+	const hex::location start_loc = loc();
+	if(waiting_since_.valid()) {
+		catch_up();
+	}
+
+	//a party nobody is near can't see anyone worth chasing, and whatever
+	//it does can't be seen, so it can wait and move in coarse steps.
+	const int detail_distance = preference_npc_detail_distance();
+	const bool far = detail_distance > 0 &&
+	         !game_world().is_anyone_near(*this, detail_distance);
+	if(!far) {
+		waiting_since_ = game_time();
+		if(loc() != start_loc) {
+			//the rest of the turn is taken once the world has seen
+			//where the party got to.
+			return TURN_COMPLETE;
+		}
+	}
+
 	std::vector<const_party_ptr> parties;
-	if(aggressive_) {
+	if(aggressive_ && !far) {
 		get_visible_parties(parties);
 	}
 
 	hex::location target;
 	int closest = -1;
+	bool chasing = false;
 	foreach(const const_party_ptr& party, parties) {
 		if(is_enemy(*party) && (closest == -1 || hex::distance_between(loc(),party->loc()) < closest)) {
 			closest = hex::distance_between(loc(),party->loc());
 			target = party->loc();
 			current_destination_ = target;
+			chasing = true;
 			break;
 		}
 	}
 
+	if(!chasing) {
+		chase_field_.reset();
+	}
+
 	if(current_destination_ == loc()) {
 		current_destination_ = hex::location();
 	}
@@ -161,33 +200,39 @@ party::TURN_RESULT npc_party::do_turn()
 	}
 
 	if(map().is_loc_on_map(target)) {
-		const int current_distance = hex::distance_between(loc(),target);
-		int best = -1;
+		if(far && !chasing && wait_towards(target)) {
+			return TURN_COMPLETE;
+		}
+
 		hex::DIRECTION dir = hex::NULL_DIRECTION;
-		hex::location adj[6];
-		hex::get_adjacent_tiles(loc(),adj);
-		for(int n = 0; n != 6; ++n) {
-			if(map().is_loc_on_map(adj[n]) == false) {
-				continue;
-			}
+		if(chasing) {
+			dir = chase(target);
+		}
 
-			const int distance = hex::distance_between(adj[n],target);
-			if(distance >= current_distance) {
-				continue;
-			}
+		if(dir == hex::NULL_DIRECTION) {
+			const int current_distance = hex::distance_between(loc(),target);
+			int best = -1;
+			hex::location adj[6];
+			hex::get_adjacent_tiles(loc(),adj);
+			for(int n = 0; n != 6; ++n) {
+				if(map().is_loc_on_map(adj[n]) == false) {
+					continue;
+				}
 
-			std::vector<const_party_ptr> parties_at;
-			game_world().get_parties_at(adj[n], parties_at);
-			if(!parties_at.empty()) {
-				if(!parties_at.front()->is_enemy(*this)) {
+				const int distance = hex::distance_between(adj[n],target);
+				if(distance >= current_distance) {
 					continue;
 				}
-			}
 
-			const int cost = movement_cost(loc(),adj[n]);
-			if(cost != -1 && (best == -1 || distance*1000 + cost < best)) {
-				best = distance*1000 + cost;
-				dir = hex::DIRECTION(n);
+				if(is_blocked(adj[n])) {
+					continue;
+				}
+
+				const int cost = movement_cost(loc(),adj[n]);
+				if(cost != -1 && (best == -1 || distance*1000 + cost < best)) {
+					best = distance*1000 + cost;
+					dir = hex::DIRECTION(n);
+				}
 			}
 		}
 
@@ -203,10 +248,183 @@ party::TURN_RESULT npc_party::do_turn()
 		return TURN_COMPLETE;
 	}
 
-	pass();
+	waiting_since_ = game_time();
+	pass(far ? WaitInterval : 1);
 	return TURN_COMPLETE;
 }
 
+bool npc_party::wait_towards(const hex::location& target)
+{
+	std::vector<hex::location>::const_iterator i =
+	                  std::find(route_.begin(), route_.end(), loc());
+	if(route_.empty() || route_.back() != target || i == route_.end()) {
+		find_route(target);
+		i = route_.begin();
+	}
+
+	if(i + 1 == route_.end() || movement_cost(loc(), *(i + 1)) < 0) {
+		waiting_since_ = game_time();
+		return false;
+	}
+
+	//time the party spent part way to the next hex is kept.
+	const game_time now = game_world().current_time();
+	if(!waiting_since_.valid()) {
+		waiting_since_ = now;
+	}
+
+	wait_until(now + WaitInterval*game_world().scale());
+	return true;
+}
+
+void npc_party::catch_up()
+{
+	const game_time now = game_world().current_time();
+	const game_time start = waiting_since_;
+	game_time t = start;
+	waiting_since_ = game_time();
+
+	std::vector<hex::location>::const_iterator i =
+	                  std::find(route_.begin(), route_.end(), loc());
+	if(i == route_.end()) {
+		return;
+	}
+
+	//the party stops short of where its members would be exhausted, so
+	//that it rests just as it would moving a hex at a time.
+	std::vector<int> fatigue;
+	foreach(const const_character_ptr& c, members()) {
+		fatigue.push_back(c->fatigue());
+	}
+
+	std::vector<hex::location> path;
+	hex::location src = loc();
+	for(++i; i != route_.end(); ++i) {
+		if(movement_cost(src, *i) < 0) {
+			route_.clear();
+			break;
+		}
+
+		const game_time arrive = t + move_time(src, *i);
+		if(arrive > now) {
+			break;
+		}
+
+		bool exhausted = false;
+		for(int n = 0; n != members().size(); ++n) {
+			const character& c = *members()[n];
+			fatigue[n] += fatigue_cost(c, src, *i);
+			if(fatigue[n] >= c.stamina()) {
+				exhausted = true;
+			}
+		}
+
+		path.push_back(*i);
+		src = *i;
+		t = arrive;
+		if(exhausted) {
+			break;
+		}
+	}
+
+	if(path.empty()) {
+		waiting_since_ = start;
+		return;
+	}
+
+	move_along(path, start);
+	waiting_since_ = t;
+}
+
+bool npc_party::wake()
+{
+	if(!waiting_since_.valid()) {
+		return false;
+	}
+
+	wait_until(game_world().current_time());
+	return true;
+}
+
+void npc_party::find_route(const hex::location& target)
+{
+	//the same steps the party would take a hex at a time, leaving out
+	//other parties in the way, since there are none nearby.
+	route_.clear();
+	route_.push_back(loc());
+	while(route_.back() != target) {
+		const hex::location& src = route_.back();
+		const int current_distance = hex::distance_between(src,target);
+		int best = -1;
+		hex::location next;
+		hex::location adj[6];
+		hex::get_adjacent_tiles(src,adj);
+		for(int n = 0; n != 6; ++n) {
+			if(map().is_loc_on_map(adj[n]) == false) {
+				continue;
+			}
+
+			const int distance = hex::distance_between(adj[n],target);
+			if(distance >= current_distance) {
+				continue;
+			}
+
+			const int cost = movement_cost(src,adj[n]);
+			if(cost != -1 && (best == -1 || distance*1000 + cost < best)) {
+				best = distance*1000 + cost;
+				next = adj[n];
+			}
+		}
+
+		if(best == -1) {
+			break;
+		}
+
+		route_.push_back(next);
+	}
+}
+
+hex::DIRECTION npc_party::chase(const hex::location& target)
+{
+	//all parties chasing the same target with the same movement costs
+	//share a field of distances to it, and each just steps downhill.
+	chase_field_ = game_world().get_distance_field(movement_costs(), target);
+	const int current_distance = chase_field_->distance(loc());
+	if(current_distance <= 0) {
+		return hex::NULL_DIRECTION;
+	}
+
+	int best = -1;
+	hex::DIRECTION dir = hex::NULL_DIRECTION;
+	hex::location adj[6];
+	hex::get_adjacent_tiles(loc(),adj);
+	for(int n = 0; n != 6; ++n) {
+		const int distance = chase_field_->distance(adj[n]);
+		if(distance < 0 || distance >= current_distance) {
+			continue;
+		}
+
+		const int cost = movement_costs()->cost(loc(),hex::DIRECTION(n));
+		if(cost < 0 || is_blocked(adj[n])) {
+			continue;
+		}
+
+		if(best == -1 || distance + cost < best) {
+			best = distance + cost;
+			dir = hex::DIRECTION(n);
+		}
+	}
+
+	return dir;
+}
+
+bool npc_party::is_blocked(const hex::location& dst) const
+{
+	std::vector<const_party_ptr> parties_at;
+	game_world().get_parties_at(dst, parties_at);
+	return !parties_at.empty() && !parties_at.front()->is_enemy(*this);
+}
+
 void npc_party::choose_new_destination()
 {
 	if(next_destination_) {
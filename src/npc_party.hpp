@@ -15,6 +15,7 @@
 
 #include <vector>
 
+#include "distance_field.hpp"
 #include "formula_fwd.hpp"
 #include "party.hpp"
 #include "tile_logic.hpp"
@@ -37,6 +38,26 @@ private:
 	bool is_human_controlled() const { return false; }
 	TURN_RESULT do_turn();
 	void choose_new_destination();
+
+	//the direction to move in to follow the cheapest route to an
+	//enemy at target, or NULL_DIRECTION if there is no route.
+	hex::DIRECTION chase(const hex::location& target);
+	bool is_blocked(const hex::location& dst) const;
+
+	//a party nobody is near follows a route to its target, worked out
+	//once for as long as the target stays the same, but only takes a
+	//turn now and then, or when woken. Each turn it goes as far along
+	//the route as it would have got in the time since the last.
+	//Returns false if it can't move that way.
+	bool wait_towards(const hex::location& target);
+	void catch_up();
+	bool wake();
+	void find_route(const hex::location& target);
+	std::vector<hex::location> route_;
+
+	//when the party reached where it is along route_ while waiting,
+	//or not valid if it isn't waiting.
+	game_time waiting_since_;
 	wml::const_node_ptr dialog_;
 
 	hex::location current_destination_;
@@ -44,6 +65,7 @@ private:
 	bool rest_;
 	std::vector<hex::location> wander_between_;
 	const_formula_ptr next_destination_;
+	const_distance_field_ptr chase_field_;
 };
 
 }
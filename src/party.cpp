@@ -31,6 +31,7 @@
 #include "wml_node.hpp"
 #include "wml_utils.hpp"
 
+#include <algorithm>
 #include <cmath>
 
 #include <iostream>
@@ -38,6 +39,12 @@
 namespace game_logic
 {
 
+namespace {
+const event_id EncounterEvent = get_event_id("encounter");
+const event_id BeginMoveEvent = get_event_id("begin_move");
+const event_id EndMoveEvent = get_event_id("end_move");
+}
+
 party::party(wml::const_node_ptr node, world& gameworld)
    : id_(wml::get_int(node,"unique_id",-1)),
      str_id_(wml::get_str(node,"id")),
@@ -45,9 +52,9 @@ party::party(wml::const_node_ptr node, world& gameworld)
      wml::get_attr<int>(node,"y")),
      facing_(hex::NORTH), last_facing_(hex::NORTH),
 	 last_move_(hex::NULL_DIRECTION),
-     arrive_at_(node),
+     arrive_at_(node), queue_handle_(-1), grid_handle_(-1),
 	 allegiance_(wml::get_attr<std::string>(node,"allegiance")),
-	 move_mode_(WALK), money_(wml::get_int(node,"money"))
+	 cost_grid_stale_(true), move_mode_(WALK), money_(wml::get_int(node,"money"))
 {
 	if(id_ == -1) {
 		id_ = global_game_state::get().generate_new_party_id();
@@ -70,7 +77,8 @@ party::party(wml::const_node_ptr node, world& gameworld)
 			members_.push_back(character::create(i.first->second));
 		}
 
-		if(!avatar_ || !avatar_->valid()) {
+		//without graphics there are no models to show the party with.
+		if(!preference_headless() && (!avatar_ || !avatar_->valid())) {
 			avatar_ = hex::map_avatar::create(
                                 static_cast<wml::const_node_ptr>(members_.back()->write()),
                                 this);
@@ -103,11 +111,9 @@ party::party(wml::const_node_ptr node, world& gameworld)
 	    i.first != i.second; ++i.first) {
 		wml::node_ptr event(new wml::node("event"));
 		wml::copy_over(i.first->second, event);
-		wml::node_ptr filter(new wml::node("filter"));
-		filter->set_attr("filter", formatter() << "npc.unique_id = " << id_);
-		event->add_child(filter);
 		event_handler handler(event);
-		gameworld.add_event_handler("encounter", handler);
+		handler.set_npc_filter(id_);
+		gameworld.add_event_handler(EncounterEvent, handler);
 	}
 
 	wml::const_node_ptr var_node = node->get_child("vars");
@@ -134,7 +140,9 @@ party::~party()
 wml::node_ptr party::write() const
 {
 	wml::node_ptr res(new wml::node("party"));
-	avatar_->write(res);
+	if(avatar_) {
+		avatar_->write(res);
+	}
 	res->set_attr("id", str_id_);
 	res->set_attr("unique_id", formatter() << id_);
 	res->set_attr("x", formatter() << loc_.x());
@@ -179,6 +187,7 @@ void party::new_world(world& w, const hex::location& loc, hex::DIRECTION dir)
 {
 	world_ = &w;
 	loc_ = loc;
+	movement_costs_changed();
 	std::cerr << "entering world at " << loc.x() << "," << loc.y() << "\n";
 	arrive_at_ = game_world().current_time();
 	if(dir != hex::NULL_DIRECTION && movement_cost(loc_, hex::tile_in_direction(loc_, dir)) >= 0) {
@@ -221,6 +230,10 @@ void party::execute_dialog_command(const std::string& cmd,
 
 party::TURN_RESULT party::play_turn()
 {
+	//members may have been changed outside of the party's control since
+	//its last turn, such as by a battle or in a dialog.
+	movement_costs_changed();
+
 	if(!scripted_moves_.empty()) {
 		const hex::location& dst = scripted_moves_.front();
 		if(dst == loc_) {
@@ -280,6 +293,7 @@ void party::full_heal()
 void party::join_party(character_ptr new_char)
 {
 	members_.push_back(new_char);
+	movement_costs_changed();
 }
 
 void party::merge_party(party& joining_party)
@@ -289,29 +303,76 @@ void party::merge_party(party& joining_party)
 	}
 
 	joining_party.members_.clear();
+	joining_party.movement_costs_changed();
 }
 
 void party::acquire_item(item_ptr i)
 {
 	inventory_.push_back(i);
+	movement_costs_changed();
 }
 
 void party::move(hex::DIRECTION dir)
 {
 	last_move_ = dir;
-	world_->get_tracks().add_tracks(loc(), *this, world_->current_time(), dir);
+	world_->get_tracks().add_tracks(loc(), *this, world_->current_time(),
+	                                world_->current_time(), dir);
 	last_facing_ = facing_;
 	facing_ = dir;
 	const hex::location dst = hex::tile_in_direction(loc(),dir);
 	const int cost = movement_cost(loc(),dst)/move_mode_;
 	apply_fatigue(loc(),dst);
+	movement_costs_changed();
 	departed_at_ = game_world().current_time();
 	arrive_at_ = game_world().current_time() + cost*game_world().scale();
 	previous_loc_ = loc_;
 	loc_ = dst;
-	visible_locs_.clear();
 
-	world_->fire_event("begin_move", *this);
+	world_->fire_event(BeginMoveEvent, *this);
+}
+
+void party::move_along(const std::vector<hex::location>& path,
+                       const game_time& start)
+{
+	assert(!path.empty());
+	std::vector<int> stamina_used(members_.size());
+	const game_time now = game_world().current_time();
+	game_time t = start;
+	hex::location src = loc_;
+	foreach(const hex::location& dst, path) {
+		const hex::DIRECTION dir = hex::get_adjacent_direction(src, dst);
+		world_->get_tracks().add_tracks(src, *this, t, now, dir);
+		last_facing_ = facing_;
+		facing_ = last_move_ = dir;
+		t = t + move_time(src, dst);
+		for(int n = 0; n != members_.size(); ++n) {
+			stamina_used[n] += fatigue_cost(*members_[n], src, dst);
+		}
+
+		previous_loc_ = src;
+		src = dst;
+	}
+
+	for(int n = 0; n != members_.size(); ++n) {
+		members_[n]->use_stamina(stamina_used[n]);
+	}
+
+	movement_costs_changed();
+	departed_at_ = start;
+	arrive_at_ = t;
+	loc_ = src;
+
+	world_->fire_event(BeginMoveEvent, *this);
+}
+
+void party::award(int xp, int money, const std::vector<character_ptr>& chars)
+{
+	get_money(money);
+	foreach(const character_ptr& c, chars) {
+		for(int n = 0; n < xp; ++n) {
+			c->award_experience(1);
+		}
+	}
 }
 
 void party::pass(int slices)
@@ -324,13 +385,18 @@ void party::pass(int slices)
 		c->use_stamina(-slices * 2);
 	}
 
+	movement_costs_changed();
+
+	//the chance of healing is taken once for each slice passed.
 	const_formula_ptr heal_formula = formula_registry::get_stat_calculation("heal_amount");
 	const int healing = heal();
 	foreach(const character_ptr& c, members_) {
 		if(heal_formula) {
-			variant amount = heal_formula->execute(
-							map_formula_callable_ptr(new map_formula_callable(c.get()))->add("heal",variant(healing)));
-			c->heal(amount.as_int());
+			map_formula_callable_ptr callable(new map_formula_callable(c.get()));
+			callable->add("heal",variant(healing));
+			for(int n = 0; n != slices; ++n) {
+				c->heal(heal_formula->execute(*callable).as_int());
+			}
 		}
 	}
 }
@@ -338,7 +404,7 @@ void party::pass(int slices)
 void party::finish_move()
 {
 	if(loc() != previous_loc()) {
-		world_->fire_event("end_move", *this);
+		world_->fire_event(EndMoveEvent, *this);
 		previous_loc_ = loc_;
 	}
 }
@@ -346,36 +412,44 @@ void party::finish_move()
 int party::movement_cost(const hex::location& src,
                          const hex::location& dst) const
 {
-	if(map().is_loc_on_map(src) == false ||
-	   map().is_loc_on_map(dst) == false) {
-		return -1;
-	}
+	return movement_costs()->cost(src, dst);
+}
 
-	const hex::tile& t1 = map().get_tile(src);
-	const hex::tile& t2 = map().get_tile(dst);
+int party::move_time(const hex::location& src, const hex::location& dst) const
+{
+	return movement_cost(src, dst)/move_mode_*game_world().scale();
+}
 
-	if(!t1.is_passable(hex::get_adjacent_direction(src, dst))) {
-		return -1;
+const const_movement_cost_grid_ptr& party::movement_costs() const
+{
+	if(!cost_grid_ || !cost_grid_->is_current() ||
+	   &cost_grid_->map() != &map()) {
+		cost_grid_stale_ = false;
+		cost_grid_ = world_->get_movement_cost_grid(movement_profile(members_));
+	} else if(cost_grid_stale_) {
+		//most changes, such as a little fatigue, leave the costs as they
+		//were, so the grid is only given up if the profile is different.
+		//Holding on to it keeps the world from throwing it away.
+		cost_grid_stale_ = false;
+		const movement_profile profile(members_);
+		if(!(profile == cost_grid_->profile())) {
+			cost_grid_ = world_->get_movement_cost_grid(profile);
+		}
 	}
 
-	const int gradient = t2.height() - t1.height();
-	const hex::const_base_terrain_ptr terrain = t2.terrain();
-	const hex::const_terrain_feature_ptr feature = t2.feature();
-
-	int res = -1;
-	for(std::vector<character_ptr>::const_iterator i = members_.begin();
-	    i != members_.end(); ++i) {
-		const int cost = (*i)->move_cost(terrain,feature,gradient);
-		if(cost < 0) {
-			return -1;
-		}
+	return cost_grid_;
+}
 
-		if(res == -1 || cost > res) {
-			res = cost;
-		}
+const_path_snapshot_ptr party::path_snapshot() const
+{
+	std::set<hex::location> blocked;
+	std::vector<const_party_ptr> visible;
+	world_->parties().get_visible(get_field_of_view(), visible);
+	foreach(const const_party_ptr& p, visible) {
+		blocked.insert(p->loc());
 	}
 
-	return res;
+	return const_path_snapshot_ptr(new game_logic::path_snapshot(movement_costs(), blocked));
 }
 
 bool party::allowed_to_move(const hex::location& loc) const
@@ -389,11 +463,9 @@ void party::apply_fatigue(const hex::location& src,
 {
 	assert(map().is_loc_on_map(src));
 	assert(map().is_loc_on_map(dst));
-	const hex::tile& t1 = map().get_tile(src);
-	const hex::tile& t2 = map().get_tile(dst);
-	const int gradient = t2.height() - t1.height();
-	const hex::const_base_terrain_ptr terrain = t2.terrain();
-	const hex::const_terrain_feature_ptr feature = t2.feature();
+	const int gradient = map().height(dst) - map().height(src);
+	const hex::const_base_terrain_ptr terrain = map().terrain(dst);
+	const hex::const_terrain_feature_ptr feature = map().feature(dst);
 
 	foreach(const character_ptr& c, members_) {
 		const int cost = c->move_cost(terrain,feature,gradient)*move_mode_*move_mode_;
@@ -402,6 +474,14 @@ void party::apply_fatigue(const hex::location& src,
 	}
 }
 
+int party::fatigue_cost(const character& c, const hex::location& src,
+                        const hex::location& dst) const
+{
+	const int gradient = map().height(dst) - map().height(src);
+	return c.move_cost(map().terrain(dst),map().feature(dst),gradient)*
+	       move_mode_*move_mode_;
+}
+
 const hex::gamemap& party::map() const
 {
 	return world_->map();
@@ -498,41 +578,40 @@ GLfloat party::get_rotation() const
 
 const std::set<hex::location>& party::get_visible_locs() const
 {
-	if(visible_locs_.empty() == false) {
-		return visible_locs_;
-	}
+	return get_field_of_view().visible_locs();
+}
 
+void party::get_visible_parties(std::vector<const_party_ptr>& parties) const
+{
+	//only the parties around this one are looked at.
 	const int range = vision();
-
-	visible_locs_.insert(loc_);
-	bool found = true;
-	for(int radius = 1; found && radius < range; ++radius) {
-		found = false;
-		std::vector<hex::location> locs;
-		hex::get_tile_ring(loc_,radius,locs);
-		for(std::vector<hex::location>::const_iterator i = locs.begin();
-		    i != locs.end(); ++i) {
-			if(world_->map().has_line_of_sight(loc_,*i)) {
-                            found = true;
-                            visible_locs_.insert(*i);
-			}
+	const int begin = parties.size();
+	world_->parties().get_visible(get_field_of_view(), parties);
+	int end = begin;
+	for(int n = begin; n != parties.size(); ++n) {
+		if(range >= hex::distance_between(loc_, parties[n]->loc())) {
+			parties[end++] = parties[n];
 		}
 	}
 
-	return visible_locs_;
+	parties.resize(end);
 }
 
-void party::get_visible_parties(std::vector<const_party_ptr>& parties) const
+const hex::field_of_view& party::get_field_of_view() const
 {
-	const int range = vision();
-	world::party_map& all = world_->parties();
-	for(world::party_map::iterator i = all.begin(); i != all.end(); ++i) {
-		if(range >= hex::distance_between(loc_,i->first)) {
-			if(world_->map().has_line_of_sight(loc_,i->first)) {
-				parties.push_back(i->second);
-			}
-		}
+	const int range = std::max(vision(), 0);
+	if(world_->settlement_at(loc_)) {
+		static_fov_ = world_->get_static_field_of_view(loc_, range);
+		return *static_fov_;
+	}
+
+	static_fov_.reset();
+	if(fov_.center() != loc_ || fov_.radius() != range ||
+	   !fov_.is_current(world_->map())) {
+		fov_.calculate(world_->map(), loc_, range);
 	}
+
+	return fov_;
 }
 
 int party::vision() const
@@ -567,6 +646,7 @@ int party::trackability() const
 void party::destroy()
 {
 	members_.clear();
+	movement_costs_changed();
 }
 
 bool party::is_destroyed() const
@@ -614,6 +694,8 @@ void party::assign_equipment(character_ptr c,
 	if(inventory_[party_item]->is_null()) {
 		inventory_.erase(inventory_.begin()+party_item);
 	}
+
+	movement_costs_changed();
 }
 
 void party::get_inputs(std::vector<formula_input>* inputs) const
@@ -700,6 +782,8 @@ void party::set_value(const std::string& key, const variant& value)
 				}
 			}
 		}
+
+		movement_costs_changed();
 	} else if(key == "money") {
 		money_ = value.as_int();
 	} else if(key == "loc") {
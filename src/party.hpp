@@ -19,13 +19,16 @@
 #include <vector>
 
 #include "character_fwd.hpp"
+#include "field_of_view.hpp"
 #include "formula.hpp"
 #include "formula_callable.hpp"
 #include "gamemap.hpp"
 #include "game_time.hpp"
 #include "item_fwd.hpp"
 #include "map_avatar.hpp"
+#include "movement_cost_grid.hpp"
 #include "party_fwd.hpp"
+#include "path_service.hpp"
 #include "pathfind.hpp"
 #include "tile_logic.hpp"
 #include "wml_command_fwd.hpp"
@@ -63,7 +66,7 @@ public:
 
 	void new_world(world& w, const hex::location& loc, hex::DIRECTION dir=hex::NULL_DIRECTION);
 
-	enum TURN_RESULT { TURN_COMPLETE, TURN_STILL_THINKING };
+	enum TURN_RESULT { TURN_COMPLETE, TURN_STILL_THINKING, TURN_WAITING_FOR_PATH };
 	TURN_RESULT play_turn();
 
 	virtual bool is_human_controlled() const = 0;
@@ -71,6 +74,14 @@ public:
 
 	game_time ready_to_move_at() const;
 
+	//where the party is in its world's queue of parties waiting to move,
+	//and in its world's index of where parties are, so the world can
+	//find it in them at once.
+	int queue_handle() const { return queue_handle_; }
+	void set_queue_handle(int h) { queue_handle_ = h; }
+	int grid_handle() const { return grid_handle_; }
+	void set_grid_handle(int h) { grid_handle_ = h; }
+
 	void get_pos(GLfloat* pos) const;
 	GLfloat get_rotation() const;
 
@@ -97,6 +108,11 @@ public:
 
 	virtual void encounter(party& p, const std::string& type) {}
 
+	//a party nobody is near may only take a turn now and then. When
+	//somebody comes near, it is woken so its next turn is now. Returns
+	//false if the party wasn't waiting like that.
+	virtual bool wake() { return false; }
+
 	world& game_world() { return *world_; }
 	const world& game_world() const { return *world_; }
 
@@ -120,6 +136,11 @@ public:
 	int money() const { return money_; }
 	void get_money(int m) { money_ += m; }
 
+	//gives the party money, and each of chars xp, without showing
+	//anything. Experience is given a point at a time, the way the post
+	//battle dialog does, so a character can go up several levels.
+	void award(int xp, int money, const std::vector<character_ptr>& chars);
+
 	bool has_script() const { return !scripted_moves_.empty(); }
 	void add_scripted_move(const hex::location& loc) {
 		scripted_moves_.push_back(loc);
@@ -128,6 +149,17 @@ public:
 	void pass(int minutes=1);
 	void finish_move();
 
+	//marks the party's movement costs as possibly out of date, so they
+	//will be checked the next time they're needed. Must be called when
+	//anything that affects the party's movement, such as its members,
+	//their equipment, or their fatigue, changes. The costs are only
+	//calculated again if what they depend on really has changed.
+	void movement_costs_changed() { cost_grid_stale_ = true; }
+
+	//returns a copy of the party's movement costs, and of the hexes it
+	//can't move into, which can be searched by the path_service.
+	const_path_snapshot_ptr path_snapshot() const;
+
     hex::const_map_avatar_ptr avatar() const { return avatar_; }
 
     void update_rotation(int key) const;
@@ -138,8 +170,29 @@ public:
 								world& world) const;
 protected:
 	void move(hex::DIRECTION dir);
+
+	//moves the party along path, a line of adjacent hexes leading on
+	//from where it is, in a single turn. It leaves tracks on each hex as
+	//it would moving a hex at a time, but takes the fatigue of the whole
+	//way at once and fires begin_move only once. The party set off at
+	//start, which may be before now if it is catching up with where it
+	//would have got to; it is ready to move again once it would reach
+	//the end of the path.
+	void move_along(const std::vector<hex::location>& path,
+	                const game_time& start);
+
+	//the party does nothing until t, without resting as pass() does.
+	void wait_until(const game_time& t) { arrive_at_ = t; }
+
+	//how long it takes the party to move from src to the adjacent dst.
+	int move_time(const hex::location& src, const hex::location& dst) const;
+
+	//the stamina moving from src to the adjacent dst costs c.
+	int fatigue_cost(const character& c, const hex::location& src,
+	                 const hex::location& dst) const;
 	int movement_cost(const hex::location& src,
 	                  const hex::location& dst) const;
+	const const_movement_cost_grid_ptr& movement_costs() const;
 	bool allowed_to_move(const hex::location& loc) const;
 	const hex::gamemap& map() const;
 	virtual void set_value(const std::string& key, const variant& value);
@@ -176,12 +229,21 @@ private:
 	hex::DIRECTION facing_, last_facing_;
 	hex::DIRECTION last_move_;
 	game_time departed_at_, arrive_at_;
+	int queue_handle_, grid_handle_;
 
 	std::vector<character_ptr> members_;
 
 	std::string allegiance_;
 
-	mutable std::set<hex::location> visible_locs_;
+	//what can be seen from where the party is, recalculated when the
+	//party moves, its vision changes, or the map is modified. At
+	//settlements the world's field of view is used instead.
+	const hex::field_of_view& get_field_of_view() const;
+	mutable hex::field_of_view fov_;
+	mutable hex::const_field_of_view_ptr static_fov_;
+
+	mutable const_movement_cost_grid_ptr cost_grid_;
+	mutable bool cost_grid_stale_;
 
 	MOVEMENT_MODE move_mode_;
 
@@ -0,0 +1,207 @@
+/*
+   Copyright (C) 2007 by David White <dave.net>
+   Part of the Silver Tree Project
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 2 or later.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY.
+
+   See the COPYING file for more details.
+*/
+#include <algorithm>
+#include <iostream>
+
+#include "foreach.hpp"
+#include "path_service.hpp"
+#include "preferences.hpp"
+
+namespace game_logic
+{
+
+path_snapshot::path_snapshot(const_movement_cost_grid_ptr grid,
+                             const std::set<hex::location>& blocked)
+  : grid_(grid), blocked_(blocked),
+    width_(grid->map().size().x()), height_(grid->map().size().y())
+{
+}
+
+int path_snapshot::movement_cost(const hex::location& a,
+                                 const hex::location& b) const
+{
+	//the grid's own bounds checks use the map, which may change or go
+	//away while we're searching, so check against our copy of its size.
+	if(!is_loc_on_map(a) || !is_loc_on_map(b)) {
+		return -1;
+	}
+
+	const hex::DIRECTION dir = hex::get_adjacent_direction(a, b);
+	if(dir == hex::NULL_DIRECTION) {
+		return -1;
+	}
+
+	return grid_->cost(a, dir);
+}
+
+bool path_snapshot::allowed_to_move(const hex::location& a) const
+{
+	return is_loc_on_map(a) && blocked_.count(a) == 0;
+}
+
+path_job::path_job(const hex::location& src, const hex::location& dst,
+                   const_path_snapshot_ptr calc, int max_cost,
+                   bool adjacent_only)
+  : src_(src), dst_(dst), calc_(calc), max_cost_(max_cost),
+    adjacent_only_(adjacent_only), cost_(-1), ready_(false),
+    cancelled_(false), queued_at_(SDL_GetTicks())
+{
+}
+
+void path_job::cancel()
+{
+	threading::lock l(path_service::get().mutex_);
+	cancelled_ = true;
+}
+
+path_service& path_service::get()
+{
+	static path_service service;
+	return service;
+}
+
+path_service::path_service()
+  : started_(false), shutting_down_(false),
+    searches_(0), cancelled_(0), max_queue_length_(0),
+    total_wait_(0), max_wait_(0), total_search_(0)
+{
+}
+
+path_service::~path_service()
+{
+	{
+		threading::lock l(mutex_);
+		shutting_down_ = true;
+	}
+
+	work_available_.notify_all();
+	workers_.clear();
+}
+
+path_job_ptr path_service::find_path(const hex::location& src,
+                                     const hex::location& dst,
+                                     const_path_snapshot_ptr calc,
+                                     int max_cost, bool adjacent_only)
+{
+	path_job_ptr job(new path_job(src, dst, calc, max_cost, adjacent_only));
+	start_workers();
+	if(workers_.empty()) {
+		//with no threads to hand it to, the search is made right away,
+		//and there's nothing to wait for.
+		run_job(*job);
+		job->ready_ = true;
+		return job;
+	}
+
+	{
+		threading::lock l(mutex_);
+		queue_.push_back(job);
+		max_queue_length_ = std::max<int>(max_queue_length_, queue_.size());
+	}
+
+	work_available_.notify_one();
+	return job;
+}
+
+void path_service::deliver()
+{
+	std::vector<path_job_ptr> finished;
+	{
+		threading::lock l(mutex_);
+		finished.swap(finished_);
+	}
+
+	foreach(const path_job_ptr& job, finished) {
+		job->ready_ = true;
+	}
+}
+
+void path_service::shutdown(std::ostream& stats)
+{
+	{
+		threading::lock l(mutex_);
+		shutting_down_ = true;
+	}
+
+	work_available_.notify_all();
+	workers_.clear();
+
+	stats << "path service: " << searches_ << " searches, "
+	      << cancelled_ << " cancelled before starting, "
+	      << "longest queue " << max_queue_length_ << "\n";
+	if(searches_) {
+		stats << "path service: average wait " << (total_wait_/searches_)
+		      << "ms, longest wait " << max_wait_ << "ms, average search "
+		      << (total_search_/searches_) << "ms\n";
+	}
+}
+
+void path_service::start_workers()
+{
+	if(started_) {
+		return;
+	}
+
+	started_ = true;
+	const int nthreads = preference_path_threads();
+	for(int n = 0; n < nthreads; ++n) {
+		workers_.push_back(boost::shared_ptr<threading::thread>(
+		                new threading::thread(run_worker, this)));
+	}
+}
+
+int path_service::run_worker(void* arg)
+{
+	path_service& service = *static_cast<path_service*>(arg);
+	for(;;) {
+		path_job_ptr job;
+		{
+			threading::lock l(service.mutex_);
+			while(!service.shutting_down_ && service.queue_.empty()) {
+				service.work_available_.wait(service.mutex_);
+			}
+
+			if(service.shutting_down_) {
+				return 0;
+			}
+
+			job = service.queue_.front();
+			service.queue_.pop_front();
+			if(job->cancelled_) {
+				++service.cancelled_;
+				continue;
+			}
+		}
+
+		service.run_job(*job);
+
+		threading::lock l(service.mutex_);
+		service.finished_.push_back(job);
+	}
+}
+
+void path_service::run_job(path_job& job)
+{
+	const Uint32 start = SDL_GetTicks();
+	job.cost_ = hex::find_path(job.src_, job.dst_, *job.calc_, &job.path_,
+	                           job.max_cost_, job.adjacent_only_);
+	job.calc_.reset();
+	const Uint32 end = SDL_GetTicks();
+
+	threading::lock l(mutex_);
+	++searches_;
+	total_wait_ += start - job.queued_at_;
+	max_wait_ = std::max(max_wait_, start - job.queued_at_);
+	total_search_ += end - start;
+}
+
+}
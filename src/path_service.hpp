@@ -0,0 +1,143 @@
+/*
+   Copyright (C) 2007 by David White <dave.net>
+   Part of the Silver Tree Project
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 2 or later.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY.
+
+   See the COPYING file for more details.
+*/
+#ifndef PATH_SERVICE_HPP_INCLUDED
+#define PATH_SERVICE_HPP_INCLUDED
+
+#include <boost/shared_ptr.hpp>
+#include <deque>
+#include <iosfwd>
+#include <set>
+#include <vector>
+
+#include "movement_cost_grid.hpp"
+#include "pathfind.hpp"
+#include "threading.hpp"
+#include "tile_logic.hpp"
+
+namespace game_logic
+{
+
+//a copy of everything a search needs to know about how a party moves,
+//taken at the time the search is requested. Nothing in it changes
+//afterwards, so it can be searched on another thread while the world
+//carries on.
+class path_snapshot : public hex::path_cost_calculator
+{
+public:
+	path_snapshot(const_movement_cost_grid_ptr grid,
+	              const std::set<hex::location>& blocked);
+
+	int movement_cost(const hex::location& a, const hex::location& b) const;
+	bool allowed_to_move(const hex::location& a) const;
+
+private:
+	bool is_loc_on_map(const hex::location& loc) const {
+		return loc.x() >= 0 && loc.y() >= 0 &&
+		       loc.x() < width_ && loc.y() < height_;
+	}
+
+	const_movement_cost_grid_ptr grid_;
+	std::set<hex::location> blocked_;
+	int width_, height_;
+};
+
+typedef boost::shared_ptr<const path_snapshot> const_path_snapshot_ptr;
+
+//a search which has been requested from the path_service. The result
+//becomes available at the first call to path_service::deliver() after
+//the search has finished, so it never changes in the middle of a tick.
+//When there are no worker threads, the search is made when it's
+//requested, and is ready straight away.
+class path_job
+{
+public:
+	const hex::location& src() const { return src_; }
+	const hex::location& dst() const { return dst_; }
+
+	bool ready() const { return ready_; }
+
+	//the path found, from the destination back to the source, in the same
+	//form as hex::find_path returns. Only valid once ready().
+	const std::vector<hex::location>& path() const { return path_; }
+	int cost() const { return cost_; }
+
+	//tells the service the result is no longer wanted. If the search
+	//hasn't started yet, it never will.
+	void cancel();
+
+private:
+	friend class path_service;
+	path_job(const hex::location& src, const hex::location& dst,
+	         const_path_snapshot_ptr calc, int max_cost,
+	         bool adjacent_only);
+
+	hex::location src_, dst_;
+	const_path_snapshot_ptr calc_;
+	int max_cost_;
+	bool adjacent_only_;
+
+	std::vector<hex::location> path_;
+	int cost_;
+	bool ready_;
+	bool cancelled_;
+	Uint32 queued_at_;
+};
+
+typedef boost::shared_ptr<path_job> path_job_ptr;
+
+//searches for paths on a pool of worker threads, so that long searches
+//don't hold up the world. The number of searches running at once is
+//limited by the number of workers; any more wait in a queue.
+class path_service
+{
+public:
+	static path_service& get();
+
+	path_job_ptr find_path(const hex::location& src,
+	                       const hex::location& dst,
+	                       const_path_snapshot_ptr calc,
+	                       int max_cost=10000, bool adjacent_only=false);
+
+	//makes the results of all searches which have finished available.
+	//Must be called from the main thread, once per world tick.
+	void deliver();
+
+	//waits for the workers to finish and reports timing statistics.
+	void shutdown(std::ostream& stats);
+
+private:
+	path_service();
+	~path_service();
+	path_service(const path_service&);
+	void operator=(const path_service&);
+
+	friend class path_job;
+
+	static int run_worker(void* service);
+	void run_job(path_job& job);
+	void start_workers();
+
+	threading::mutex mutex_;
+	threading::condition work_available_;
+	std::deque<path_job_ptr> queue_;
+	std::vector<path_job_ptr> finished_;
+	std::vector<boost::shared_ptr<threading::thread> > workers_;
+	bool started_, shutting_down_;
+
+	//statistics, protected by mutex_.
+	int searches_, cancelled_, max_queue_length_;
+	Uint32 total_wait_, max_wait_, total_search_;
+};
+
+}
+
+#endif
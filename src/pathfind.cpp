@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <functional>
 #include <iostream>
 #include <queue>
@@ -8,6 +9,14 @@
 
 #include "SDL.h"
 
+#ifdef UNIT_TEST_FIND_REACHABLE
+#include "base_terrain.hpp"
+#include "filesystem.hpp"
+#include "foreach.hpp"
+#include "gamemap.hpp"
+#include "terrain_feature.hpp"
+#endif
+
 namespace hex
 {
 
@@ -156,4 +165,277 @@ int find_path(const location& src, const location& dst, const path_cost_calculat
 	return -1;
 }
 
+namespace {
+
+struct reachable_search {
+	reachable_search(const location& src, const location& dim,
+	                 const path_cost_calculator& calc, int max_steps,
+	                 int max_cost)
+	  : src(src), dim(dim), calc(calc), max_steps(max_steps),
+	    max_cost(max_cost), width(max_steps*2 + 1),
+	    best(width*width, -1), route(width*width, -1),
+	    step_costs(width*width*6, Unknown)
+	{}
+
+	enum { Unknown = -2 };
+
+	//tiles are stored in a square around src just big enough to hold
+	//every tile within max_steps of it.
+	int index(const location& loc) const {
+		return (loc.y() - src.y() + max_steps)*width +
+		        loc.x() - src.x() + max_steps;
+	}
+
+	void search(const location& loc, int parent, int cost, int steps);
+
+	const location src, dim;
+	const path_cost_calculator& calc;
+	const int max_steps, max_cost, width;
+
+	//the cost of the route found to each tile, or -1.
+	std::vector<int> best;
+
+	//the last step of the route found to each tile, or -1. Steps point
+	//back to the step before them, and are never changed once made, so a
+	//route stays the same even if a cheaper route to a tile on it is
+	//found later.
+	std::vector<int> route;
+	std::vector<std::pair<location,int> > steps;
+
+	//the cost of moving from each tile in each direction, filled in the
+	//first time it's needed.
+	std::vector<int> step_costs;
+};
+
+void reachable_search::search(const location& loc, int parent, int cost,
+                              int nsteps)
+{
+	const int i = index(loc);
+	if(best[i] != -1 && best[i] <= cost) {
+		return;
+	}
+
+	best[i] = cost;
+	route[i] = steps.size();
+	steps.push_back(std::make_pair(loc, parent));
+	if(nsteps == max_steps) {
+		return;
+	}
+
+	const int step = route[i];
+	location adj[6];
+	get_adjacent_tiles(loc, adj);
+	for(int n = 0; n != 6; ++n) {
+		if(adj[n].x() < 0 || adj[n].y() < 0 ||
+		   adj[n].x() >= dim.x() || adj[n].y() >= dim.y() ||
+		   !calc.allowed_to_move(adj[n]) ||
+		   distance_between(adj[n], src) > max_steps) {
+			continue;
+		}
+
+		int& move_cost = step_costs[i*6 + n];
+		if(move_cost == Unknown) {
+			move_cost = calc.movement_cost(loc, adj[n]);
+		}
+
+		if(move_cost >= 0 && cost + move_cost <= max_cost) {
+			search(adj[n], step, cost + move_cost, nsteps + 1);
+		}
+	}
+}
+
+}
+
+void find_reachable(const location& src, const location& dim,
+                    const path_cost_calculator& calc, int max_steps,
+                    int max_cost, route_map& result)
+{
+	result.clear();
+	if(src.x() < 0 || src.y() < 0 || src.x() >= dim.x() || src.y() >= dim.y()) {
+		return;
+	}
+
+	reachable_search s(src, dim, calc, max_steps, max_cost);
+	s.search(src, -1, 0, 0);
+
+	//go through the tiles in the order they're sorted in, so each one
+	//can be added to the end of the result.
+	for(int x = std::max(0, src.x() - max_steps);
+	    x <= std::min(dim.x() - 1, src.x() + max_steps); ++x) {
+		for(int y = std::max(0, src.y() - max_steps);
+		    y <= std::min(dim.y() - 1, src.y() + max_steps); ++y) {
+			const location loc(x, y);
+			int step = s.route[s.index(loc)];
+			if(step == -1) {
+				continue;
+			}
+
+			std::vector<location>& r = result.insert(result.end(),
+			     std::make_pair(loc, std::vector<location>()))->second;
+			for(; step != -1; step = s.steps[step].second) {
+				r.push_back(s.steps[step].first);
+			}
+
+			std::reverse(r.begin(), r.end());
+		}
+	}
+}
+
+#ifdef UNIT_TEST_FIND_REACHABLE
+
+namespace {
+
+//moves at about the speed of a battle character over the terrain of a
+//map, between tiles nobody is standing on.
+class terrain_cost_calculator : public path_cost_calculator {
+public:
+	terrain_cost_calculator(const gamemap& m, const std::set<location>& occupied)
+	  : map_(m), occupied_(occupied)
+	{}
+
+	int movement_cost(const location& a, const location& b) const {
+		if(!map_.is_loc_on_map(a) || !map_.is_loc_on_map(b) ||
+		   !map_.terrain(b)) {
+			return -1;
+		}
+
+		int cost = map_.terrain(b)->default_cost();
+		if(cost >= 0 && map_.feature(b)) {
+			const int feature_cost = map_.feature(b)->default_cost();
+			cost = feature_cost < 0 ? -1 : cost + feature_cost;
+		}
+
+		if(cost < 0) {
+			return -1;
+		}
+
+		const int climb = std::abs(map_.height(b) - map_.height(a));
+		return ((100 + climb*climb*10)*cost)/8000;
+	}
+
+	bool allowed_to_move(const location& a) const {
+		return occupied_.count(a) == 0;
+	}
+
+private:
+	const gamemap& map_;
+	const std::set<location>& occupied_;
+};
+
+//the way battle characters used to find where they could move to, by
+//following every route.
+void find_reachable_by_routes(const location& dim,
+                              const path_cost_calculator& calc,
+                              std::vector<location>& r, int max_steps,
+                              int max_cost, route_map& result)
+{
+	int cost = 0;
+	for(int n = 0; n+1 < r.size(); ++n) {
+		const int step = calc.movement_cost(r[n], r[n+1]);
+		if(step < 0) {
+			return;
+		}
+
+		cost += step;
+	}
+
+	if(cost > max_cost) {
+		return;
+	}
+
+	route_map::iterator cur = result.find(r.back());
+	if(cur != result.end()) {
+		int cur_cost = 0;
+		for(int n = 0; n+1 < cur->second.size(); ++n) {
+			cur_cost += calc.movement_cost(cur->second[n], cur->second[n+1]);
+		}
+
+		if(cur_cost <= cost) {
+			return;
+		}
+	}
+
+	result[r.back()] = r;
+	if(r.size() == max_steps+1) {
+		return;
+	}
+
+	location adj[6];
+	get_adjacent_tiles(r.back(), adj);
+	for(int n = 0; n != 6; ++n) {
+		if(adj[n].x() < 0 || adj[n].y() < 0 ||
+		   adj[n].x() >= dim.x() || adj[n].y() >= dim.y() ||
+		   !calc.allowed_to_move(adj[n]) ||
+		   distance_between(adj[n], r.front()) > max_steps) {
+			continue;
+		}
+
+		r.push_back(adj[n]);
+		find_reachable_by_routes(dim, calc, r, max_steps, max_cost, result);
+		r.pop_back();
+	}
+}
+
+}
+
+void unit_test_find_reachable()
+{
+	const gamemap m(sys::read_file("data/maps/bandit-fort"));
+
+	//stand characters around the map, as in a battle.
+	std::set<location> occupied;
+	for(int x = 1; x < m.size().x(); x += 5) {
+		for(int y = 2; y < m.size().y(); y += 4) {
+			occupied.insert(location(x,y));
+		}
+	}
+
+	std::vector<location> starts;
+	for(int x = 0; x < m.size().x(); x += 3) {
+		for(int y = 0; y < m.size().y(); y += 3) {
+			if(!occupied.count(location(x,y))) {
+				starts.push_back(location(x,y));
+			}
+		}
+	}
+
+	const terrain_cost_calculator calc(m, occupied);
+	const int max_cost = 10;
+	for(int max_steps = 3; max_steps <= 10; ++max_steps) {
+		int tiles = 0;
+		foreach(const location& src, starts) {
+			route_map routes, expected;
+			find_reachable(src, m.size(), calc, max_steps, max_cost, routes);
+			std::vector<location> r(1, src);
+			find_reachable_by_routes(m.size(), calc, r, max_steps, max_cost, expected);
+			assert(routes == expected);
+			tiles += routes.size();
+		}
+
+		route_map routes;
+		int start = SDL_GetTicks();
+		foreach(const location& src, starts) {
+			find_reachable(src, m.size(), calc, max_steps, max_cost, routes);
+		}
+
+		const int search_ms = SDL_GetTicks() - start;
+		start = SDL_GetTicks();
+		foreach(const location& src, starts) {
+			routes.clear();
+			std::vector<location> r(1, src);
+			find_reachable_by_routes(m.size(), calc, r, max_steps, max_cost, routes);
+		}
+
+		const int routes_ms = SDL_GetTicks() - start;
+		std::cerr << "find reachable: " << max_steps << " steps: "
+		          << (tiles/static_cast<double>(starts.size()))
+		          << " tiles reached; "
+		          << (search_ms*1000.0/starts.size()) << "us searching, "
+		          << (routes_ms*1000.0/starts.size())
+		          << "us following every route\n";
+	}
+}
+
+#endif
+
 }
@@ -1,6 +1,7 @@
 #ifndef PATHFIND_HPP_INCLUDED
 #define PATHFIND_HPP_INCLUDED
 
+#include <map>
 #include <vector>
 
 #include "tile_logic.hpp"
@@ -18,6 +19,23 @@ public:
 
 int find_path(const location& src, const location& dst, const path_cost_calculator& calc, std::vector<location>* result, int max_cost=10000, bool adjacent_only=false, bool find_partial_result=false);
 
+//finds every tile on a map of size dim that can be reached from src in
+//at most max_steps steps for at most max_cost, with the route to it.
+//Tiles further than max_steps from src are never entered. Routes are
+//followed depth first, trying neighbours in the order
+//get_adjacent_tiles() gives them, and the route to a tile is only
+//replaced by a cheaper one, so where routes cost the same the one found
+//first is kept. Each tile is left at most max_cost+1 times, once for each
+//cost it's reached at more cheaply than before.
+typedef std::map<location, std::vector<location> > route_map;
+void find_reachable(const location& src, const location& dim,
+                    const path_cost_calculator& calc, int max_steps,
+                    int max_cost, route_map& result);
+
+#ifdef UNIT_TEST_FIND_REACHABLE
+void unit_test_find_reachable();
+#endif
+
 }
 
 #endif
@@ -11,9 +11,8 @@
    See the COPYING file for more details.
 */
 #include "foreach.hpp"
-#include "global_game_state.hpp"
 #include "keyboard.hpp"
-#include "pathfind.hpp"
+#include "path_service.hpp"
 #include "pc_party.hpp"
 #include "tile_logic.hpp"
 #include "world.hpp"
@@ -23,6 +22,10 @@
 namespace game_logic
 {
 
+namespace {
+const event_id SightEvent = get_event_id("sight");
+}
+
 pc_party::pc_party(wml::const_node_ptr node, world& game_world)
    : party(node,game_world)
 {
@@ -38,11 +41,18 @@ wml::node_ptr pc_party::write() const
 void pc_party::set_destination(const hex::location& dst)
 {
 	path_.clear();
-	const bool adjacent_only = get_visible_locs().count(dst) && game_world().get_party_at(dst);
-	hex::find_path(loc(), dst, *this, &path_, 100000, adjacent_only);
-	if(path_.empty() == false && path_.back() == loc()) {
-		path_.pop_back();
+	path_fallback_ = hex::location();
+	if(path_job_) {
+		path_job_->cancel();
+		path_job_.reset();
+	}
+
+	if(dst == loc()) {
+		return;
 	}
+
+	const bool adjacent_only = get_visible_locs().count(dst) && game_world().get_party_at(dst);
+	path_job_ = path_service::get().find_path(loc(), dst, path_snapshot(), 100000, adjacent_only);
 }
 
 const std::vector<hex::location>* pc_party::get_current_path() const
@@ -65,13 +75,12 @@ party::TURN_RESULT pc_party::do_turn()
             continue;
         }
         
-        if(std::find(seen_.begin(), seen_.end(), p) == seen_.end()) {
-            map_formula_callable_ptr callable(new map_formula_callable);
-            callable->add("world", variant(&game_world()))
-                .add("var", variant(&global_game_state::get().get_variables()))
-                .add("pc", variant(this))
+        if(std::find(seen_.begin(), seen_.end(), p) == seen_.end() &&
+           game_world().has_event_handlers(SightEvent, p.get())) {
+            map_formula_callable_ptr callable = game_world().event_callable();
+            callable->add("pc", variant(this))
                 .add("npc", variant(p.get()));
-            game_world().fire_event("sight", *callable);
+            game_world().fire_event(SightEvent, *callable, p.get());
         }
     }
     
@@ -83,7 +92,7 @@ party::TURN_RESULT pc_party::do_turn()
           run, should_pass);
     
     if(dir != hex::NULL_DIRECTION) {
-        path_.clear();
+        set_destination(loc());
         const hex::location dst = tile_in_direction(loc(),dir);
         if(movement_cost(loc(),dst) >= 0) {
             set_movement_mode(run ? RUN : WALK);
@@ -91,11 +100,41 @@ party::TURN_RESULT pc_party::do_turn()
             return TURN_COMPLETE;
         }
     } else if(should_pass) {
-        path_.clear();
+        set_destination(loc());
         pass();
         return TURN_COMPLETE;
     }
     
+    if(path_job_) {
+        if(!path_job_->ready()) {
+            return TURN_WAITING_FOR_PATH;
+        }
+
+        if(path_job_->src() != loc()) {
+            //we were moved while the search was going on, so search
+            //again from where we are now.
+            const hex::location dst = path_job_->dst();
+            set_destination(dst);
+            if(path_job_ && !path_job_->ready()) {
+                return TURN_WAITING_FOR_PATH;
+            }
+        }
+
+        if(path_job_) {
+            path_ = path_job_->path();
+        }
+
+        path_job_.reset();
+
+        //if we couldn't find a way around whatever was in our way,
+        //walk into it.
+        if(path_.empty() && path_fallback_.valid()) {
+            path_.push_back(path_fallback_);
+        }
+
+        path_fallback_ = hex::location();
+    }
+
     if(!path_.empty()) {
         if(path_.back() == loc()) {
             path_.pop_back();
@@ -104,9 +143,8 @@ party::TURN_RESULT pc_party::do_turn()
         if(path_.size() > 1 && game_world().get_party_at(path_.back())) {
             const hex::location loc = path_.back();
             set_destination(path_.front());
-            if(path_.empty()) {
-                path_.push_back(loc);
-            }
+            path_fallback_ = loc;
+            return TURN_WAITING_FOR_PATH;
         }
         
         if(!path_.empty()) {
@@ -127,7 +165,7 @@ party::TURN_RESULT pc_party::do_turn()
 
 void pc_party::enter_new_world(const world& w)
 {
-    path_.clear();
+    set_destination(loc());
 }
 
 }
@@ -41,6 +41,11 @@ private:
 
 	std::vector<const_party_ptr> seen_;
 	std::vector<hex::location> path_;
+
+	//the search for path_ while it's in progress, and where to go if the
+	//search fails.
+	path_job_ptr path_job_;
+	hex::location path_fallback_;
 };
 
 }
@@ -76,8 +76,17 @@ bool parse_args(int argc, char** argv)
 	general.add_options()
 		("nocombat", "debug mode where enemies don't initiate an attack.")
 		("nosliders", "disable sliders in combat.")
+		("fast-battles", "play the turns of computer controlled characters in battle at once, without animating them.")
 		("save", value<string>(), "load the specified saved game.")
 		("scenario", value<string>(), "start the game with the given scenario file.")
+		("path-threads", value<int>(), "number of threads which search for paths (0 to search on the main thread).")
+		("ai-threads", value<int>(), "number of threads which evaluate moves for characters in battle (0 or 1 to use the main thread only).")
+		("ai-think-time", value<int>(), "milliseconds characters in battle may spend looking ahead at each move (0 to choose moves greedily).")
+		("log-ai-think-time", "report how long characters in battle which aren't controlled by the player take to choose each move.")
+		("battle-map-cache", value<string>(), "directory to keep battle maps in once they have been made, so they don't have to be made again.")
+		("settlement-memory", value<int>(), "megabytes of settlements' worlds to keep loaded once the player has left them (defaults to 32).")
+		("world-cache", value<int>(), "number of worlds left through exits to keep loaded, so going back to them is instant (defaults to 2).")
+		("npc-detail-distance", value<int>(), "distance in hexes beyond which computer controlled parties nobody is near only take a turn now and then, catching up along their route (defaults to 30; 0 to always move them a hex at a time).")
 	;
 	options_description graphics("Graphics options");
 	graphics.add_options()
@@ -90,9 +99,24 @@ bool parse_args(int argc, char** argv)
 		("texture-filter-mag", value<filtering_setting<false> >(), "Texture magnification function(n,l).")
 		("texture-filter-anisotropic", "Enable anisotropic filtering.");
 	;
+	options_description simulation("Battle simulation options");
+	simulation.add_options()
+		("simulate-battles", value<int>(), "play the given number of battles without any graphics, report the results and exit.")
+		("battle-side1", value<string>(), "comma separated character generator ids for the first side (the player's side) in simulated battles.")
+		("battle-side2", value<string>(), "comma separated character generator ids for the second side in simulated battles.")
+		("battle-map", value<string>(), "world map which simulated battles take place in the middle of.")
+		("battle-seed", value<int>(), "seed for the first simulated battle; each battle after it uses the next seed.")
+		("battle-processes", value<int>(), "number of processes which play simulated battles (defaults to the number of processors).")
+	;
+	options_description world_simulation("World simulation options");
+	world_simulation.add_options()
+		("headless", "run the game without any graphics or input; with --simulate-days, play the scenario's world on, report what happened and exit.")
+		("simulate-days", value<int>(), "number of game days to play the world on for when running headless.")
+		("world-seed", value<int>(), "seed for the random numbers used when running headless.")
+	;
 
 	options_description all("Allowed options");
-	all.add(generic).add(general).add(graphics);
+	all.add(generic).add(general).add(graphics).add(simulation).add(world_simulation);
 	options_description config_file_options;
 	config_file_options.add(graphics);
 
@@ -144,6 +168,11 @@ bool preference_nocombat()
 	return options.count("nocombat");
 }
 
+bool preference_fast_battles()
+{
+	return options.count("fast-battles");
+}
+
 bool preference_maxfps()
 {
 	return options.count("maxfps");
@@ -164,6 +193,91 @@ unsigned int preference_fullscreen()
 	return options.count("fullscreen") ? SDL_FULLSCREEN : 0;
 }
 
+int preference_path_threads()
+{
+	return options.count("path-threads") ? options["path-threads"].as<int>() : 2;
+}
+
+int preference_ai_threads()
+{
+	return options.count("ai-threads") ? options["ai-threads"].as<int>() : 2;
+}
+
+int preference_ai_think_time()
+{
+	return options.count("ai-think-time") ? options["ai-think-time"].as<int>() : 0;
+}
+
+bool preference_log_ai_think_time()
+{
+	return options.count("log-ai-think-time");
+}
+
+const std::string preference_battle_map_cache()
+{
+	return options.count("battle-map-cache") ? options["battle-map-cache"].as<string>() : string();
+}
+
+int preference_settlement_memory()
+{
+	return options.count("settlement-memory") ? options["settlement-memory"].as<int>() : 32;
+}
+
+int preference_world_cache()
+{
+	return options.count("world-cache") ? options["world-cache"].as<int>() : 2;
+}
+
+int preference_npc_detail_distance()
+{
+	return options.count("npc-detail-distance") ? options["npc-detail-distance"].as<int>() : 30;
+}
+
+int preference_simulate_battles()
+{
+	return options.count("simulate-battles") ? options["simulate-battles"].as<int>() : 0;
+}
+
+const std::string preference_battle_side(int side)
+{
+	const string key = side == 1 ? "battle-side1" : "battle-side2";
+	if(options.count(key)) {
+		return options[key].as<string>();
+	}
+
+	return side == 1 ? string("goblin_spearman,goblin_archer") : string("wolf_rider,goblin");
+}
+
+const std::string preference_battle_map()
+{
+	return options.count("battle-map") ? options["battle-map"].as<string>() : string("data/maps/island1");
+}
+
+int preference_battle_seed()
+{
+	return options.count("battle-seed") ? options["battle-seed"].as<int>() : 1;
+}
+
+int preference_battle_processes()
+{
+	return options.count("battle-processes") ? options["battle-processes"].as<int>() : 0;
+}
+
+bool preference_headless()
+{
+	return options.count("headless");
+}
+
+int preference_simulate_days()
+{
+	return options.count("simulate-days") ? options["simulate-days"].as<int>() : 0;
+}
+
+int preference_world_seed()
+{
+	return options.count("world-seed") ? options["world-seed"].as<int>() : 1;
+}
+
 const std::string preference_save_file()
 {
 	return options.count("save") ? options["save"].as<string>() : string();
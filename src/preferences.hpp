@@ -8,6 +8,7 @@
 bool parse_args(int argc, char** argv);
 
 bool preference_nocombat();
+bool preference_fast_battles();
 bool preference_maxfps();
 bool preference_mipmapping();
 bool preference_sliders();
@@ -20,6 +21,25 @@ int preference_screen_width();
 int preference_screen_height();
 unsigned int preference_fullscreen();
 
+int preference_path_threads();
+int preference_ai_threads();
+int preference_ai_think_time();
+bool preference_log_ai_think_time();
+const std::string preference_battle_map_cache();
+int preference_settlement_memory();
+int preference_world_cache();
+int preference_npc_detail_distance();
+
+int preference_simulate_battles();
+const std::string preference_battle_side(int side);
+const std::string preference_battle_map();
+int preference_battle_seed();
+int preference_battle_processes();
+
+bool preference_headless();
+int preference_simulate_days();
+int preference_world_seed();
+
 const std::string preference_save_file();
 const std::string preference_scenario_file();
 
@@ -15,6 +15,9 @@ public:
 
 	void add_ref() const { ++count_; }
 	void dec_ref() const { if(--count_ == 0) { delete const_cast<reference_counted_object*>(this); } }
+
+	//how many pointers hold the object.
+	int refcount() const { return count_; }
 private:
 	mutable int count_;
 };
@@ -0,0 +1,51 @@
+/*
+   Copyright (C) 2007 by David White <dave.net>
+   Part of the Silver Tree Project
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 2 or later.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY.
+
+   See the COPYING file for more details.
+*/
+#ifndef RNG_HPP_INCLUDED
+#define RNG_HPP_INCLUDED
+
+namespace game_logic
+{
+
+//a small random number generator with its own state, so that anything
+//using one can be replayed exactly by seeding it the same way, without
+//being disturbed by other users of rand().
+class rng
+{
+public:
+	explicit rng(unsigned int seed=0) { set_seed(seed); }
+
+	void set_seed(unsigned int seed) {
+		state_ = (seed*2654435761U) ^ 0x9E3779B9U;
+		if(state_ == 0) {
+			state_ = 1;
+		}
+	}
+
+	unsigned int next() {
+		//xorshift, which goes through every non-zero 32 bit state.
+		state_ ^= state_ << 13;
+		state_ ^= state_ >> 17;
+		state_ ^= state_ << 5;
+		state_ &= 0xFFFFFFFFU;
+		return state_;
+	}
+
+	//a number from 0 to n-1.
+	int operator()(int n) { return static_cast<int>(next()%n); }
+
+private:
+	unsigned int state_;
+};
+
+}
+
+#endif
@@ -10,23 +10,42 @@
 
    See the COPYING file for more details.
 */
+#include <algorithm>
+
+#include "filesystem.hpp"
 #include "foreach.hpp"
 #include "gamemap.hpp"
 #include "model.hpp"
 #include "party.hpp"
+#include "preferences.hpp"
 #include "settlement.hpp"
 #include "tile.hpp"
 #include "world.hpp"
 #include "wml_node.hpp"
+#include "wml_parser.hpp"
 #include "wml_utils.hpp"
 
 namespace game_logic
 {
 
+settlement::lru_list settlement::loaded_;
+size_t settlement::loaded_memory_ = 0;
+int settlement::num_settlements_ = 0;
+
+namespace {
+struct scoped_count {
+	explicit scoped_count(int& n) : n_(n) { ++n_; }
+	~scoped_count() { --n_; }
+	int& n_;
+};
+}
+
 settlement::settlement(const wml::const_node_ptr& node,
                        const hex::gamemap& map)
-  : wml_(node), map_(map)
+  : wml_(node), map_(map), memory_(0), playing_(0)
 {
+	++num_settlements_;
+
 	const std::string& model_height_formula = node->attr("model_height");
 	if(model_height_formula.empty() == false) {
 		model_height_formula_.reset(new formula(model_height_formula));
@@ -45,15 +64,32 @@ settlement::settlement(const wml::const_node_ptr& node,
 		hex::location loc2(wml::get_attr<int>(portal,"xsrc"),
 		                   wml::get_attr<int>(portal,"ysrc"));
 		portals_[loc2] = loc1;
+		if(preference_headless()) {
+			continue;
+		}
+
         avatars_.push_back(hex::map_avatar::create(node, this, count));
         avatar_keys_[count++] = loc2;
 	}
 }
 
+settlement::~settlement()
+{
+	--num_settlements_;
+	if(world_) {
+		loaded_.erase(lru_pos_);
+		loaded_memory_ -= memory_;
+	}
+}
+
 wml::node_ptr settlement::write() const
 {
+	if(!world_) {
+		return wml::deep_copy(wml_);
+	}
+
 	wml::node_ptr res(new wml::node("settlement"));
-	wml::node_ptr world_node = get_world().write();
+	wml::node_ptr world_node = world_->write();
 	wml::copy_over(world_node, res);
 
 	if(!avatars_.empty()) {
@@ -149,7 +185,10 @@ game_time settlement::enter(party_ptr pty, const hex::location& loc,
 	const hex::location old_loc = pty->loc();
 	pty->new_world(w,portals_[loc]);
 	w.add_party(pty);
-	w.play();
+	{
+		const scoped_count playing(playing_);
+		w.play();
+	}
 	if(!pty->loc().valid()) {
 		pty->set_loc(old_loc);
 	}
@@ -160,16 +199,94 @@ game_time settlement::enter(party_ptr pty, const hex::location& loc,
 void settlement::play()
 {
 	get_world();
+	const scoped_count playing(playing_);
 	world_->play();
 }
 
 const world& settlement::get_world() const
 {
 	if(!world_) {
-		world_.reset(new world(wml_));
+		world_.reset(new world(world_wml()));
+		loaded_.push_front(this);
+		lru_pos_ = loaded_.begin();
+	} else {
+		loaded_.splice(loaded_.begin(), loaded_, lru_pos_);
+		loaded_memory_ -= memory_;
 	}
 
+	memory_ = world_->memory_estimate();
+	loaded_memory_ += memory_;
+	unload_idle(this);
 	return *world_;
 }
 
+bool settlement::has_pc_party() const
+{
+	if(world_) {
+		return world_->get_pc_party().get() != NULL;
+	}
+
+	const wml::const_node_ptr node = world_wml();
+	wml::node::const_child_iterator p1 = node->begin_child("party");
+	const wml::node::const_child_iterator p2 = node->end_child("party");
+	for(; p1 != p2; ++p1) {
+		if((*p1->second)["controller"] == "human") {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+int settlement::num_settlements()
+{
+	return num_settlements_;
+}
+
+int settlement::num_loaded()
+{
+	return loaded_.size();
+}
+
+wml::const_node_ptr settlement::world_wml() const
+{
+	const std::string& file = wml_->attr("file");
+	if(file.empty()) {
+		return wml_;
+	}
+
+	wml::node_ptr node = wml::deep_copy(wml_);
+	wml::merge_over(wml::parse_wml(sys::read_file(file)), node);
+	return node;
+}
+
+void settlement::unload() const
+{
+	//the world is written out just as it would be in a saved game, so
+	//it can be made again as it was left.
+	wml_ = write();
+	loaded_.erase(lru_pos_);
+	loaded_memory_ -= memory_;
+	memory_ = 0;
+	world_.reset();
+}
+
+void settlement::unload_idle(const settlement* keep)
+{
+	const size_t budget = size_t(std::max(0, preference_settlement_memory()))*1024*1024;
+	lru_list::reverse_iterator i = loaded_.rbegin();
+	while(loaded_memory_ > budget && i != loaded_.rend()) {
+		const settlement& s = **i;
+		if(&s == keep || s.playing_ || s.has_pc_party()) {
+			++i;
+			continue;
+		}
+
+		//unloading a world also unloads the settlements in it, so
+		//start again from the end of the list.
+		s.unload();
+		i = loaded_.rbegin();
+	}
+}
+
 }
@@ -13,6 +13,8 @@
 #ifndef SETTLEMENT_HPP_INCLUDED
 #define SETTLEMENT_HPP_INCLUDED
 
+#include <list>
+
 #include <boost/shared_ptr.hpp>
 
 #include "formula_fwd.hpp"
@@ -35,8 +37,11 @@ namespace game_logic
 class settlement: public hex::basic_drawable
 {
 public:
+	//node is the settlement's [settlement] element. Its world, which
+	//may be in a file of its own, isn't made until it is first needed.
 	settlement(const wml::const_node_ptr& node,
 	           const hex::gamemap& map);
+	~settlement();
 
 	wml::node_ptr write() const;
 
@@ -46,6 +51,15 @@ public:
 					const game_time& t, const world& from);
 	void play();
 	const world& get_world() const;
+
+	//whether the player's party is in the settlement, found without
+	//making its world if it hasn't been made.
+	bool has_pc_party() const;
+
+	//how many settlements there are, and how many of them have their
+	//worlds loaded.
+	static int num_settlements();
+	static int num_loaded();
     const std::vector<hex::const_map_avatar_ptr>& avatars() { return avatars_; }
 
     void update_rotation(int key) const;
@@ -56,9 +70,27 @@ private:
     std::vector<hex::const_map_avatar_ptr> avatars_;
 	const_formula_ptr model_height_formula_;
 	const_formula_ptr model_rotation_formula_;
-	wml::const_node_ptr wml_;
+	//the WML the world is made from: the [settlement] element until the
+	//world is first made, and what the world wrote out when it was last
+	//unloaded after that.
+	wml::const_node_ptr world_wml() const;
+	mutable wml::const_node_ptr wml_;
 	mutable boost::shared_ptr<world> world_;
 	const hex::gamemap& map_;
+
+	//loaded worlds are kept in order of when they were last used, and
+	//the ones used longest ago are unloaded while they take up more
+	//memory than the preferences allow. A world isn't unloaded while
+	//it is being played or while the player's party is in it.
+	typedef std::list<const settlement*> lru_list;
+	static lru_list loaded_;
+	static size_t loaded_memory_;
+	static int num_settlements_;
+	void unload() const;
+	static void unload_idle(const settlement* keep);
+	mutable lru_list::iterator lru_pos_;
+	mutable size_t memory_;
+	int playing_;
 };
 
 typedef boost::shared_ptr<const settlement> const_settlement_ptr;
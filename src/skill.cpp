@@ -104,7 +104,12 @@ skill::skill(const wml::const_node_ptr& node)
 	if(effects) {
 		for(wml::node::const_attr_iterator i = effects->begin_attr();
 		    i != effects->end_attr(); ++i) {
-			effects_[i->first] = const_formula_ptr(new formula(i->second));
+			const stat_id id = intern_stat(i->first);
+			if(id >= effects_.size()) {
+				effects_.resize(id + 1);
+			}
+
+			effects_[id] = const_formula_ptr(new formula(i->second));
 		}
 	}
 
@@ -115,18 +120,17 @@ skill::skill(const wml::const_node_ptr& node)
 	}
 }
 
-int skill::effect_on_stat(const character& c, const std::string& stat) const
+int skill::effect_on_stat(const character& c, stat_id stat) const
 {
-	if(!is_active(c)) {
+	if(stat < 0 || stat >= effects_.size() || !effects_[stat]) {
 		return 0;
 	}
 
-	std::map<std::string,const_formula_ptr>::const_iterator f = effects_.find(stat);
-	if(f == effects_.end()) {
+	if(!is_active(c)) {
 		return 0;
 	}
 
-	return f->second->execute(c).as_int();
+	return effects_[stat]->execute(c).as_int();
 }
 
 bool skill::is_active(const character& c) const
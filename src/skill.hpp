@@ -21,6 +21,7 @@
 #include "character_fwd.hpp"
 #include "formula.hpp"
 #include "skill_fwd.hpp"
+#include "stat_id.hpp"
 #include "wml_node_fwd.hpp"
 
 namespace game_logic
@@ -48,7 +49,7 @@ public:
 	const std::string& description() const { return description_; }
 	const std::string& prerequisite() const { return prerequisite_; }
 
-	int effect_on_stat(const character& c, const std::string& stat) const;
+	int effect_on_stat(const character& c, stat_id stat) const;
 	const std::vector<const_battle_move_ptr>& moves() const {
 		return moves_;
 	}
@@ -61,7 +62,8 @@ private:
 	std::string description_;
 	std::string prerequisite_;
 	std::vector<skill_requirement_ptr> requirements_;
-	std::map<std::string,const_formula_ptr> effects_;
+	//the formulas for the skill's effects, indexed by stat.
+	std::vector<const_formula_ptr> effects_;
 	std::vector<const_battle_move_ptr> moves_;
 	formula cost_;
 };
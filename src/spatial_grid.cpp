@@ -0,0 +1,149 @@
+/*
+   Copyright (C) 2007 by David White <dave.net>
+   Part of the Silver Tree Project
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 2 or later.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY.
+
+   See the COPYING file for more details.
+*/
+#include "spatial_grid.hpp"
+
+#ifdef UNIT_TEST_SPATIAL_GRID
+
+#include <cassert>
+#include <ctime>
+#include <iostream>
+#include <map>
+
+#include "filesystem.hpp"
+#include "foreach.hpp"
+#include "gamemap.hpp"
+
+namespace hex
+{
+
+namespace {
+
+const int Frames = 10;
+const int VisionRadius = 10;
+
+//moves every value in the grid to a neighbouring tile on the map.
+void move_all(const gamemap& m, std::vector<location>& locs,
+              unsigned int& seed, spatial_grid<int>* grid,
+              std::multimap<location,int>* all)
+{
+	for(int n = 0; n != locs.size(); ++n) {
+		location adj[6];
+		get_adjacent_tiles(locs[n], adj);
+		seed = seed*1103515245 + 12345;
+		const location& dst = adj[(seed >> 16) % 6];
+		if(!m.is_loc_on_map(dst)) {
+			continue;
+		}
+
+		if(grid) {
+			grid->move(n, dst);
+		} else {
+			//the way parties were moved in the world's multimap.
+			typedef std::multimap<location,int>::iterator itor;
+			for(std::pair<itor,itor> range = all->equal_range(locs[n]);
+			    range.first != range.second; ++range.first) {
+				if(range.first->second == n) {
+					all->erase(range.first);
+					break;
+				}
+			}
+			all->insert(std::pair<location,int>(dst, n));
+		}
+
+		locs[n] = dst;
+	}
+}
+
+}
+
+void unit_test_spatial_grid()
+{
+	const gamemap m(sys::read_file("data/maps/island-big"));
+	const location center(m.size().x()/2, m.size().y()/2);
+	field_of_view fov;
+	fov.calculate(m, center, VisionRadius);
+
+	const int sizes[] = {1000, 10000, 100000};
+	foreach(int size, sizes) {
+		double ms[2];
+		int seen[2] = {0,0};
+		for(int pass = 0; pass != 2; ++pass) {
+			std::vector<location> locs;
+			spatial_grid<int> grid(m.size());
+			std::multimap<location,int> all;
+			for(int n = 0; n != size; ++n) {
+				locs.push_back(location((n*7919) % m.size().x(),
+				                        (n*104729) % m.size().y()));
+				if(pass == 1) {
+					assert(grid.insert(n, locs.back()) == n);
+				} else {
+					all.insert(std::pair<location,int>(locs.back(), n));
+				}
+			}
+
+			unsigned int seed = 1;
+			const std::clock_t start = std::clock();
+			for(int frame = 0; frame != Frames; ++frame) {
+				move_all(m, locs, seed, pass == 1 ? &grid : NULL, &all);
+
+				std::vector<int> visible;
+				if(pass == 1) {
+					grid.get_visible(fov, visible);
+				} else {
+					//the way the world found the parties to draw.
+					for(std::multimap<location,int>::const_iterator i =
+					    all.begin(); i != all.end(); ++i) {
+						if(fov.is_visible(i->first)) {
+							visible.push_back(i->second);
+						}
+					}
+				}
+
+				seen[pass] += visible.size();
+			}
+
+			ms[pass] = (1000.0*(std::clock() - start))/CLOCKS_PER_SEC/Frames;
+
+			if(pass == 1) {
+				for(int n = 0; n != size; ++n) {
+					assert(grid.loc(n) == locs[n]);
+					std::vector<int> at;
+					assert(grid.get_at(locs[n], at));
+					assert(std::count(at.begin(), at.end(), n) == 1);
+				}
+
+				std::vector<int> near;
+				grid.get_in_radius(center, VisionRadius, near);
+				foreach(int n, near) {
+					assert(distance_between(center, locs[n]) <= VisionRadius);
+				}
+
+				for(int n = 0; n < size; n += 2) {
+					grid.erase(n);
+				}
+				assert(grid.size() == size/2);
+				foreach(int n, grid.values()) {
+					assert(n % 2 == 1 && grid.find_at(locs[n]) != spatial_grid<int>::NoHandle);
+				}
+			}
+		}
+
+		assert(seen[0] == seen[1]);
+		std::cerr << size << " parties: multimap " << ms[0]
+		          << "ms per frame, spatial grid " << ms[1]
+		          << "ms per frame (" << seen[1]/Frames << " visible)\n";
+	}
+}
+
+}
+
+#endif
@@ -0,0 +1,302 @@
+/*
+   Copyright (C) 2007 by David White <dave.net>
+   Part of the Silver Tree Project
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 2 or later.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY.
+
+   See the COPYING file for more details.
+*/
+#ifndef SPATIAL_GRID_HPP_INCLUDED
+#define SPATIAL_GRID_HPP_INCLUDED
+
+#include <algorithm>
+#include <vector>
+
+#include "field_of_view.hpp"
+#include "tile_logic.hpp"
+
+namespace hex
+{
+
+//values kept at tiles of a map, such as the parties in a world, found by
+//where they are. The map is divided into buckets of 4x4 tiles, each
+//with a list of the values in it, so that finding the values in some
+//part of the map only looks at the buckets which cover it. Values are
+//added, moved and removed, through the handle they were given, in the
+//same time however many values there are.
+template<typename T>
+class spatial_grid
+{
+public:
+	typedef int handle;
+	enum { NoHandle = -1 };
+
+	explicit spatial_grid(const location& dim);
+
+	handle insert(const T& value, const location& loc);
+	void erase(handle h);
+	void move(handle h, const location& loc);
+
+	int size() const { return values_.size(); }
+	const T& value(handle h) const { return values_[nodes_[h].index]; }
+	const location& loc(handle h) const { return nodes_[h].loc; }
+
+	//every value, in no particular order.
+	const std::vector<T>& values() const { return values_; }
+
+	//adds the values at loc to res, returning false if there are none.
+	template<typename U>
+	bool get_at(const location& loc, std::vector<U>& res) const;
+
+	//the first value found at loc, or NoHandle.
+	handle find_at(const location& loc) const;
+
+	//adds the values no further than radius from center to res.
+	template<typename U>
+	void get_in_radius(const location& center, int radius,
+	                   std::vector<U>& res) const;
+
+	//adds the values at tiles visible in fov to res.
+	template<typename U>
+	void get_visible(const field_of_view& fov, std::vector<U>& res) const;
+
+private:
+	enum { BucketBits = 2 };
+
+	struct node {
+		location loc;
+		int bucket;
+		int index;
+		handle prev, next;
+	};
+
+	int bucket_of(const location& loc) const;
+	void link(handle h);
+	void unlink(handle h);
+
+	//calls f(loc, value) for the values at tiles from x1,y1 to x2,y2.
+	template<typename F>
+	void visit(int x1, int y1, int x2, int y2, F& f) const;
+
+	template<typename U> struct radius_collector;
+	template<typename U> struct visible_collector;
+
+	int width_, height_;
+	std::vector<handle> buckets_;
+	std::vector<node> nodes_;
+	std::vector<handle> free_;
+
+	//the values, and the handles of the nodes for them.
+	std::vector<T> values_;
+	std::vector<handle> handles_;
+};
+
+template<typename T>
+spatial_grid<T>::spatial_grid(const location& dim)
+  : width_(std::max(1, (dim.x() + (1 << BucketBits) - 1) >> BucketBits)),
+    height_(std::max(1, (dim.y() + (1 << BucketBits) - 1) >> BucketBits)),
+    buckets_(width_*height_, NoHandle)
+{
+}
+
+template<typename T>
+typename spatial_grid<T>::handle spatial_grid<T>::insert(const T& value,
+                                                         const location& loc)
+{
+	handle h;
+	if(free_.empty()) {
+		h = nodes_.size();
+		nodes_.push_back(node());
+	} else {
+		h = free_.back();
+		free_.pop_back();
+	}
+
+	node& n = nodes_[h];
+	n.loc = loc;
+	n.index = values_.size();
+	values_.push_back(value);
+	handles_.push_back(h);
+	link(h);
+	return h;
+}
+
+template<typename T>
+void spatial_grid<T>::erase(handle h)
+{
+	unlink(h);
+
+	//the last value takes the place of the one erased.
+	const int index = nodes_[h].index;
+	values_[index] = values_.back();
+	handles_[index] = handles_.back();
+	nodes_[handles_[index]].index = index;
+	values_.pop_back();
+	handles_.pop_back();
+	free_.push_back(h);
+}
+
+template<typename T>
+void spatial_grid<T>::move(handle h, const location& loc)
+{
+	node& n = nodes_[h];
+	if(bucket_of(loc) == n.bucket) {
+		n.loc = loc;
+		return;
+	}
+
+	unlink(h);
+	n.loc = loc;
+	link(h);
+}
+
+template<typename T>
+template<typename U>
+bool spatial_grid<T>::get_at(const location& loc, std::vector<U>& res) const
+{
+	bool found = false;
+	for(handle h = buckets_[bucket_of(loc)]; h != NoHandle; h = nodes_[h].next) {
+		if(nodes_[h].loc == loc) {
+			res.push_back(values_[nodes_[h].index]);
+			found = true;
+		}
+	}
+
+	return found;
+}
+
+template<typename T>
+typename spatial_grid<T>::handle spatial_grid<T>::find_at(
+                                     const location& loc) const
+{
+	for(handle h = buckets_[bucket_of(loc)]; h != NoHandle; h = nodes_[h].next) {
+		if(nodes_[h].loc == loc) {
+			return h;
+		}
+	}
+
+	return NoHandle;
+}
+
+template<typename T>
+template<typename U>
+struct spatial_grid<T>::radius_collector {
+	radius_collector(const location& c, int r, std::vector<U>& res)
+	  : center(c), radius(r), out(res)
+	{}
+	void operator()(const location& loc, const T& value) {
+		if(distance_between(center, loc) <= radius) {
+			out.push_back(value);
+		}
+	}
+	const location& center;
+	unsigned int radius;
+	std::vector<U>& out;
+};
+
+template<typename T>
+template<typename U>
+void spatial_grid<T>::get_in_radius(const location& center, int radius,
+                                    std::vector<U>& res) const
+{
+	if(radius < 0) {
+		return;
+	}
+
+	radius_collector<U> f(center, radius, res);
+	visit(center.x() - radius, center.y() - radius,
+	      center.x() + radius, center.y() + radius, f);
+}
+
+template<typename T>
+template<typename U>
+struct spatial_grid<T>::visible_collector {
+	visible_collector(const field_of_view& f, std::vector<U>& res)
+	  : fov(f), out(res)
+	{}
+	void operator()(const location& loc, const T& value) {
+		if(fov.is_visible(loc)) {
+			out.push_back(value);
+		}
+	}
+	const field_of_view& fov;
+	std::vector<U>& out;
+};
+
+template<typename T>
+template<typename U>
+void spatial_grid<T>::get_visible(const field_of_view& fov,
+                                  std::vector<U>& res) const
+{
+	visible_collector<U> f(fov, res);
+	visit(fov.center().x() - fov.radius(), fov.center().y() - fov.radius(),
+	      fov.center().x() + fov.radius(), fov.center().y() + fov.radius(), f);
+}
+
+template<typename T>
+int spatial_grid<T>::bucket_of(const location& loc) const
+{
+	//values off the map go in the nearest bucket on it.
+	const int x = std::min(std::max(loc.x() >> BucketBits, 0), width_ - 1);
+	const int y = std::min(std::max(loc.y() >> BucketBits, 0), height_ - 1);
+	return y*width_ + x;
+}
+
+template<typename T>
+void spatial_grid<T>::link(handle h)
+{
+	node& n = nodes_[h];
+	n.bucket = bucket_of(n.loc);
+	n.prev = NoHandle;
+	n.next = buckets_[n.bucket];
+	if(n.next != NoHandle) {
+		nodes_[n.next].prev = h;
+	}
+	buckets_[n.bucket] = h;
+}
+
+template<typename T>
+void spatial_grid<T>::unlink(handle h)
+{
+	const node& n = nodes_[h];
+	if(n.prev == NoHandle) {
+		buckets_[n.bucket] = n.next;
+	} else {
+		nodes_[n.prev].next = n.next;
+	}
+
+	if(n.next != NoHandle) {
+		nodes_[n.next].prev = n.prev;
+	}
+}
+
+template<typename T>
+template<typename F>
+void spatial_grid<T>::visit(int x1, int y1, int x2, int y2, F& f) const
+{
+	const location top_left(x1, y1), bottom_right(x2, y2);
+	const int b1 = bucket_of(top_left), b2 = bucket_of(bottom_right);
+	for(int by = b1/width_; by <= b2/width_; ++by) {
+		for(int bx = b1%width_; bx <= b2%width_; ++bx) {
+			for(handle h = buckets_[by*width_ + bx]; h != NoHandle;
+			    h = nodes_[h].next) {
+				const location& loc = nodes_[h].loc;
+				if(loc.x() >= x1 && loc.x() <= x2 &&
+				   loc.y() >= y1 && loc.y() <= y2) {
+					f(loc, values_[nodes_[h].index]);
+				}
+			}
+		}
+	}
+}
+
+#ifdef UNIT_TEST_SPATIAL_GRID
+void unit_test_spatial_grid();
+#endif
+
+}
+
+#endif
@@ -0,0 +1,79 @@
+/*
+   Copyright (C) 2007 by David White <dave.net>
+   Part of the Silver Tree Project
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 2 or later.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY.
+
+   See the COPYING file for more details.
+*/
+#include <cassert>
+#include <map>
+#include <vector>
+
+#include "stat_id.hpp"
+
+namespace game_logic
+{
+
+namespace {
+const char* BuiltinStats[] = {
+	"attack", "damage", "defense", "dodge", "parry", "initiative",
+	"stamina_used", "max_hitpoints", "speed", "climb", "vision",
+	"stamina", "fatigue", "resistance", "resistance_percent", "range",
+	"ideal_strength", "skill_points", "experience_required",
+	"improvement_points", "energy", "move_at", "inflict_damage",
+};
+
+struct stat_table {
+	stat_table() {
+		assert(sizeof(BuiltinStats)/sizeof(*BuiltinStats) == NUM_BUILTIN_STATS);
+		for(int n = 0; n != NUM_BUILTIN_STATS; ++n) {
+			names.push_back(BuiltinStats[n]);
+			ids[names.back()] = n;
+		}
+	}
+
+	std::vector<std::string> names;
+	std::map<std::string,stat_id> ids;
+};
+
+stat_table& table()
+{
+	static stat_table t;
+	return t;
+}
+}
+
+stat_id intern_stat(const std::string& name)
+{
+	stat_table& t = table();
+	const std::map<std::string,stat_id>::const_iterator i = t.ids.find(name);
+	if(i != t.ids.end()) {
+		return i->second;
+	}
+
+	t.names.push_back(name);
+	return t.ids[name] = t.names.size() - 1;
+}
+
+stat_id find_stat(const std::string& name)
+{
+	const stat_table& t = table();
+	const std::map<std::string,stat_id>::const_iterator i = t.ids.find(name);
+	return i != t.ids.end() ? i->second : STAT_NONE;
+}
+
+const std::string& stat_name(stat_id id)
+{
+	return table().names[id];
+}
+
+int num_stats()
+{
+	return table().names.size();
+}
+
+}
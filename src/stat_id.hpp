@@ -0,0 +1,72 @@
+/*
+   Copyright (C) 2007 by David White <dave.net>
+   Part of the Silver Tree Project
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 2 or later.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY.
+
+   See the COPYING file for more details.
+*/
+#ifndef STAT_ID_HPP_INCLUDED
+#define STAT_ID_HPP_INCLUDED
+
+#include <string>
+
+namespace game_logic
+{
+
+//stats are known by name in WML and in formulas, but by number in the
+//code which uses them, so that looking a stat up is a read from an
+//array rather than a search through names. The stats the code refers
+//to directly have fixed numbers, and every other name is numbered as
+//the rules, items and skills which mention it are loaded.
+enum STAT_ID {
+	STAT_NONE = -1,
+	STAT_ATTACK,
+	STAT_DAMAGE,
+	STAT_DEFENSE,
+	STAT_DODGE,
+	STAT_PARRY,
+	STAT_INITIATIVE,
+	STAT_STAMINA_USED,
+	STAT_MAX_HITPOINTS,
+	STAT_SPEED,
+	STAT_CLIMB,
+	STAT_VISION,
+	STAT_STAMINA,
+	STAT_FATIGUE,
+	STAT_RESISTANCE,
+	STAT_RESISTANCE_PERCENT,
+	STAT_RANGE,
+	STAT_IDEAL_STRENGTH,
+	STAT_SKILL_POINTS,
+	STAT_EXPERIENCE_REQUIRED,
+	STAT_IMPROVEMENT_POINTS,
+	STAT_ENERGY,
+	STAT_MOVE_AT,
+	STAT_INFLICT_DAMAGE,
+	NUM_BUILTIN_STATS
+};
+
+typedef int stat_id;
+
+//the number of the stat with the given name, numbering it if it hasn't
+//been seen before. Numbers are only handed out while loading, on the
+//main thread, so that looking them up needs no locking.
+stat_id intern_stat(const std::string& name);
+
+//the number of the stat with the given name, or STAT_NONE if nothing
+//loaded mentions it.
+stat_id find_stat(const std::string& name);
+
+const std::string& stat_name(stat_id id);
+
+//how many stats have numbers. Arrays indexed by stat should be at least
+//this long once loading has finished.
+int num_stats();
+
+}
+
+#endif
@@ -10,6 +10,7 @@
 
    See the COPYING file for more details.
 */
+#include <cassert>
 #include <map>
 
 #include "model.hpp"
@@ -23,6 +24,7 @@ namespace hex
 namespace {
 
 std::map<std::string,terrain_feature_ptr> terrains;
+std::vector<const_terrain_feature_ptr> terrains_by_index;
 
 }
 
@@ -37,6 +39,12 @@ const_terrain_feature_ptr terrain_feature::get(const std::string& id)
 	}
 }
 
+const_terrain_feature_ptr terrain_feature::get_by_index(int index)
+{
+	assert(index >= 0 && index < terrains_by_index.size());
+	return terrains_by_index[index];
+}
+
 void terrain_feature::get_feature_ids(std::vector<std::string>& res)
 {
 	for(std::map<std::string,terrain_feature_ptr>::const_iterator i =
@@ -48,12 +56,15 @@ void terrain_feature::get_feature_ids(std::vector<std::string>& res)
 void terrain_feature::add_terrain(wml::const_node_ptr node)
 {
 	const terrain_feature_ptr ptr(new terrain_feature(node));
-	terrains.insert(std::pair<std::string,terrain_feature_ptr>(
-	                             ptr->id_,ptr));
+	if(terrains.insert(std::pair<std::string,terrain_feature_ptr>(
+	                             ptr->id_,ptr)).second) {
+		ptr->index_ = terrains_by_index.size();
+		terrains_by_index.push_back(ptr);
+	}
 }
 
 terrain_feature::terrain_feature(wml::const_node_ptr node)
-  : id_(wml::get_str(node,"id")), name_(wml::get_str(node,"name")),
+  : id_(wml::get_str(node,"id")), index_(-1), name_(wml::get_str(node,"name")),
     models_(util::split(wml::get_str(node,"models"))),
     vision_block_(wml::get_attr<GLfloat>(node,"vision_block")),
 	default_cost_(wml::get_int(node,"cost", -1)),
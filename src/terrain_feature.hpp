@@ -33,6 +33,11 @@ public:
 	static void get_feature_ids(std::vector<std::string>& res);
 	static void add_terrain(wml::const_node_ptr node);
 
+	//features are numbered in the order they're added, so maps can
+	//store them compactly.
+	static const_terrain_feature_ptr get_by_index(int index);
+	int index() const { return index_; }
+
 	explicit terrain_feature(wml::const_node_ptr node);
 
 	graphics::const_model_ptr generate_model(const location& loc,
@@ -50,6 +55,7 @@ public:
 
 private:
 	std::string id_;
+	int index_;
 	std::string name_;
 	std::vector<std::string> models_;
 	GLfloat vision_block_;
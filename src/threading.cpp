@@ -0,0 +1,257 @@
+/*
+   Copyright (C) 2007 by David White <dave.net>
+   Part of the Silver Tree Project
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 2 or later.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY.
+
+   See the COPYING file for more details.
+*/
+#include <boost/shared_ptr.hpp>
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+#include "threading.hpp"
+
+namespace threading
+{
+
+namespace {
+struct parallel_batch;
+
+struct parallel_range {
+	void (*fn)(void*, int);
+	void* data;
+	int begin, end;
+	parallel_batch* batch;
+};
+
+//the ranges of one call to parallel_for, and how many of them haven't
+//finished yet.
+struct parallel_batch {
+	std::vector<parallel_range> ranges;
+	int unfinished;
+};
+
+void run_range(const parallel_range& range)
+{
+	for(int n = range.begin; n != range.end; ++n) {
+		range.fn(range.data, n);
+	}
+}
+
+//threads kept waiting for ranges to run, so that parallel_for, which
+//is called many times a turn, doesn't start and join threads each
+//time. Threads are added the first time as many are wanted, and joined
+//when the program exits.
+class worker_pool
+{
+public:
+	static worker_pool& get();
+
+	void run(parallel_batch& batch, int nthreads);
+
+private:
+	worker_pool() : shutting_down_(false) {}
+	~worker_pool();
+	worker_pool(const worker_pool&);
+	void operator=(const worker_pool&);
+
+	static int run_worker(void* pool);
+
+	//marks a range which has been run as finished.
+	void finish(const parallel_range& range);
+
+	mutex mutex_;
+	condition work_available_, batch_finished_;
+	std::deque<parallel_range*> queue_;
+	std::vector<boost::shared_ptr<thread> > workers_;
+	bool shutting_down_;
+};
+
+worker_pool& worker_pool::get()
+{
+	static worker_pool pool;
+	return pool;
+}
+
+worker_pool::~worker_pool()
+{
+	{
+		lock l(mutex_);
+		shutting_down_ = true;
+	}
+
+	work_available_.notify_all();
+	workers_.clear();
+}
+
+void worker_pool::run(parallel_batch& batch, int nthreads)
+{
+	{
+		lock l(mutex_);
+		while(workers_.size() < nthreads - 1) {
+			workers_.push_back(boost::shared_ptr<thread>(
+			                       new thread(run_worker, this)));
+		}
+
+		batch.unfinished = batch.ranges.size() - 1;
+		for(int n = 1; n < batch.ranges.size(); ++n) {
+			queue_.push_back(&batch.ranges[n]);
+		}
+	}
+
+	work_available_.notify_all();
+
+	//the first range is run on this thread, which then helps with any
+	//ranges still queued, so a parallel_for called from inside another
+	//never waits on ranges nobody is free to run.
+	run_range(batch.ranges[0]);
+	for(;;) {
+		parallel_range* range = NULL;
+		{
+			lock l(mutex_);
+			while(batch.unfinished > 0 && queue_.empty()) {
+				batch_finished_.wait(mutex_);
+			}
+
+			if(batch.unfinished == 0) {
+				return;
+			}
+
+			range = queue_.front();
+			queue_.pop_front();
+		}
+
+		run_range(*range);
+		finish(*range);
+	}
+}
+
+void worker_pool::finish(const parallel_range& range)
+{
+	lock l(mutex_);
+	if(--range.batch->unfinished == 0) {
+		batch_finished_.notify_all();
+	}
+}
+
+int worker_pool::run_worker(void* arg)
+{
+	worker_pool& pool = *static_cast<worker_pool*>(arg);
+	for(;;) {
+		parallel_range* range = NULL;
+		{
+			lock l(pool.mutex_);
+			while(!pool.shutting_down_ && pool.queue_.empty()) {
+				pool.work_available_.wait(pool.mutex_);
+			}
+
+			if(pool.shutting_down_) {
+				return 0;
+			}
+
+			range = pool.queue_.front();
+			pool.queue_.pop_front();
+		}
+
+		run_range(*range);
+		pool.finish(*range);
+	}
+}
+}
+
+mutex::mutex() : m_(SDL_CreateMutex())
+{
+}
+
+mutex::~mutex()
+{
+	SDL_DestroyMutex(m_);
+}
+
+lock::lock(mutex& m) : m_(m)
+{
+	SDL_mutexP(m_.m_);
+}
+
+lock::~lock()
+{
+	SDL_mutexV(m_.m_);
+}
+
+condition::condition() : c_(SDL_CreateCond())
+{
+}
+
+condition::~condition()
+{
+	SDL_DestroyCond(c_);
+}
+
+void condition::wait(mutex& m)
+{
+	SDL_CondWait(c_, m.m_);
+}
+
+void condition::notify_one()
+{
+	SDL_CondSignal(c_);
+}
+
+void condition::notify_all()
+{
+	SDL_CondBroadcast(c_);
+}
+
+thread::thread(int (*fn)(void*), void* data)
+  : t_(SDL_CreateThread(fn, data))
+{
+}
+
+thread::~thread()
+{
+	join();
+}
+
+void thread::join()
+{
+	if(t_) {
+		SDL_WaitThread(t_, NULL);
+		t_ = NULL;
+	}
+}
+
+void parallel_for(int count, void (*fn)(void*, int), void* data, int nthreads)
+{
+	if(nthreads > count) {
+		nthreads = count;
+	}
+
+	if(nthreads < 1) {
+		nthreads = 1;
+	}
+
+	parallel_batch batch;
+	batch.ranges.resize(nthreads);
+	for(int n = 0; n != nthreads; ++n) {
+		parallel_range& range = batch.ranges[n];
+		range.fn = fn;
+		range.data = data;
+		range.begin = (count*n)/nthreads;
+		range.end = (count*(n+1))/nthreads;
+		range.batch = &batch;
+	}
+
+	if(nthreads == 1) {
+		run_range(batch.ranges[0]);
+		return;
+	}
+
+	worker_pool::get().run(batch, nthreads);
+}
+
+}
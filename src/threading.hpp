@@ -0,0 +1,92 @@
+/*
+   Copyright (C) 2007 by David White <dave.net>
+   Part of the Silver Tree Project
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 2 or later.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY.
+
+   See the COPYING file for more details.
+*/
+#ifndef THREADING_HPP_INCLUDED
+#define THREADING_HPP_INCLUDED
+
+#include "SDL.h"
+
+//thin wrappers around SDL's threading primitives which release their
+//resources when they go out of scope.
+namespace threading
+{
+
+class mutex
+{
+public:
+	mutex();
+	~mutex();
+private:
+	mutex(const mutex&);
+	void operator=(const mutex&);
+
+	friend class lock;
+	friend class condition;
+	SDL_mutex* m_;
+};
+
+//locks a mutex for as long as the lock is in scope.
+class lock
+{
+public:
+	explicit lock(mutex& m);
+	~lock();
+private:
+	lock(const lock&);
+	void operator=(const lock&);
+
+	mutex& m_;
+};
+
+class condition
+{
+public:
+	condition();
+	~condition();
+
+	//releases the mutex, which the calling thread must hold, waits
+	//until notified, and then locks the mutex again.
+	void wait(mutex& m);
+	void notify_one();
+	void notify_all();
+private:
+	condition(const condition&);
+	void operator=(const condition&);
+
+	SDL_cond* c_;
+};
+
+//a thread which runs fn(data). The thread is joined when the object is
+//destroyed, so fn must return at some point.
+class thread
+{
+public:
+	thread(int (*fn)(void*), void* data);
+	~thread();
+
+	void join();
+private:
+	thread(const thread&);
+	void operator=(const thread&);
+
+	SDL_Thread* t_;
+};
+
+//calls fn(data, n) for every n from 0 to count-1. The calls are split
+//into contiguous ranges run on up to nthreads threads, the calling
+//thread included, and all of them have finished when this returns.
+//The other threads are kept waiting between calls rather than started
+//each time.
+void parallel_for(int count, void (*fn)(void*, int), void* data, int nthreads);
+
+}
+
+#endif
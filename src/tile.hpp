@@ -105,6 +105,7 @@ public:
 	void set_feature(const std::string& name);
 
 	bool is_passable(DIRECTION dir) const;
+	bool has_cliff(DIRECTION dir) const { return cliffs_[dir] != NULL; }
 
 	void invalidate();
 
@@ -237,6 +237,91 @@ DIRECTION get_main_direction(const location& a, const location& b)
 	}
 }
 
+namespace {
+//tiles in odd columns are offset by half a tile.
+double column_offset(int x)
+{
+	return is_odd(x) ? 0.5 : 0.0;
+}
+}
+
+tile_line::tile_line(const location& a, const location& b)
+  : loc_(a), dst_(b), origin_(a), du_(b.x() - a.x()),
+    dv_(b.y() - a.y() + column_offset(b.x()) - column_offset(a.x())),
+    enter_(0.0), done_(false)
+{
+	//work in units of columns and rows, where the tile at (x,y) covers
+	//x-0.5 < u <= x+0.5 and y-0.5 < v-offset(x) <= y+0.5. This is a
+	//linear scaling of world coordinates, so fractions along the line
+	//are the same in both. Positions are measured from the center of a,
+	//so that lines which are the same apart from being moved by a
+	//whole number of rows, or an even number of columns, visit the same
+	//tiles relative to where they start, with exactly the same fractions.
+	find_exit();
+}
+
+void tile_line::next()
+{
+	if(loc_ == dst_ || exit_ >= 1.0) {
+		done_ = true;
+		return;
+	}
+
+	enter_ = exit_;
+	if(row_exit_ < col_exit_) {
+		loc_ = location(loc_.x(), loc_.y() + (dv_ > 0.0 ? 1 : -1));
+	} else {
+		const int x = loc_.x() + (du_ > 0.0 ? 1 : -1);
+		const double v = dv_*col_exit_ -
+		                 (column_offset(x) - column_offset(origin_.x()));
+
+		//find the row we enter the new column in. If we enter exactly on
+		//the border between two rows, we're in the one we're heading
+		//towards; if we're running along the border, pick the same row
+		//as gamemap::closest_tile() does.
+		int y;
+		if(dv_ > 0.0) {
+			y = origin_.y() + static_cast<int>(std::floor(v + 0.5));
+		} else if(dv_ < 0.0) {
+			y = origin_.y() + static_cast<int>(std::ceil(v - 0.5));
+		} else {
+			const double abs_v = origin_.y() + v;
+			y = static_cast<int>(abs_v);
+			if(abs_v - y > 0.5) {
+				++y;
+			}
+		}
+
+		loc_ = location(x, y);
+	}
+
+	find_exit();
+}
+
+void tile_line::find_exit()
+{
+	const double infinity = 2.0;
+
+	const int u = loc_.x() - origin_.x();
+	col_exit_ = infinity;
+	if(du_ > 0.0) {
+		col_exit_ = (u + 0.5)/du_;
+	} else if(du_ < 0.0) {
+		col_exit_ = (u - 0.5)/du_;
+	}
+
+	const double center = loc_.y() - origin_.y() +
+	                   column_offset(loc_.x()) - column_offset(origin_.x());
+	row_exit_ = infinity;
+	if(dv_ > 0.0) {
+		row_exit_ = (center + 0.5)/dv_;
+	} else if(dv_ < 0.0) {
+		row_exit_ = (center - 0.5)/dv_;
+	}
+
+	exit_ = std::min(1.0, std::min(col_exit_, row_exit_));
+}
+
 bool tiles_adjacent(const location& a, const location& b)
 {
 	//two tiles are adjacent if y is different by 1, and x by 0, or if
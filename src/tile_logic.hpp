@@ -72,6 +72,33 @@ namespace hex
 
 	unsigned int distance_between(const location& a, const location& b);
 
+	// walks along the straight line between the centers of two tiles,
+	// visiting every tile the line passes through in order, from a to b
+	// inclusive. Tiles are the areas gamemap::closest_tile() maps points
+	// to. enter() and exit() give the part of the line inside the current
+	// tile, as fractions of the whole line.
+	//
+	//   for(tile_line line(a, b); !line.done(); line.next()) { ... }
+	class tile_line {
+	public:
+		tile_line(const location& a, const location& b);
+
+		bool done() const { return done_; }
+		const location& loc() const { return loc_; }
+		double enter() const { return enter_; }
+		double exit() const { return exit_; }
+
+		void next();
+
+	private:
+		void find_exit();
+
+		location loc_, dst_, origin_;
+		double du_, dv_;
+		double enter_, exit_, col_exit_, row_exit_;
+		bool done_;
+	};
+
 	inline bool operator==(const location& a, const location& b)
 	{
 		return a.x() == b.x() && a.y() == b.y();
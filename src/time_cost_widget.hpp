@@ -4,6 +4,10 @@
 #include "boost/shared_ptr.hpp"
 #include "location_tracker.hpp"
 
+namespace game_logic {
+class battle;
+}
+
 namespace game_dialogs {
 
 class time_cost_widget: public gui::widget {
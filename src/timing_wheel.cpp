@@ -0,0 +1,236 @@
+/*
+   Copyright (C) 2007 by David White <dave.net>
+   Part of the Silver Tree Project
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 2 or later.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY.
+
+   See the COPYING file for more details.
+*/
+#include "timing_wheel.hpp"
+
+#ifdef UNIT_TEST_TIMING_WHEEL
+
+#include <cassert>
+#include <ctime>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <queue>
+
+#include "base_terrain.hpp"
+#include "filesystem.hpp"
+#include "gamemap.hpp"
+#include "terrain_feature.hpp"
+#include "tile_logic.hpp"
+
+namespace util
+{
+
+namespace {
+
+const int NumParties = 10000;
+const int OneDay = 24*60*60;
+
+//parties wandering about a map, each moving to a neighbouring tile when
+//it is ready to and then waiting for as long as the move costs.
+class wanderers
+{
+public:
+	explicit wanderers(const hex::gamemap& m) : map_(m)
+	{
+		std::vector<hex::location> land;
+		for(int x = 0; x != m.size().x(); ++x) {
+			for(int y = 0; y != m.size().y(); ++y) {
+				if(cost(hex::location(x,y)) >= 0) {
+					land.push_back(hex::location(x,y));
+				}
+			}
+		}
+
+		assert(!land.empty());
+		for(int n = 0; n != NumParties; ++n) {
+			seeds_.push_back(n + 1);
+			locs_.push_back(land[(n*7919) % land.size()]);
+			due_.push_back(n % 60);
+		}
+	}
+
+	int num_parties() const { return locs_.size(); }
+	const hex::location& loc(int n) const { return locs_[n]; }
+	int due(int n) const { return due_[n]; }
+
+	//plays the turn of party n, which must be due now.
+	void move(int n)
+	{
+		hex::location adj[6];
+		hex::get_adjacent_tiles(locs_[n], adj);
+		seeds_[n] = seeds_[n]*1103515245 + 12345;
+		const hex::location& dst = adj[(seeds_[n] >> 16) % 6];
+		const int c = cost(dst);
+		if(c >= 0) {
+			locs_[n] = dst;
+		}
+
+		due_[n] += std::max(c, 1);
+	}
+
+private:
+	int cost(const hex::location& loc) const
+	{
+		if(!map_.is_loc_on_map(loc) || !map_.terrain(loc)) {
+			return -1;
+		}
+
+		int res = map_.terrain(loc)->default_cost();
+		if(res >= 0 && map_.feature(loc)) {
+			const int feature_cost = map_.feature(loc)->default_cost();
+			res = feature_cost < 0 ? -1 : res + feature_cost;
+		}
+
+		return res;
+	}
+
+	const hex::gamemap& map_;
+	std::vector<unsigned int> seeds_;
+	std::vector<hex::location> locs_;
+	std::vector<int> due_;
+};
+
+typedef std::multimap<hex::location,int> location_map;
+
+void relocate(location_map& locs, int n, const hex::location& from,
+              const hex::location& to)
+{
+	for(std::pair<location_map::iterator,location_map::iterator> range =
+	    locs.equal_range(from); range.first != range.second; ++range.first) {
+		if(range.first->second == n) {
+			locs.erase(range.first);
+			break;
+		}
+	}
+
+	locs.insert(std::pair<hex::location,int>(to, n));
+}
+
+struct due_later : public std::binary_function<int,int,bool> {
+	explicit due_later(const wanderers& w) : w_(&w) {}
+	bool operator()(int a, int b) const { return w_->due(a) > w_->due(b); }
+	const wanderers* w_;
+};
+
+//the way parties were scheduled before: a heap, with each party found
+//on the map before it moves, in case it has left since it was queued.
+void play_with_heap(wanderers& w, int until, int* turns, long long* total)
+{
+	location_map locs;
+	std::priority_queue<int, std::vector<int>, due_later> queue((due_later(w)));
+	for(int n = 0; n != w.num_parties(); ++n) {
+		locs.insert(std::pair<hex::location,int>(w.loc(n), n));
+		queue.push(n);
+	}
+
+	while(!queue.empty() && w.due(queue.top()) <= until) {
+		const int n = queue.top();
+		queue.pop();
+		bool found = false;
+		for(std::pair<location_map::iterator,location_map::iterator> range =
+		    locs.equal_range(w.loc(n)); range.first != range.second;
+		    ++range.first) {
+			if(range.first->second == n) {
+				found = true;
+				break;
+			}
+		}
+
+		assert(found);
+		const hex::location from = w.loc(n);
+		*total += w.due(n);
+		++*turns;
+		w.move(n);
+		relocate(locs, n, from, w.loc(n));
+		queue.push(n);
+	}
+}
+
+void play_with_wheel(wanderers& w, int until, int* turns, long long* total)
+{
+	location_map locs;
+	timing_wheel<int> queue;
+	for(int n = 0; n != w.num_parties(); ++n) {
+		locs.insert(std::pair<hex::location,int>(w.loc(n), n));
+		queue.insert(n, w.due(n));
+	}
+
+	for(int time = 0; time <= until; ++time) {
+		int n;
+		while(queue.pop(time, &n)) {
+			const hex::location from = w.loc(n);
+			*total += w.due(n);
+			++*turns;
+			w.move(n);
+			relocate(locs, n, from, w.loc(n));
+			queue.insert(n, w.due(n));
+		}
+	}
+}
+
+}
+
+void unit_test_timing_wheel()
+{
+	//items come out in order, and cancelled items don't come out.
+	timing_wheel<int> wheel;
+	std::vector<timing_wheel<int>::handle> handles;
+	int earliest = -1;
+	for(int n = 0; n != 2000; ++n) {
+		const int due = (n*37) % 5000 + (n % 3)*40000000;
+		handles.push_back(wheel.insert(n, due));
+		if(n % 5 != 0 && (earliest == -1 || due < earliest)) {
+			earliest = due;
+		}
+	}
+
+	for(int n = 0; n < 2000; n += 5) {
+		wheel.cancel(handles[n]);
+	}
+
+	assert(wheel.next_due() == earliest);
+	int last = -1, count = 0, n;
+	while(wheel.pop(100000000, &n)) {
+		const int due = (n*37) % 5000 + (n % 3)*40000000;
+		assert(n % 5 != 0);
+		assert(due >= last && due <= wheel.now());
+		last = due;
+		++count;
+	}
+
+	assert(count == 1600 && wheel.empty());
+
+	const hex::gamemap m(sys::read_file("data/maps/island-big"));
+	int turns[2] = {0,0};
+	long long total[2] = {0,0};
+	std::clock_t ticks[2];
+	for(int pass = 0; pass != 2; ++pass) {
+		wanderers w(m);
+		const std::clock_t start = std::clock();
+		if(pass == 0) {
+			play_with_heap(w, OneDay, &turns[pass], &total[pass]);
+		} else {
+			play_with_wheel(w, OneDay, &turns[pass], &total[pass]);
+		}
+		ticks[pass] = std::clock() - start;
+	}
+
+	assert(turns[0] == turns[1] && total[0] == total[1]);
+	std::cerr << NumParties << " parties over a day of game time on island-big: "
+	          << turns[0] << " turns; heap "
+	          << (1000.0*ticks[0])/CLOCKS_PER_SEC << "ms, timing wheel "
+	          << (1000.0*ticks[1])/CLOCKS_PER_SEC << "ms\n";
+}
+
+}
+
+#endif
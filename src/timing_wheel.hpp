@@ -0,0 +1,342 @@
+/*
+   Copyright (C) 2007 by David White <dave.net>
+   Part of the Silver Tree Project
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 2 or later.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY.
+
+   See the COPYING file for more details.
+*/
+#ifndef TIMING_WHEEL_HPP_INCLUDED
+#define TIMING_WHEEL_HPP_INCLUDED
+
+#include <cassert>
+#include <vector>
+
+namespace util
+{
+
+//a queue of items which fall due at whole numbered times, such as the
+//seconds of game time at which parties are ready to move. Items are
+//kept in lists of those due in the same stretch of time: one list for
+//each of the next 32 seconds, one for each of the 32 stretches of 32
+//seconds after those, and so on, with the lists of a stretch shared
+//out among the finer lists when the time reaches it. Putting an item in
+//the queue and taking it out again, through the handle it was given,
+//takes the same time however many items there are.
+template<typename T>
+class timing_wheel
+{
+public:
+	typedef int handle;
+	enum { NoHandle = -1 };
+
+	explicit timing_wheel(int now=0);
+
+	bool empty() const { return size_ == 0; }
+	int size() const { return size_; }
+
+	//the time the wheel has been moved on to by pop().
+	int now() const { return now_; }
+
+	handle insert(const T& value, int due);
+
+	//takes an item out of the queue. h may be NoHandle.
+	void cancel(handle h);
+
+	//takes out an item due no later than until, moving the time on
+	//as far as when it is due, or to until if none is due then. Items
+	//due at the same time come out in the order they went in. Returns
+	//false if no item is due.
+	bool pop(int until, T* value);
+
+	//the earliest time any item is due. The queue must not be empty.
+	int next_due() const;
+
+private:
+	enum { Bits = 5, Slots = 1 << Bits, Mask = Slots - 1, Levels = 5,
+	       Overflow = Levels*Slots, NumLists };
+
+	struct entry {
+		T value;
+		int due;
+		int list;
+		handle prev, next;
+	};
+
+	struct item_list {
+		handle head, tail;
+	};
+
+	//puts an item in the list for when it is due, and takes it out.
+	void link(handle h);
+	void unlink(handle h);
+
+	//the list with the items due soonest, and the earliest time any of
+	//them can be due, or -1 if the queue is empty.
+	int earliest_list(int* start) const;
+
+	//moves the time on, sharing out the lists of the stretches of
+	//time which it reaches.
+	void move_to(int time);
+	void share_out(int list);
+
+	static int lowest_bit(unsigned int bits, int from);
+
+	std::vector<entry> entries_;
+	std::vector<handle> free_;
+	item_list lists_[NumLists];
+	unsigned int occupied_[Levels];
+	int now_, size_;
+};
+
+template<typename T>
+timing_wheel<T>::timing_wheel(int now) : now_(now), size_(0)
+{
+	for(int n = 0; n != NumLists; ++n) {
+		lists_[n].head = lists_[n].tail = NoHandle;
+	}
+
+	for(int n = 0; n != Levels; ++n) {
+		occupied_[n] = 0;
+	}
+}
+
+template<typename T>
+typename timing_wheel<T>::handle timing_wheel<T>::insert(const T& value,
+                                                         int due)
+{
+	handle h;
+	if(free_.empty()) {
+		h = entries_.size();
+		entries_.push_back(entry());
+	} else {
+		h = free_.back();
+		free_.pop_back();
+	}
+
+	entries_[h].value = value;
+	entries_[h].due = due;
+	link(h);
+	++size_;
+	return h;
+}
+
+template<typename T>
+void timing_wheel<T>::cancel(handle h)
+{
+	if(h == NoHandle) {
+		return;
+	}
+
+	unlink(h);
+	entries_[h].value = T();
+	free_.push_back(h);
+	--size_;
+}
+
+template<typename T>
+bool timing_wheel<T>::pop(int until, T* value)
+{
+	for(;;) {
+		const item_list& current = lists_[now_ & Mask];
+		if(current.head != NoHandle) {
+			if(entries_[current.head].due > until) {
+				return false;
+			}
+
+			const handle h = current.head;
+			*value = entries_[h].value;
+			cancel(h);
+			return true;
+		}
+
+		if(now_ >= until) {
+			return false;
+		}
+
+		//skip straight over the stretches of time with nothing due.
+		int start;
+		if(earliest_list(&start) == -1 || start > until) {
+			start = until;
+		}
+
+		move_to(start);
+	}
+}
+
+template<typename T>
+int timing_wheel<T>::next_due() const
+{
+	int start;
+	const int list = earliest_list(&start);
+	assert(list != -1);
+
+	int res = entries_[lists_[list].head].due;
+	for(handle h = lists_[list].head; h != NoHandle; h = entries_[h].next) {
+		if(entries_[h].due < res) {
+			res = entries_[h].due;
+		}
+	}
+
+	return res;
+}
+
+template<typename T>
+void timing_wheel<T>::link(handle h)
+{
+	entry& e = entries_[h];
+
+	//items which are already due go in the list for now. Otherwise
+	//they go in the finest list whose stretch of time has begun.
+	e.list = Overflow;
+	if(e.due <= now_) {
+		e.list = now_ & Mask;
+	} else {
+		for(int level = 0; level != Levels; ++level) {
+			const int shift = Bits*(level + 1);
+			if((e.due >> shift) == (now_ >> shift)) {
+				e.list = level*Slots + ((e.due >> Bits*level) & Mask);
+				break;
+			}
+		}
+	}
+
+	item_list& l = lists_[e.list];
+	e.prev = l.tail;
+	e.next = NoHandle;
+	if(l.tail == NoHandle) {
+		l.head = h;
+	} else {
+		entries_[l.tail].next = h;
+	}
+	l.tail = h;
+
+	if(e.list != Overflow) {
+		occupied_[e.list/Slots] |= 1u << (e.list & Mask);
+	}
+}
+
+template<typename T>
+void timing_wheel<T>::unlink(handle h)
+{
+	const entry& e = entries_[h];
+	item_list& l = lists_[e.list];
+	if(e.prev == NoHandle) {
+		l.head = e.next;
+	} else {
+		entries_[e.prev].next = e.next;
+	}
+
+	if(e.next == NoHandle) {
+		l.tail = e.prev;
+	} else {
+		entries_[e.next].prev = e.prev;
+	}
+
+	if(l.head == NoHandle && e.list != Overflow) {
+		occupied_[e.list/Slots] &= ~(1u << (e.list & Mask));
+	}
+}
+
+template<typename T>
+int timing_wheel<T>::earliest_list(int* start) const
+{
+	//the lists at each level before the current one are all empty, and
+	//each level's lists are all due before those of the level above.
+	for(int level = 0; level != Levels; ++level) {
+		const int current = (now_ >> Bits*level) & Mask;
+		const int slot = lowest_bit(occupied_[level],
+		                            level == 0 ? current : current + 1);
+		if(slot != -1) {
+			const int shift = Bits*(level + 1);
+			*start = ((now_ >> shift) << shift) + (slot << Bits*level);
+			if(*start < now_) {
+				*start = now_;
+			}
+			return level*Slots + slot;
+		}
+	}
+
+	if(lists_[Overflow].head == NoHandle) {
+		return -1;
+	}
+
+	*start = entries_[lists_[Overflow].head].due;
+	for(handle h = lists_[Overflow].head; h != NoHandle; h = entries_[h].next) {
+		if(entries_[h].due < *start) {
+			*start = entries_[h].due;
+		}
+	}
+
+	return Overflow;
+}
+
+template<typename T>
+void timing_wheel<T>::move_to(int time)
+{
+	//only stretches of time with nothing due are passed over, so just
+	//the lists for the stretches the new time is in need sharing out,
+	//starting with the longest.
+	const int old = now_;
+	now_ = time;
+	if((old >> Bits*Levels) != (time >> Bits*Levels)) {
+		share_out(Overflow);
+	}
+
+	for(int level = Levels - 1; level > 0; --level) {
+		if((old >> Bits*level) != (time >> Bits*level)) {
+			share_out(level*Slots + ((time >> Bits*level) & Mask));
+		}
+	}
+}
+
+template<typename T>
+void timing_wheel<T>::share_out(int list)
+{
+	handle h = lists_[list].head;
+	lists_[list].head = lists_[list].tail = NoHandle;
+	if(list != Overflow) {
+		occupied_[list/Slots] &= ~(1u << (list & Mask));
+	}
+
+	while(h != NoHandle) {
+		const handle next = entries_[h].next;
+		link(h);
+		h = next;
+	}
+}
+
+template<typename T>
+int timing_wheel<T>::lowest_bit(unsigned int bits, int from)
+{
+	if(from >= Slots) {
+		return -1;
+	}
+
+	bits &= ~0u << from;
+	if(bits == 0) {
+		return -1;
+	}
+
+#ifdef __GNUC__
+	return __builtin_ctz(bits);
+#else
+	int res = 0;
+	while((bits & 1) == 0) {
+		bits >>= 1;
+		++res;
+	}
+	return res;
+#endif
+}
+
+#ifdef UNIT_TEST_TIMING_WHEEL
+void unit_test_timing_wheel();
+#endif
+
+}
+
+#endif
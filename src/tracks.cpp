@@ -11,88 +11,149 @@ namespace game_logic
 {
 
 namespace {
-bool track_invisible(const tracks::info& i) {
-	return i.visibility <= 0;
-}
+//how long a stretch of time the tracks expiring in it are swept at once.
+const int BucketLength = 60;
 }
 
 void tracks::read(const wml::const_node_ptr& node)
 {
 	tracks_.clear();
+	expiry_.clear();
+	num_tracks_ = max_tracks_ = 0;
 	for(wml::node::const_child_range r = node->get_child_range("track");
 	    r.first != r.second; ++r.first) {
 		wml::const_node_ptr node = r.first->second;
-		info i;
-		i.visibility = wml::get_int(node, "visibility");
-		i.dir = static_cast<hex::DIRECTION>(wml::get_int(node, "direction"));
-		i.party_id = wml::get_int(node, "party_id");
-		i.time = game_time(node);
-		i.last_update = i.time;
+		track t;
+		t.dir = static_cast<hex::DIRECTION>(wml::get_int(node, "direction"));
+		t.party_id = wml::get_int(node, "party_id");
+		t.time = game_time(node);
+		t.expires = t.time + wml::get_int(node, "visibility");
 		hex::location loc(wml::get_int(node,"x"),wml::get_int(node,"y"));
-		tracks_[loc].push_back(i);
+		add(loc, t);
 	}
 }
 
 wml::node_ptr tracks::write() const
 {
 	wml::node_ptr res(new wml::node("tracks"));
-	for(std::map<hex::location,tracks_list>::iterator i = tracks_.begin();
-	    i != tracks_.end(); ++i) {
-		tracks_list& list = i->second;
-		foreach(info& i, list) {
-			const int diff = i.time - i.last_update;
-			i.last_update = i.time;
-			i.visibility -= diff;
-		}
-		list.erase(std::remove_if(list.begin(),list.end(),track_invisible), list.end());
-		foreach(const info& t, list) {
+	for(hex_map::const_iterator i = tracks_.begin(); i != tracks_.end(); ++i) {
+		for(int n = 0; n != i->second.size; ++n) {
+			const track& t = i->second.get(n);
 			const wml::node_ptr node(hex::write_location("track", i->first));
-			node->set_attr("visibility", formatter() << t.visibility);
+			node->set_attr("visibility", formatter() << (t.expires - t.time));
 			node->set_attr("direction", formatter() << static_cast<int>(t.dir));
 			node->set_attr("party_id", formatter() << t.party_id);
 			node->set_attr("time", formatter() << t.time.since_epoch());
 			res->add_child(node);
 		}
-
 	}
 
 	return res;
 }
 
 void tracks::add_tracks(const hex::location& loc, const party& p,
-                        const game_time& t, hex::DIRECTION dir)
+                        const game_time& t, const game_time& now,
+                        hex::DIRECTION dir)
 {
-	info i;
-	i.visibility = p.trackability();
-	i.dir = dir;
-	i.party_id = p.id();
-	i.last_update = i.time = t;
-	tracks_[loc].push_back(i);
+	expire(now);
+
+	track tr;
+	tr.dir = dir;
+	tr.party_id = p.id();
+	tr.time = t;
+	tr.expires = t + p.trackability();
+	add(loc, tr);
 }
 
-const tracks::tracks_list& tracks::get_tracks(const hex::location& loc,
-                                              const game_time& t) const
+void tracks::get_tracks(const hex::location& loc, const game_time& t,
+                        tracks_list& res) const
 {
-	static const tracks::tracks_list empty_tracks;
-	std::map<hex::location,tracks_list>::iterator itor = tracks_.find(loc);
+	res.clear();
+	const hex_map::const_iterator itor = tracks_.find(loc);
 	if(itor == tracks_.end()) {
-		return empty_tracks;
+		return;
+	}
+
+	for(int n = 0; n != itor->second.size; ++n) {
+		const track& tr = itor->second.get(n);
+		if(tr.expires > t) {
+			info i;
+			i.visibility = tr.expires - t;
+			i.dir = tr.dir;
+			i.party_id = tr.party_id;
+			i.time = tr.time;
+			res.push_back(i);
+		}
 	}
+}
 
-	tracks_list& list = itor->second;
-	foreach(info& i, list) {
-		const int diff = t - i.last_update;
-		i.last_update = t;
-		i.visibility -= diff;
+size_t tracks::memory_used() const
+{
+	size_t res = tracks_.size()*(sizeof(hex_map::value_type) + 4*sizeof(void*));
+	for(expiry_map::const_iterator i = expiry_.begin(); i != expiry_.end(); ++i) {
+		res += sizeof(expiry_map::value_type) + 4*sizeof(void*) +
+		       i->second.capacity()*sizeof(hex::location);
 	}
 
-	list.erase(std::remove_if(list.begin(),list.end(),track_invisible), list.end());
-	if(list.empty()) {
-		tracks_.erase(itor);
-		return empty_tracks;
+	return res;
+}
+
+void tracks::add(const hex::location& loc, const track& t)
+{
+	if(t.expires <= t.time) {
+		return;
 	}
 
-	return list;
+	hex_tracks& h = tracks_[loc];
+	if(h.size == MaxTracksPerHex) {
+		h.begin = (h.begin + 1)%MaxTracksPerHex;
+		--h.size;
+		--num_tracks_;
+	}
+
+	h.ring[(h.begin + h.size)%MaxTracksPerHex] = t;
+	++h.size;
+	++num_tracks_;
+	max_tracks_ = std::max(max_tracks_, num_tracks_);
+
+	//a hex may be put in a bucket more than once; it is just looked at
+	//again when the bucket is swept.
+	expiry_[bucket(t.expires)].push_back(loc);
+}
+
+void tracks::expire(const game_time& t)
+{
+	const int now = bucket(t);
+	while(!expiry_.empty() && expiry_.begin()->first < now) {
+		foreach(const hex::location& loc, expiry_.begin()->second) {
+			const hex_map::iterator itor = tracks_.find(loc);
+			if(itor == tracks_.end()) {
+				continue;
+			}
+
+			hex_tracks& h = itor->second;
+			hex_tracks kept;
+			for(int n = 0; n != h.size; ++n) {
+				if(h.get(n).expires > t) {
+					kept.ring[kept.size++] = h.get(n);
+				}
+			}
+
+			num_tracks_ -= h.size - kept.size;
+			if(kept.size == 0) {
+				tracks_.erase(itor);
+			} else {
+				h = kept;
+			}
+		}
+
+		expiry_.erase(expiry_.begin());
+	}
+}
+
+int tracks::bucket(const game_time& t)
+{
+	return t.since_epoch()/BucketLength;
 }
 
 }
@@ -13,29 +13,76 @@
 namespace game_logic
 {
 
+//the tracks parties leave as they move. A track fades as time passes,
+//and is gone once its visibility has run out. Only the most recent
+//tracks on each hex are kept.
 class tracks {
 public:
-	explicit tracks(const hex::gamemap& m) : map_(m)
+	explicit tracks(const hex::gamemap& m) : map_(m), num_tracks_(0),
+	                                         max_tracks_(0)
 	{}
 	void read(const wml::const_node_ptr& node);
 	wml::node_ptr write() const;
+
+	//leaves tracks at loc made at time t. t may be ahead of now for a
+	//party going along a whole path in one turn; tracks are only
+	//expired up to now, so ones which can still be seen aren't lost.
 	void add_tracks(const hex::location& loc, const party& p,
-	                const game_time& t, hex::DIRECTION dir);
+	                const game_time& t, const game_time& now,
+	                hex::DIRECTION dir);
 
 	struct info {
 		int visibility;
 		hex::DIRECTION dir;
 		int party_id;
 		game_time time;
-		game_time last_update;
 	};
 
+	//puts the tracks which can still be seen at loc at time t in res,
+	//with how visible they still are, the oldest first.
 	typedef std::vector<info> tracks_list;
-	const tracks_list& get_tracks(const hex::location& loc,
-	                              const game_time& t) const;
+	void get_tracks(const hex::location& loc, const game_time& t,
+	                tracks_list& res) const;
+
+	//how many tracks are kept, the most there have been at once, and
+	//roughly how many bytes they take up.
+	int num_tracks() const { return num_tracks_; }
+	int max_tracks() const { return max_tracks_; }
+	size_t memory_used() const;
+
 private:
+	enum { MaxTracksPerHex = 8 };
+
+	struct track {
+		hex::DIRECTION dir;
+		int party_id;
+		game_time time;
+		game_time expires;
+	};
+
+	//the tracks on a hex, in a ring which the newest track overwrites
+	//the oldest in once it is full.
+	struct hex_tracks {
+		hex_tracks() : begin(0), size(0) {}
+		const track& get(int n) const { return ring[(begin + n)%MaxTracksPerHex]; }
+		track ring[MaxTracksPerHex];
+		int begin, size;
+	};
+
+	void add(const hex::location& loc, const track& t);
+
+	//removes the tracks which have expired by time t. Hexes are kept
+	//in buckets by when their tracks expire, so only the hexes which
+	//may have expired tracks are looked at.
+	void expire(const game_time& t);
+	static int bucket(const game_time& t);
+
 	const hex::gamemap& map_;
-	mutable std::map<hex::location,tracks_list> tracks_;
+	typedef std::map<hex::location,hex_tracks> hex_map;
+	hex_map tracks_;
+	typedef std::map<int,std::vector<hex::location> > expiry_map;
+	expiry_map expiry_;
+	int num_tracks_, max_tracks_;
 };
 
 }
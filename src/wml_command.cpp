@@ -12,6 +12,7 @@
 #include "message_dialog.hpp"
 #include "party.hpp"
 #include "post_battle_dialog.hpp"
+#include "preferences.hpp"
 #include "shop_dialog.hpp"
 #include "string_utils.hpp"
 #include "wml_command.hpp"
@@ -529,9 +530,13 @@ public:
 
 class fire_event_command : public wml_command
 {
-    std::string event_;
+    event_id event_;
     std::map<std::string, const_formula_ptr> params_;
     void do_execute(const formula_callable& info, world& world) const {
+        if(!world.has_event_handlers(event_)) {
+            return;
+        }
+
         map_formula_callable_ptr callable(new map_formula_callable(&info));
         for(std::map<std::string, const_formula_ptr>::const_iterator i = params_.begin(); i != params_.end(); ++i) {
             callable->add(i->first, i->second->execute(info));
@@ -542,7 +547,7 @@ class fire_event_command : public wml_command
     
 public:
     explicit fire_event_command(wml::const_node_ptr node)
-        : event_(node->attr("event"))
+        : event_(get_event_id(node->attr("event")))
     {
         for(wml::node::const_attr_iterator i = node->begin_attr(); i != node->end_attr(); ++i) {
             if(i->first != "event") {
@@ -591,7 +596,15 @@ class award_command : public wml_command
             return;
         }
         
-        if(xp || money) {
+        if(!xp && !money) {
+            return;
+        }
+
+        //with no display, the rewards are given without the dialog
+        //which counts them out.
+        if(preference_headless()) {
+            p->award(xp, money, chars);
+        } else {
             game_dialogs::post_battle_dialog(p, xp, money, &chars).show();
         }
     }
@@ -618,6 +631,19 @@ const_wml_command_ptr wml_command::create(wml::const_node_ptr node)
     if(!node) {
         return empty_command;
     }
+
+    //commands which only show something or wait for the player do
+    //nothing when there is no display.
+    if(preference_headless()) {
+        static const char* const interactive[] = {
+            "debug_console", "party_chat", "dialog", "shop",
+            "character_status_dialog" };
+        foreach(const char* name, interactive) {
+            if(node->name() == name) {
+                return empty_command;
+            }
+        }
+    }
     
 #define DEFINE_COMMAND(cmd) \
 	if(node->name() == #cmd) { \
@@ -17,6 +17,7 @@
 #include "encounter.hpp"
 #include "filesystem.hpp"
 #include "foreach.hpp"
+#include "formatter.hpp"
 #include "frustum.hpp"
 #include "global_game_state.hpp"
 #include "grid_widget.hpp"
@@ -24,7 +25,7 @@
 #include "keyboard.hpp"
 #include "label.hpp"
 #include "party_status_dialog.hpp"
-#include "pathfind.hpp"
+#include "path_service.hpp"
 #include "preferences.hpp"
 #include "raster.hpp"
 #include "settlement.hpp"
@@ -34,9 +35,12 @@
 #include "wml_parser.hpp"
 #include "wml_utils.hpp"
 #include "world.hpp"
+#include "world_loader.hpp"
 #include "animation.cpp"
 
+#include <algorithm>
 #include <cmath>
+#include <ctime>
 #include <iostream>
 #include <sstream>
 
@@ -76,11 +80,14 @@ const std::vector<const world*>& world::current_world_stack()
 }
 
 world::world(wml::const_node_ptr node)
-    : compass_(graphics::texture::get(graphics::surface_cache::get("compass-rose.png"))),
-      map_(get_map_data(node)), camera_(map_),
+    : compass_(preference_headless() ? graphics::texture() :
+               graphics::texture::get(graphics::surface_cache::get("compass-rose.png"))),
+      map_(get_map_data(node)), parties_(map_.size()),
+      settlement_entrances_(map_.size()), camera_(map_),
       camera_controller_(camera_), 
       scale_(wml::get_int(node, "scale", 1)),
-      time_(node), subtime_(0.0), tracks_(map_),
+      time_(node), subtime_(0.0), display_subtime_(0.0), sim_rate_(0.0),
+      tracks_(map_),
       border_tile_(wml::get_str(node, "border_tile")),
       done_(false), quit_(false),
       input_listener_(this), 
@@ -121,16 +128,12 @@ world::world(wml::const_node_ptr node)
     wml::node::const_child_iterator s1 = node->begin_child("settlement");
     const wml::node::const_child_iterator s2 = node->end_child("settlement");
     for(; s1 != s2; ++s1) {
-        wml::node_ptr node = wml::deep_copy(s1->second);
-        const std::string& file = node->attr("file");
-        if(!file.empty()) {
-            wml::merge_over(wml::parse_wml(sys::read_file(file)), node);
-        }
-        settlement_ptr s(new settlement(node,map_));
+        settlement_ptr s(new settlement(s1->second,map_));
         std::vector<hex::location> locs;
         s->entry_points(locs);
         foreach(const hex::location& loc, locs) {
             settlements_[loc] = s;
+            settlement_entrances_.insert(s, loc);
         }
     }
     
@@ -178,6 +181,13 @@ world::world(wml::const_node_ptr node)
 		destination& dst = exits_[loc1];
 		dst.loc = loc2;
     }
+
+    for(std::map<hex::location,destination>::const_iterator i = exits_.begin();
+        i != exits_.end(); ++i) {
+        if(i->second.level.empty() == false) {
+            exits_to_load_[i->second.level].push_back(i->first);
+        }
+    }
     
     const std::vector<wml::const_node_ptr> events = wml::child_nodes(node, "event");
     foreach(const wml::const_node_ptr& event, events) {
@@ -226,8 +236,8 @@ wml::node_ptr world::write() const
 
 	res->set_attr("border_tile", border_tile_);
 
-	for(party_map::const_iterator i = parties_.begin(); i != parties_.end(); ++i) {
-		res->add_child(i->second->write());
+	foreach(const party_ptr& p, parties_.values()) {
+		res->add_child(p->write());
 	}
 
 	for(std::map<hex::location,destination>::const_iterator i = exits_.begin(); i != exits_.end(); ++i) {
@@ -244,12 +254,14 @@ wml::node_ptr world::write() const
 		res->add_child(i->second->write());
 	}
 
-	for(event_map::const_iterator i = handlers_.begin(); i != handlers_.end(); ++i) {
-		wml::const_node_ptr event = i->second.write();
-		if(event) {
-			wml::node_ptr event_copy = wml::deep_copy(event);
-			event_copy->set_attr("event", i->first);
-			res->add_child(event_copy);
+	for(int id = 0; id != handlers_.size(); ++id) {
+		foreach(const event_handler& handler, handlers_[id]) {
+			wml::const_node_ptr event = handler.write();
+			if(event) {
+				wml::node_ptr event_copy = wml::deep_copy(event);
+				event_copy->set_attr("event", get_event_name(id));
+				res->add_child(event_copy);
+			}
 		}
 	}
 
@@ -260,9 +272,9 @@ wml::node_ptr world::write() const
 
 game_logic::const_party_ptr world::get_party_at(const hex::location& loc) const
 {
-	const_party_map_range range = parties_.equal_range(loc);
-	if(range.first != range.second) {
-		return range.first->second;
+	const party_grid::handle h = parties_.find_at(loc);
+	if(h != party_grid::NoHandle) {
+		return parties_.value(h);
 	}
 	
 	return game_logic::const_party_ptr();
@@ -270,11 +282,50 @@ game_logic::const_party_ptr world::get_party_at(const hex::location& loc) const
 
 void world::get_parties_at(const hex::location& loc, std::vector<const_party_ptr>& chars) const
 {
-	const_party_map_range range = parties_.equal_range(loc);
-	while(range.first != range.second) {
-		chars.push_back(range.first->second);
-		++range.first;
-	}
+	parties_.get_at(loc, chars);
+}
+
+size_t world::memory_estimate() const
+{
+    //the tiles of the map and the parties, with their characters, are
+    //most of what a world holds.
+    const int PartyBytes = 4096;
+    return map_.size().x()*map_.size().y()*sizeof(hex::tile) +
+           parties_.size()*PartyBytes;
+}
+
+bool world::is_anyone_near(const party& p, int radius)
+{
+    bool found = false;
+    std::vector<party_ptr> near;
+    parties_.get_in_radius(p.loc(), radius, near);
+    foreach(const party_ptr& other, near) {
+        if(other.get() != &p) {
+            found = true;
+            if(other->wake()) {
+                schedule_party(other);
+            }
+        }
+    }
+
+    if(found) {
+        return true;
+    }
+
+    std::vector<const_settlement_ptr> entrances;
+    settlement_entrances_.get_in_radius(p.loc(), radius, entrances);
+    return !entrances.empty();
+}
+
+void world::wake_parties_near(const hex::location& loc, int radius)
+{
+    std::vector<party_ptr> near;
+    parties_.get_in_radius(loc, radius, near);
+    foreach(const party_ptr& other, near) {
+        if(other->wake()) {
+            schedule_party(other);
+        }
+    }
 }
 
 const_settlement_ptr world::settlement_at(const hex::location& loc) const
@@ -287,37 +338,124 @@ const_settlement_ptr world::settlement_at(const hex::location& loc) const
 	}
 }
 
-world::party_map::iterator world::add_party(party_ptr new_party)
+void world::add_party(party_ptr new_party)
 {
-	party_map::iterator res = parties_.insert(std::pair<hex::location,party_ptr>(
-	                 new_party->loc(),new_party));
-	queue_.push(new_party);
+	new_party->set_grid_handle(parties_.insert(new_party, new_party->loc()));
+	schedule_party(new_party);
 
 	std::cerr << "added party at " << new_party->loc().x() << "," << new_party->loc().y() << "\n";
-	if(new_party->is_human_controlled()) {
+	if(new_party->is_human_controlled() && !preference_headless()) {
 		std::cerr << "is human\n";
 		focus_ = new_party;
 		game_bar_.reset(new game_dialogs::game_bar(0, graphics::screen_height()-128,
 							   graphics::screen_width(), 128, new_party, this));
 		game_bar_->set_frame(gui::frame_manager::make_frame(game_bar_, "game-bar-frame"));
 	}
-
-	return res;
 }
 
 void world::relocate_party(party_ptr party, const hex::location& loc)
 {
-	if(remove_party(party)) {
-		parties_.insert(std::pair<hex::location,party_ptr>(loc,party));
+	if(party->grid_handle() != party_grid::NoHandle) {
+		parties_.move(party->grid_handle(), loc);
 	}
 	party->set_loc(loc);
 }
 
+const_movement_cost_grid_ptr world::get_movement_cost_grid(
+                               const movement_profile& profile) const
+{
+	cost_grid_map::iterator i = cost_grids_.find(profile);
+	if(i != cost_grids_.end()) {
+		const_movement_cost_grid_ptr grid = i->second.lock();
+		if(grid && grid->is_current()) {
+			return grid;
+		}
+	}
+
+	//clean out grids that are no longer used by any party
+	for(cost_grid_map::iterator j = cost_grids_.begin(); j != cost_grids_.end(); ) {
+		if(j->second.expired()) {
+			cost_grids_.erase(j++);
+		} else {
+			++j;
+		}
+	}
+
+	const_movement_cost_grid_ptr grid(new movement_cost_grid(map_, profile));
+	cost_grids_[profile] = grid;
+	return grid;
+}
+
+const_distance_field_ptr world::get_distance_field(
+                               const_movement_cost_grid_ptr grid,
+                               const hex::location& target) const
+{
+	distance_field_ptr adjacent;
+	std::pair<distance_field_map::iterator,distance_field_map::iterator>
+	    range = distance_fields_.equal_range(grid.get());
+	while(range.first != range.second) {
+		distance_field_ptr field = range.first->second.lock();
+		if(!field) {
+			distance_fields_.erase(range.first++);
+			continue;
+		}
+
+		if(field->target() == target) {
+			return field;
+		}
+
+		if(!adjacent && hex::tiles_adjacent(field->target(), target)) {
+			adjacent = field;
+		}
+
+		++range.first;
+	}
+
+	//clean out fields that are no longer used by any party
+	for(distance_field_map::iterator i = distance_fields_.begin();
+	    i != distance_fields_.end(); ) {
+		if(i->second.expired()) {
+			distance_fields_.erase(i++);
+		} else {
+			++i;
+		}
+	}
+
+	//other parties may still be following the adjacent field to its
+	//own target, so a copy of it is moved rather than the field itself.
+	distance_field_ptr field;
+	if(adjacent) {
+		field.reset(new distance_field(*adjacent));
+		field->set_target(target);
+	} else {
+		field.reset(new distance_field(grid, target));
+	}
+
+	distance_fields_.insert(std::make_pair(grid.get(), boost::weak_ptr<distance_field>(field)));
+	return field;
+}
+
+hex::const_field_of_view_ptr world::get_static_field_of_view(
+                               const hex::location& loc, int radius) const
+{
+	hex::field_of_view_ptr& fov = static_views_[std::make_pair(loc, radius)];
+	if(!fov) {
+		fov.reset(new hex::field_of_view);
+	}
+
+	if(fov->center() != loc || fov->radius() != radius ||
+	   !fov->is_current(map_)) {
+		fov->calculate(map_, loc, radius);
+	}
+
+	return fov;
+}
+
 void world::get_matching_parties(const formula* filter, std::vector<party_ptr>& res)
 {
-	for(party_map::iterator i = parties_.begin(); i != parties_.end(); ++i) {
-		if(!filter || filter->execute(*i->second).as_bool()) {
-			res.push_back(i->second);
+	foreach(const party_ptr& p, parties_.values()) {
+		if(!filter || filter->execute(*p).as_bool()) {
+			res.push_back(p);
 		}
 	}
 }
@@ -340,8 +478,24 @@ bool world::draw() const
     std::vector<hex::location> path;
     const_party_ptr selected_party = get_party_at(selected_loc);
     if(map_.is_loc_on_map(selected_loc)) {
-        const bool adjacent_only = visible.count(selected_loc) && parties_.count(selected_loc);
-        hex::find_path(focus_->loc(), selected_loc, *focus_, &path, 500, adjacent_only);
+        //search for the path to the hex under the mouse in the background,
+        //and show it once it has been found.
+        if(!hover_path_ || hover_path_->src() != focus_->loc() ||
+           hover_path_->dst() != selected_loc) {
+            if(hover_path_) {
+                hover_path_->cancel();
+            }
+
+            const bool adjacent_only = visible.count(selected_loc) && selected_party;
+            hover_path_ = path_service::get().find_path(focus_->loc(), selected_loc, focus_->path_snapshot(), 500, adjacent_only);
+        }
+
+        if(hover_path_->ready()) {
+            path = hover_path_->path();
+        }
+    } else if(hover_path_) {
+        hover_path_->cancel();
+        hover_path_.reset();
     }
 
     const_settlement_ptr selected_settlement = settlement_at(selected_loc);
@@ -381,14 +535,14 @@ bool world::draw() const
                             graphics::texture::get(graphics::surface_cache::get(decal)));
     }
     
+    //only the parties the focus can see are looked at.
+    std::vector<const_party_ptr> visible_parties;
+    focus_->get_visible_parties(visible_parties);
     std::vector<const_party_ptr> enemies;
-    for(party_map::const_iterator i = parties_.begin();
-        i != parties_.end(); ++i) {
-        if(visible.count(i->second->loc())) {
-            renderer_.add_avatar(i->second->avatar());
-            if(focus_ && i->second->is_enemy(*focus_)) {
-                enemies.push_back(i->second);
-            }
+    foreach(const const_party_ptr& p, visible_parties) {
+        renderer_.add_avatar(p->avatar());
+        if(p->is_enemy(*focus_)) {
+            enemies.push_back(p);
         }
     }
     
@@ -444,7 +598,8 @@ void world::draw_display(const_party_ptr selected_party) const {
     text::renderer& text_renderer = text::renderer::instance();
     
     const text::rendered_text_ptr text = 
-        text_renderer.render(renderer_.status_text(),20,white); 
+        text_renderer.render(renderer_.status_text() +
+                             (formatter() << " " << static_cast<int>(sim_rate_) << " game s/s").str(),20,white); 
     text->blit(50,10);
     
     track_info_grid_ = get_track_info();
@@ -519,12 +674,262 @@ void world::draw_display(const_party_ptr selected_party) const {
 
 namespace {
 const GLfloat game_speed = 0.2;
+
+//the length of a step of the world in milliseconds of real time, and
+//the most steps it may take between two frames. If drawing is slower
+//than that the world slows down, rather than spending ever longer
+//catching up.
+const int StepMs = 20;
+const int MaxStepsPerFrame = 5;
+
+//parties are never drawn further through a move than this.
+const GLfloat MaxSubtime = 0.999;
+
+//how close the player's party comes to an exit before the world it
+//leads to is read.
+const unsigned int PreloadDistance = 10;
+
+const event_id TickEvent = get_event_id("tick");
+}
+
+void world::preload_exits(const hex::location& loc) const
+{
+    typedef std::pair<const std::string,std::vector<hex::location> > exit_list;
+    foreach(const exit_list& exits, exits_to_load_) {
+        foreach(const hex::location& exit, exits.second) {
+            if(hex::distance_between(loc, exit) <= PreloadDistance) {
+                world_loader::get().preload(exits.first);
+                break;
+            }
+        }
+    }
+}
+
+GLfloat world::time_increase() const
+{
+    GLfloat increase = scale_ * game_speed;
+
+    if(keys_.key(SUPER_ACCEL_TIME_KEY)) {
+        increase *= 6;
+    } else if(keys_.key(ACCEL_TIME_KEY) || !script_.empty()) {
+        increase *= 2;
+    }
+
+    //nothing is drawn, so time needn't move on smoothly.
+    if(preference_headless()) {
+        increase = std::max<GLfloat>(1.0, increase);
+    }
+
+    return increase;
 }
 
 void world::find_focus() {
-    for(party_map::const_iterator i = parties_.begin(); i != parties_.end(); ++i) {
-        if(i->second->is_human_controlled()) {
-            focus_ = i->second;
+    foreach(const party_ptr& p, parties_.values()) {
+        if(p->is_human_controlled()) {
+            focus_ = p;
+            break;
+        }
+    }
+}
+
+world::STEP_RESULT world::step(input::pump& input_pump,
+                                const formula_callable& standard_callable,
+                                party_ptr& active_party, world_ptr* next)
+{
+    ++stats_.steps;
+    if(!script_.empty()) {
+        bool scripted_moves = false;
+        foreach(const party_ptr& p, parties_.values()) {
+            if(p->has_script()) {
+                scripted_moves = true;
+                break;
+            }
+        }
+        
+        if(!scripted_moves) {
+            map_formula_callable_ptr script_callable(new map_formula_callable);
+            script_callable->add("script", variant(script_))
+                .add("pc", variant(get_pc_party().get()))
+                .add("world", variant(this))
+                .add("var", variant(&global_game_state::get().get_variables()));
+            script_.clear();
+            fire_event("finish_script", *script_callable);
+            renderer_.reset_timing();
+        }
+    }
+    
+    path_service::get().deliver();
+
+    if(!active_party) {
+        active_party = get_party_ready_to_move();
+    }
+    
+    party::TURN_RESULT party_result = party::TURN_COMPLETE;
+    while(active_party && party_result == party::TURN_COMPLETE) {
+        if(active_party->loc() != active_party->previous_loc()) {
+            active_party->finish_move();
+        }
+        
+        hex::location start_loc = active_party->loc();
+        
+        ++stats_.party_turns;
+        if(preference_headless() && active_party->is_human_controlled() &&
+           !active_party->has_script()) {
+            //there is nobody to move the player's party, so it rests.
+            active_party->pass();
+        } else if(script_.empty() || active_party->has_script()) {
+            party_result = active_party->play_turn();
+        } else {
+            active_party->pass();
+        }
+
+        //parties left waiting near the player catch up before they
+        //can be seen.
+        const int detail_distance = preference_npc_detail_distance();
+        if(active_party->is_human_controlled() && detail_distance > 0) {
+            wake_parties_near(active_party->loc(), detail_distance*2);
+        }
+        
+        if(party_result == party::TURN_COMPLETE) {
+            if(start_loc != active_party->loc()) {
+                //the party is still indexed where it started its move.
+                std::vector<party_ptr> others;
+                parties_.get_at(active_party->loc(), others);
+                bool path_cleared = true;
+                bool were_encounters = false;
+                
+                foreach(const party_ptr& other, others) {
+                    if(active_party->is_destroyed()) {
+                        break;
+                    }
+
+                    if(active_party->is_human_controlled() ||
+                       other->is_human_controlled()) {
+                        were_encounters = true;
+                    }
+                    ++stats_.encounters;
+                    handle_encounter(active_party,other, map());
+                    if(other->is_destroyed()) {
+                        unschedule_party(*other);
+                        remove_party(other);
+                    } else {
+                        other->set_destination(other->loc());
+                        path_cleared = false;
+                    }
+                }
+                if(!path_cleared) {
+                    active_party->set_loc(start_loc);
+                }
+                if(were_encounters) {
+                    renderer_.reset_timing();
+                    input_pump.reset();
+                    active_party->set_destination(active_party->loc());
+                }
+            }
+            
+            remove_party(active_party);
+            
+            if(active_party->is_destroyed() == false) {
+                if(active_party->is_human_controlled()) {
+                    preload_exits(active_party->loc());
+                }
+
+                std::map<hex::location,destination>::const_iterator exit = exits_.find(active_party->loc());
+                if(script_.empty() && exit != exits_.end() && active_party->is_human_controlled()) {
+                    std::cerr << "exiting through exit at " << active_party->loc().x() << "," << active_party->loc().y() << "\n";
+                    active_party->set_loc(exit->second.loc);
+                    remove_party(active_party);
+                    std::cerr << "returning from world...\n";
+
+                    world_ptr res;
+                    if(exit->second.level.empty() == false) {
+                        res = world_loader::get().load(exit->second.level);
+                        if(!filename_.empty()) {
+                            world_loader::get().keep(this);
+                        }
+                        res->camera().set_rotation(camera());
+                        res->advance_time_until(time_);
+                        active_party->new_world(*res, exit->second.loc);
+                        res->add_party(active_party);
+                    }
+                    *next = res;
+                    return STEP_LEFT_WORLD;
+                }
+                
+                settlement_map::iterator s = settlements_.find(active_party->loc());
+                if(s != settlements_.end() && active_party->is_human_controlled()) {
+                    remove_party(active_party);
+                    //enter the new world
+                    time_ = s->second->enter(active_party, active_party->loc(), time_, *this);
+                    
+                    //player has left the settlement, return to this world
+                    active_party->new_world(*this,active_party->loc(),active_party->last_move());
+						camera_.set_rotation(s->second->get_world().camera_);
+                    renderer_.reset_timing();
+                    input_pump.reset();
+                    map_formula_callable_ptr standard_callable(new map_formula_callable);
+                    //since we've left the settlement we fire a 'start'
+                    //event, since we're in this world again.
+                    standard_callable->add("world", variant(this))
+                        .add("pc", variant(get_pc_party().get()))
+                        .add("var", variant(&global_game_state::get().get_variables()));
+                    fire_event("start", *standard_callable);
+                }
+                
+                if(active_party->is_destroyed() == false) {
+                    active_party->set_grid_handle(
+                        parties_.insert(active_party, active_party->loc()));
+                    schedule_party(active_party);
+                }
+            }
+            
+            active_party = get_party_ready_to_move();
+            if(!focus_ && active_party && active_party->is_human_controlled()) {
+                focus_ = active_party;
+            }
+        }
+    }
+    
+    if(active_party) {
+        return STEP_WAITING;
+    }
+
+    //when nothing is drawn and nothing listens for ticks, time can move
+    //straight on to when the next party is ready.
+    if(preference_headless() && !has_event_handlers(TickEvent) &&
+       !queue_.empty() && queue_.next_due() > time_.since_epoch()) {
+        time_ += queue_.next_due() - time_.since_epoch();
+        subtime_ = 0.0;
+        return STEP_ADVANCED;
+    }
+
+    subtime_ += time_increase();
+    
+    if(subtime_ >= 1.0) {
+        time_ += static_cast<int>(subtime_);
+        subtime_ = 0.0;
+        fire_event(TickEvent, standard_callable);
+    }
+
+    return STEP_ADVANCED;
+}
+
+void world::simulate(const game_time& until)
+{
+    world_context context(this);
+
+    map_formula_callable_ptr standard_callable(new map_formula_callable);
+    standard_callable->add("world", variant(this))
+        .add("pc", variant(get_pc_party().get()))
+        .add("var", variant(&global_game_state::get().get_variables()));
+    fire_event("start", *standard_callable);
+
+    input::pump input_pump;
+    party_ptr active_party;
+    while(!done_ && time_ < until) {
+        world_ptr next;
+        if(step(input_pump, *standard_callable, active_party, &next) ==
+           STEP_LEFT_WORLD) {
             break;
         }
     }
@@ -541,7 +946,8 @@ world_ptr world::play()
     if(!get_pc_party()) {
         for(settlement_map::iterator i = settlements_.begin();
             i != settlements_.end(); ++i) {
-            if(party_ptr p = i->second->get_world().get_pc_party()) {
+            if(i->second->has_pc_party()) {
+                party_ptr p = i->second->get_world().get_pc_party();
                 i->second->play();
                 time_ = i->second->get_world().current_time();
                 p->new_world(*this,p->loc(),p->last_move());
@@ -580,6 +986,12 @@ world_ptr world::play()
     input_pump.register_listener(&camera_controller_);
     input_pump.register_listener(&selection_);
 
+    Uint32 last_step = SDL_GetTicks();
+    int step_ms_due = 0;
+    Uint32 rate_start = last_step;
+    game_time rate_time = time_;
+    GLfloat rate_subtime = subtime_;
+
     while(!done_) {
         if(!focus_) {
             find_focus();
@@ -596,153 +1008,42 @@ world_ptr world::play()
             quit_ = true;
         }                 
         
-        if(!script_.empty()) {
-            bool scripted_moves = false;
-            for(party_map::const_iterator i = parties_.begin(); i != parties_.end(); ++i) {
-                if(i->second->has_script()) {
-                    scripted_moves = true;
-                    break;
-                }
-            }
-            
-            if(!scripted_moves) {
-                map_formula_callable_ptr script_callable(new map_formula_callable);
-                script_callable->add("script", variant(script_))
-                    .add("pc", variant(get_pc_party().get()))
-                    .add("world", variant(this))
-                    .add("var", variant(&global_game_state::get().get_variables()));
-                script_.clear();
-                fire_event("finish_script", *script_callable);
-                renderer_.reset_timing();
+        //the world moves on in steps of a fixed length of real time,
+        //as many of them as have fallen due since it was last drawn, so
+        //that it moves at the same speed however fast it's drawn.
+        const Uint32 now = SDL_GetTicks();
+        step_ms_due += std::min<int>(now - last_step, StepMs*MaxStepsPerFrame);
+        last_step = now;
+        while(!done_ && step_ms_due >= StepMs) {
+            step_ms_due -= StepMs;
+            world_ptr next;
+            const STEP_RESULT result = step(input_pump, *standard_callable,
+                                            active_party, &next);
+            if(result == STEP_LEFT_WORLD) {
+                return next;
+            } else if(result == STEP_WAITING) {
+                //the world waits for the party to finish its turn, so
+                //the time spent waiting isn't owed to it.
+                step_ms_due = 0;
             }
         }
-        
+
+        //parties are drawn part of the way to where the next step
+        //will take them.
+        display_subtime_ = subtime_;
         if(!active_party) {
-            active_party = get_party_ready_to_move();
-        }
-        
-        party::TURN_RESULT party_result = party::TURN_COMPLETE;
-        while(active_party && party_result == party::TURN_COMPLETE) {
-            if(active_party->loc() != active_party->previous_loc()) {
-                active_party->finish_move();
-            }
-            
-            hex::location start_loc = active_party->loc();
-            
-            if(script_.empty() || active_party->has_script()) {
-                party_result = active_party->play_turn();
-            } else {
-                active_party->pass();
-            }
-            
-            if(party_result != party::TURN_STILL_THINKING) {
-                if(start_loc != active_party->loc()) {
-                    party_map_range range = parties_.equal_range(active_party->loc());
-                    bool path_cleared = true;
-                    bool were_encounters = false;
-                    
-                    while(range.first != range.second && !active_party->is_destroyed()) {
-                        if(active_party->is_human_controlled() ||
-                           range.first->second->is_human_controlled()) {
-                            were_encounters = true;
-                        }
-                        handle_encounter(active_party,range.first->second, map());
-                        if(range.first->second->is_destroyed()) {
-                            parties_.erase(range.first++);
-                        } else {
-                            range.first->second->set_destination(range.first->second->loc());
-                            path_cleared = false;
-                            ++range.first;
-                        }
-                    }
-                    if(!path_cleared) {
-                        active_party->set_loc(start_loc);
-                    }
-                    if(were_encounters) {
-                        renderer_.reset_timing();
-                        input_pump.reset();
-                        active_party->set_destination(active_party->loc());
-                    }
-                }
-                
-                //find the party in the map and erase it.
-                std::pair<party_map::iterator,party_map::iterator> loc_range = parties_.equal_range(start_loc);
-                while(loc_range.first != loc_range.second) {
-                    if(loc_range.first->second == active_party) {
-                        parties_.erase(loc_range.first);
-                        break;
-                    }
-                    ++loc_range.first;
-                }
-                
-                if(active_party->is_destroyed() == false) {
-                    std::map<hex::location,destination>::const_iterator exit = exits_.find(active_party->loc());
-                    if(script_.empty() && exit != exits_.end() && active_party->is_human_controlled()) {
-                        std::cerr << "exiting through exit at " << active_party->loc().x() << "," << active_party->loc().y() << "\n";
-                        active_party->set_loc(exit->second.loc);
-                        remove_party(active_party);
-                        std::cerr << "returning from world...\n";
-
-                        world_ptr res;
-                        if(exit->second.level.empty() == false) {
-                            res = new world(wml::parse_wml(sys::read_file(exit->second.level)));
-                            res->camera().set_rotation(camera());
-                            res->advance_time_until(time_);
-                            active_party->new_world(*res, exit->second.loc);
-                            res->add_party(active_party);
-                        }
-                        return res;
-                    }
-                    
-                    settlement_map::iterator s = settlements_.find(active_party->loc());
-                    if(s != settlements_.end() && active_party->is_human_controlled()) {
-                        remove_party(active_party);
-                        //enter the new world
-                        time_ = s->second->enter(active_party, active_party->loc(), time_, *this);
-                        
-                        //player has left the settlement, return to this world
-                        active_party->new_world(*this,active_party->loc(),active_party->last_move());
-						camera_.set_rotation(s->second->get_world().camera_);
-                        renderer_.reset_timing();
-                        input_pump.reset();
-                        map_formula_callable_ptr standard_callable(new map_formula_callable);
-                        //since we've left the settlement we fire a 'start'
-                        //event, since we're in this world again.
-                        standard_callable->add("world", variant(this))
-                            .add("pc", variant(get_pc_party().get()))
-                            .add("var", variant(&global_game_state::get().get_variables()));
-                        fire_event("start", *standard_callable);
-                    }
-                    
-                    if(active_party->is_destroyed() == false) {
-                        parties_.insert(std::pair<hex::location,party_ptr>(active_party->loc(),active_party));
-                        queue_.push(active_party);
-                    }
-                }
-                
-                active_party = get_party_ready_to_move();
-                if(!focus_ && active_party && active_party->is_human_controlled()) {
-                    focus_ = active_party;
-                }
-            }
+            display_subtime_ = std::min<GLfloat>(MaxSubtime,
+                 subtime_ + time_increase()*step_ms_due/StepMs);
         }
-        
-        if(!active_party) {
-            double increase = scale_ * game_speed;
 
-            if(keys_.key(SUPER_ACCEL_TIME_KEY)) {
-                increase *= 6;
-            } else if(keys_.key(ACCEL_TIME_KEY) || !script_.empty()) {
-                increase *= 2;
-            } 
-            
-            subtime_ += increase;
-            
-            if(subtime_ >= 1.0) {
-                time_ += static_cast<int>(subtime_);
-                subtime_ = 0.0;
-                fire_event("tick", *standard_callable);
-            }
+        //how much game time has passed each second of real time.
+        if(now - rate_start >= 1000) {
+            const double elapsed = (time_ - rate_time) +
+                                   (subtime_ - rate_subtime);
+            sim_rate_ = elapsed*1000.0/(now - rate_start);
+            rate_start = now;
+            rate_time = time_;
+            rate_subtime = subtime_;
         }
         
         if(keys_.key(SHOW_GRID)) {
@@ -760,29 +1061,26 @@ world_ptr world::play()
 	return world_ptr();
 }
 
-world::party_map::iterator world::find_party(const_party_ptr p)
+party_ptr world::get_party_ready_to_move()
 {
-    for(party_map_range range = parties_.equal_range(p->loc());
-        range.first != range.second; ++range.first) {
-        if(range.first->second == p) {
-            return range.first;
-        }
+    party_ptr res;
+    if(queue_.pop(time_.since_epoch(), &res)) {
+        res->set_queue_handle(util::timing_wheel<party_ptr>::NoHandle);
     }
-    
-    return parties_.end();
+
+    return res;
 }
 
-party_ptr world::get_party_ready_to_move()
+void world::schedule_party(party_ptr p)
 {
-    while(!queue_.empty() && queue_.top()->ready_to_move_at() <= time_){
-        party_ptr res = queue_.top();
-        queue_.pop();
-        if(find_party(res) != parties_.end()) {
-            return res;
-        }
-    }
-    
-    return party_ptr();
+    unschedule_party(*p);
+    p->set_queue_handle(queue_.insert(p, p->ready_to_move_at().since_epoch()));
+}
+
+void world::unschedule_party(party& p)
+{
+    queue_.cancel(p.queue_handle());
+    p.set_queue_handle(util::timing_wheel<party_ptr>::NoHandle);
 }
 
 gui::const_grid_ptr world::get_track_info() const
@@ -793,7 +1091,8 @@ gui::const_grid_ptr world::get_track_info() const
 
 	const int track = focus_->track();
 
-	const tracks::tracks_list& list = tracks_.get_tracks(focus_->loc(),time_);
+	tracks::tracks_list list;
+	tracks_.get_tracks(focus_->loc(),time_,list);
 	if(list.empty()) {
 		return gui::const_grid_ptr();
 	}
@@ -904,19 +1203,80 @@ void world::set_lighting(graphics::renderer& renderer, const GLfloat *focus_pos)
 
 void world::fire_event(const std::string& name, const formula_callable& info)
 {
-	//std::cerr << "event: '" << name << "': " << variant(&info).to_debug_string() << "\n";
-	std::pair<event_map::iterator,event_map::iterator> range =
-	     handlers_.equal_range(name);
-	while(range.first != range.second) {
-            //std::cerr << "calling handler...\n";
-            range.first->second.handle(info, *this);
-            ++range.first;
+	fire_event(get_event_id(name), info);
+}
+
+void world::fire_event(event_id id, const formula_callable& info,
+                       const party* npc)
+{
+	++stats_.events_fired;
+	if(id >= handlers_.size() || handlers_[id].empty()) {
+		return;
+	}
+
+	//handlers added while the event is handled don't handle it.
+	const std::clock_t start = std::clock();
+	const int nhandlers = handlers_[id].size();
+	for(int n = 0; n != nhandlers; ++n) {
+		event_handler& handler = handlers_[id][n];
+		if(handler.wants(npc)) {
+			++stats_.event_handlers_run;
+			handler.handle(info, *this, npc);
+		}
+	}
+
+	stats_.event_handler_seconds += double(std::clock() - start)/CLOCKS_PER_SEC;
+
+	//the pooled callable refers to the world, which holds on to it, so
+	//it's emptied as soon as it's been used. If a handler kept it, it's
+	//left to the handler and a new one is pooled next time.
+	if(event_callable_ && &info == event_callable_.get()) {
+		if(event_callable_->refcount() > 2) {
+			event_callable_.reset();
+		} else {
+			event_callable_->clear();
+		}
+	}
+}
+
+bool world::has_event_handlers(event_id id, const party* npc) const
+{
+	if(id >= handlers_.size()) {
+		return false;
+	}
+
+	foreach(const event_handler& handler, handlers_[id]) {
+		if(handler.wants(npc)) {
+			return true;
+		}
 	}
+
+	return false;
+}
+
+map_formula_callable_ptr world::event_callable()
+{
+	if(!event_callable_ || event_callable_->refcount() > 1) {
+		event_callable_.reset(new map_formula_callable);
+	}
+
+	event_callable_->add("world", variant(this))
+	     .add("var", variant(&global_game_state::get().get_variables()));
+	return event_callable_;
 }
 
 void world::add_event_handler(const std::string& event, const event_handler& handler)
 {
-	handlers_.insert(std::pair<std::string,event_handler>(event,handler));
+	add_event_handler(get_event_id(event), handler);
+}
+
+void world::add_event_handler(event_id id, const event_handler& handler)
+{
+	if(id >= handlers_.size()) {
+		handlers_.resize(id + 1);
+	}
+
+	handlers_[id].push_back(handler);
 }
 
 party_ptr world::get_pc_party() const
@@ -925,9 +1285,9 @@ party_ptr world::get_pc_party() const
         return focus_;
     }
     
-    for(party_map::const_iterator i = parties_.begin(); i != parties_.end(); ++i) {
-        if(i->second->is_human_controlled()) {
-            return i->second;
+    foreach(const party_ptr& p, parties_.values()) {
+        if(p->is_human_controlled()) {
+            return p;
         }
     }
     
@@ -936,17 +1296,13 @@ party_ptr world::get_pc_party() const
 
 bool world::remove_party(party_ptr p)
 {
-    std::pair<party_map::iterator,party_map::iterator> range = parties_.equal_range(p->loc());
-    while(range.first != range.second) {
-        if(range.first->second == p) {
-            parties_.erase(range.first);
-            return true;
-        }
-        
-        ++range.first;
+    if(p->grid_handle() == party_grid::NoHandle) {
+        return false;
     }
-    
-    return false;
+
+    parties_.erase(p->grid_handle());
+    p->set_grid_handle(party_grid::NoHandle);
+    return true;
 }
 
 void world::get_inputs(std::vector<formula_input>* inputs) const
@@ -968,8 +1324,8 @@ variant world::get_value(const std::string& key) const
         return variant(get_pc_party().get());
     } else if(key == "parties") {
         std::vector<variant> parties;
-        for(party_map::const_iterator i = parties_.begin(); i != parties_.end(); ++i) {
-            parties.push_back(variant(i->second.get()));
+        foreach(const party_ptr& p, parties_.values()) {
+            parties.push_back(variant(p.get()));
         }
         
         return variant(&parties);
@@ -17,13 +17,15 @@
 #include <config.h>
 #endif
 
+#include <boost/weak_ptr.hpp>
+#include <deque>
 #include <functional>
 #include <map>
-#include <queue>
 #include <string>
 
 #include "camera.hpp"
 #include "camera_controller.hpp"
+#include "distance_field.hpp"
 #include "event_handler.hpp"
 #include "formula.hpp"
 #include "frame_rate_utils.hpp"
@@ -31,12 +33,17 @@
 #include "game_bar.hpp"
 #include "game_time.hpp"
 #include "grid_widget_fwd.hpp"
+#include "field_of_view.hpp"
 #include "input.hpp"
 #include "particle_system.hpp"
 #include "party.hpp"
+#include "path_service.hpp"
 #include "renderer.hpp"
 #include "map_selection.hpp"
+#include "movement_cost_grid.hpp"
 #include "settlement_fwd.hpp"
+#include "spatial_grid.hpp"
+#include "timing_wheel.hpp"
 #include "tracks.hpp"
 #include "wml_node.hpp"
 #include "world_fwd.hpp"
@@ -76,14 +83,49 @@ public:
     wml::node_ptr write() const;
     
     world_ptr play();
+
+    //plays the world on until the given time, as fast as possible,
+    //without drawing it or reading any input.
+    void simulate(const game_time& until);
+
+    //counts of what has happened in the world since it was made.
+    struct statistics {
+        statistics() : steps(0), party_turns(0), encounters(0),
+                       battles(0), battles_won(0),
+                       events_fired(0), event_handlers_run(0),
+                       event_handler_seconds(0.0)
+        {}
+        int steps, party_turns, encounters;
+        int battles, battles_won;
+        int events_fired, event_handlers_run;
+        double event_handler_seconds;
+    };
+    const statistics& stats() const { return stats_; }
+
+    //a rough count of the bytes the world takes up, so it can be told
+    //which worlds are worth unloading.
+    size_t memory_estimate() const;
+    void record_battle(bool won) { ++stats_.battles; stats_.battles_won += won; }
     
     void set_script(const std::string& script) { script_ = script; }
+
+    //the file the world was made from, if it was made from a file
+    //rather than a saved game.
+    const std::string& filename() const { return filename_; }
+    void set_filename(const std::string& file) { filename_ = file; }
     
     const hex::gamemap& map() const { return map_; }
     int scale() const { return scale_; }
     const game_time& current_time() const { return time_; }
     void advance_time_until(const game_time& t) { time_ = t; }
-    const GLfloat& subtime() const { return subtime_; }
+
+    //how far through the current second of game time the world is, as
+    //it is drawn: between the steps of the world this moves on smoothly,
+    //so that parties are drawn moving smoothly.
+    const GLfloat& subtime() const { return display_subtime_; }
+
+    //how many seconds of game time have been passing each second.
+    double simulation_rate() const { return sim_rate_; }
     
     hex::camera& camera() { return camera_; }
     const hex::camera& camera() const { return camera_; }
@@ -92,19 +134,65 @@ public:
     void get_parties_at(const hex::location& loc, std::vector<const_party_ptr>& chars) const;
     
     const_settlement_ptr settlement_at(const hex::location& loc) const;
-    typedef std::multimap<hex::location,party_ptr> party_map;
-    party_map::iterator add_party(party_ptr pty);
+    typedef hex::spatial_grid<party_ptr> party_grid;
+    void add_party(party_ptr pty);
     void relocate_party(party_ptr party, const hex::location& loc);
     void get_matching_parties(const formula* filter,
                               std::vector<party_ptr>& res);
-    party_map& parties() { return parties_; }
-    const party_map& parties() const { return parties_; }
-    
+    const party_grid& parties() const { return parties_; }
+
+    //whether any other party, or any settlement, is within radius of
+    //the party. Parties there which were waiting because nobody was
+    //near them are woken.
+    bool is_anyone_near(const party& p, int radius);
+
+    //wakes the waiting parties within radius of loc.
+    void wake_parties_near(const hex::location& loc, int radius);
+    
+    //returns the grid of movement costs over this world's map for the
+    //given profile. Grids are shared between all parties with the same
+    //profile, and are freed once no party uses them.
+    const_movement_cost_grid_ptr get_movement_cost_grid(
+                               const movement_profile& profile) const;
+
+    //returns the distances to the given target for parties moving
+    //with the given grid of costs. Fields are shared between all parties
+    //heading for the same target with the same costs, and are freed once
+    //no party uses them. When the target moves to an adjacent hex, a
+    //copy of the field for its old position is repaired rather than a
+    //new one built.
+    const_distance_field_ptr get_distance_field(
+                               const_movement_cost_grid_ptr grid,
+                               const hex::location& target) const;
+
+    //returns what can be seen from a place parties stay at, such as a
+    //settlement. Once calculated, fields of view are kept for as long as
+    //the world exists, and only calculated again if the map changes.
+    hex::const_field_of_view_ptr get_static_field_of_view(
+                               const hex::location& loc, int radius) const;
+
     tracks& get_tracks() { return tracks_; }
     const tracks& get_tracks() const { return tracks_; }
     
+    //fires an event. npc is the npc party the event involves, if the
+    //caller knows it, so that handlers for other parties are passed over
+    //without running their filters.
     void fire_event(const std::string& name, const formula_callable& info);
+    void fire_event(event_id id, const formula_callable& info,
+                    const party* npc=NULL);
+
+    //whether firing the event would run any handlers, so that the
+    //callable for it needn't be made if not.
+    bool has_event_handlers(event_id id, const party* npc=NULL) const;
+
+    //returns a callable holding "world" and "var", to add the other
+    //inputs of an event to. The same callable is handed out again once
+    //nothing else holds it. It must be passed to fire_event(), which
+    //empties it again so it doesn't keep the world alive.
+    map_formula_callable_ptr event_callable();
+
     void add_event_handler(const std::string& event, const event_handler& handler);
+    void add_event_handler(event_id id, const event_handler& handler);
     bool draw() const;
     void draw_display(const_party_ptr selected_party) const;
     
@@ -138,31 +226,35 @@ private:
     
     gui::const_grid_ptr get_track_info() const;
     hex::gamemap map_;
-    typedef std::pair<party_map::iterator,party_map::iterator>
-    party_map_range;
-    typedef std::pair<party_map::const_iterator,
-                      party_map::const_iterator> const_party_map_range;
-    party_map parties_;
+    party_grid parties_;
     
-    party_map::iterator find_party(const_party_ptr p);
     party_ptr get_party_ready_to_move();
-    
-    struct party_orderer
-        : public std::binary_function<party_ptr,party_ptr,bool> {
-        result_type operator()(first_argument_type p1,
-                               second_argument_type p2) const
-        {
-            return p1->ready_to_move_at() >
-                p2->ready_to_move_at();
-        }
-    };
-    
-    typedef std::priority_queue<party_ptr,std::vector<party_ptr>,
-                                party_orderer> party_queue;
-    party_queue queue_;
+
+    //puts a party in the queue of parties waiting to move, or takes it
+    //out, through the handle the party keeps.
+    void schedule_party(party_ptr p);
+    void unschedule_party(party& p);
+
+    util::timing_wheel<party_ptr> queue_;
     
     typedef std::map<hex::location,settlement_ptr> settlement_map;
     settlement_map settlements_;
+
+    //the same entry points, bucketed by position so parties can ask
+    //what is around them without going through every settlement.
+    hex::spatial_grid<const_settlement_ptr> settlement_entrances_;
+    
+    typedef std::map<movement_profile,
+                     boost::weak_ptr<const movement_cost_grid> > cost_grid_map;
+    mutable cost_grid_map cost_grids_;
+
+    typedef std::multimap<const movement_cost_grid*,
+                          boost::weak_ptr<distance_field> > distance_field_map;
+    mutable distance_field_map distance_fields_;
+
+    typedef std::map<std::pair<hex::location,int>,
+                     hex::field_of_view_ptr> field_of_view_map;
+    mutable field_of_view_map static_views_;
     
     party_ptr focus_;
     
@@ -172,16 +264,31 @@ private:
     mutable hex::location current_loc_;
     mutable std::vector<const hex::tile*> tiles_;
     mutable gui::const_grid_ptr track_info_grid_;
+    mutable path_job_ptr hover_path_;
     
     variant get_value(const std::string& key) const;
     void set_value(const std::string& key, const variant& value);
     void get_inputs(std::vector<formula_input>* inputs) const;
     
     void find_focus();
+
+    //plays one step of the world: the turns of the parties which are
+    //ready to move and, once none are, a step of game time. If a party
+    //leaves the world, next is set to the world it goes to.
+    enum STEP_RESULT { STEP_ADVANCED, STEP_WAITING, STEP_LEFT_WORLD };
+    STEP_RESULT step(input::pump& input_pump,
+                     const formula_callable& standard_callable,
+                     party_ptr& active_party, world_ptr* next);
+
+    //how much the time moves on in each step.
+    GLfloat time_increase() const;
     
     int scale_;
     game_time time_;
     GLfloat subtime_;
+    GLfloat display_subtime_;
+    double sim_rate_;
+    statistics stats_;
     tracks tracks_;
 
 	struct destination {
@@ -190,11 +297,20 @@ private:
 	};
     
     std::map<hex::location,destination> exits_;
+
+    //the places exits to other worlds are, by the file of the world they
+    //lead to. The file is read in the background once the player's
+    //party comes near one of them.
+    std::map<std::string,std::vector<hex::location> > exits_to_load_;
+    void preload_exits(const hex::location& loc) const;
     
     const_formula_ptr sun_light_, ambient_light_, party_light_, party_light_power_;
     
-    typedef std::multimap<std::string,event_handler> event_map;
-    event_map handlers_;
+    //the handlers of each event, by its id. Handlers can add more
+    //handlers while they run, which deques allow without moving them.
+    typedef std::deque<event_handler> handler_list;
+    std::deque<handler_list> handlers_;
+    map_formula_callable_ptr event_callable_;
     
     mutable graphics::particle_system particle_system_;
     game_dialogs::game_bar_ptr game_bar_;
@@ -202,6 +318,7 @@ private:
     //if there is currently a set of scripted actions being run, the name
     //will be recorded here.
     std::string script_;
+    std::string filename_;
     std::string border_tile_;
     
     bool done_;
@@ -0,0 +1,202 @@
+/*
+   Copyright (C) 2007 by David White <dave.net>
+   Part of the Silver Tree Project
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 2 or later.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY.
+
+   See the COPYING file for more details.
+*/
+#include <algorithm>
+#include <iostream>
+
+#include "filesystem.hpp"
+#include "foreach.hpp"
+#include "preferences.hpp"
+#include "world.hpp"
+#include "world_loader.hpp"
+#include "wml_node.hpp"
+#include "wml_parser.hpp"
+
+namespace game_logic
+{
+
+world_loader& world_loader::get()
+{
+	static world_loader loader;
+	return loader;
+}
+
+world_loader::world_loader()
+  : shutting_down_(false),
+    loads_(0), kept_loads_(0), preloaded_loads_(0), preloads_(0),
+    total_wait_(0), total_load_(0)
+{
+}
+
+world_loader::~world_loader()
+{
+	{
+		threading::lock l(mutex_);
+		shutting_down_ = true;
+	}
+
+	work_available_.notify_all();
+	worker_.reset();
+}
+
+void world_loader::preload(const std::string& file)
+{
+	foreach(const world_ptr& w, kept_) {
+		if(w->filename() == file) {
+			return;
+		}
+	}
+
+	{
+		threading::lock l(mutex_);
+		if(shutting_down_ || jobs_.count(file)) {
+			return;
+		}
+
+		jobs_[file];
+		queue_.push_back(file);
+		++preloads_;
+	}
+
+	if(!worker_) {
+		worker_.reset(new threading::thread(run_worker, this));
+	}
+
+	work_available_.notify_one();
+}
+
+world_ptr world_loader::load(const std::string& file)
+{
+	for(std::list<world_ptr>::iterator i = kept_.begin();
+	    i != kept_.end(); ++i) {
+		if((*i)->filename() == file) {
+			world_ptr res = *i;
+			kept_.erase(i);
+			threading::lock l(mutex_);
+			++loads_;
+			++kept_loads_;
+			return res;
+		}
+	}
+
+	const Uint32 start = SDL_GetTicks();
+	wml::const_node_ptr node;
+	{
+		threading::lock l(mutex_);
+		std::map<std::string, job>::iterator j = jobs_.find(file);
+		if(j != jobs_.end()) {
+			while(!j->second.done) {
+				work_done_.wait(mutex_);
+			}
+
+			node = j->second.node;
+			jobs_.erase(j);
+		}
+	}
+
+	const Uint32 parsed = SDL_GetTicks();
+	const bool preloaded = node.get() != NULL;
+	if(!preloaded) {
+		node = wml::parse_wml(sys::read_file(file));
+	}
+
+	world_ptr res(new world(node));
+	res->set_filename(file);
+
+	threading::lock l(mutex_);
+	++loads_;
+	if(preloaded) {
+		++preloaded_loads_;
+		total_wait_ += parsed - start;
+	}
+
+	total_load_ += SDL_GetTicks() - start;
+	return res;
+}
+
+void world_loader::keep(world_ptr w)
+{
+	kept_.push_front(w);
+	while(kept_.size() > size_t(std::max(0, preference_world_cache()))) {
+		kept_.pop_back();
+	}
+}
+
+void world_loader::clear()
+{
+	kept_.clear();
+
+	//a file being read now is thrown away once it has been read.
+	threading::lock l(mutex_);
+	queue_.clear();
+	jobs_.clear();
+}
+
+void world_loader::shutdown(std::ostream& stats)
+{
+	kept_.clear();
+	{
+		threading::lock l(mutex_);
+		shutting_down_ = true;
+	}
+
+	work_available_.notify_all();
+	worker_.reset();
+
+	stats << "world loader: " << loads_ << " worlds loaded, " << kept_loads_
+	      << " of them kept from before and " << preloaded_loads_
+	      << " read in the background (" << preloads_ << " files read)\n";
+	if(loads_ > kept_loads_) {
+		stats << "world loader: average load " << total_load_/(loads_ - kept_loads_)
+		      << "ms, of which " << total_wait_/(loads_ - kept_loads_)
+		      << "ms waiting for files being read\n";
+	}
+}
+
+int world_loader::run_worker(void* arg)
+{
+	world_loader& loader = *static_cast<world_loader*>(arg);
+	for(;;) {
+		std::string file;
+		{
+			threading::lock l(loader.mutex_);
+			while(!loader.shutting_down_ && loader.queue_.empty()) {
+				loader.work_available_.wait(loader.mutex_);
+			}
+
+			if(loader.shutting_down_) {
+				return 0;
+			}
+
+			file = loader.queue_.front();
+			loader.queue_.pop_front();
+		}
+
+		wml::const_node_ptr node;
+		try {
+			node = wml::parse_wml(sys::read_file(file));
+		} catch(...) {
+		}
+
+		{
+			threading::lock l(loader.mutex_);
+			std::map<std::string, job>::iterator j = loader.jobs_.find(file);
+			if(j != loader.jobs_.end()) {
+				j->second.node = node;
+				j->second.done = true;
+			}
+		}
+
+		loader.work_done_.notify_all();
+	}
+}
+
+}
@@ -0,0 +1,92 @@
+/*
+   Copyright (C) 2007 by David White <dave.net>
+   Part of the Silver Tree Project
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 2 or later.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY.
+
+   See the COPYING file for more details.
+*/
+#ifndef WORLD_LOADER_HPP_INCLUDED
+#define WORLD_LOADER_HPP_INCLUDED
+
+#include <boost/shared_ptr.hpp>
+#include <deque>
+#include <iosfwd>
+#include <list>
+#include <map>
+#include <string>
+
+#include "threading.hpp"
+#include "wml_node_fwd.hpp"
+#include "world_fwd.hpp"
+
+namespace game_logic
+{
+
+//loads the worlds which exits lead to. The files of worlds the player
+//is getting close to are read and parsed on a thread of their own, so
+//that going through the exit doesn't have to wait for them, and the
+//worlds the player has left most recently are kept, so that going back
+//to them is instant.
+class world_loader
+{
+public:
+	static world_loader& get();
+
+	//starts reading the given world file in the background, unless it
+	//has been read already or its world is being kept.
+	void preload(const std::string& file);
+
+	//returns the world in the given file: the world left there, if it
+	//is being kept, and otherwise a new world made from the file. If
+	//the file is still being read in the background, waits for it.
+	world_ptr load(const std::string& file);
+
+	//keeps a world the player has left, which must have a filename. Only
+	//the worlds left most recently are kept.
+	void keep(world_ptr w);
+
+	//forgets the worlds being kept and any files which have been read.
+	void clear();
+
+	//waits for the loading thread to finish and reports statistics.
+	void shutdown(std::ostream& stats);
+
+private:
+	world_loader();
+	~world_loader();
+	world_loader(const world_loader&);
+	void operator=(const world_loader&);
+
+	static int run_worker(void* loader);
+
+	//a file to be read in the background. node is left empty if the
+	//file couldn't be read, so it can be read again to report why.
+	struct job {
+		job() : done(false) {}
+		wml::const_node_ptr node;
+		bool done;
+	};
+
+	threading::mutex mutex_;
+	threading::condition work_available_, work_done_;
+	std::deque<std::string> queue_;
+	std::map<std::string, job> jobs_;
+	boost::shared_ptr<threading::thread> worker_;
+	bool shutting_down_;
+
+	//worlds which have been left, the most recent first. Only used on
+	//the main thread.
+	std::list<world_ptr> kept_;
+
+	//statistics, protected by mutex_.
+	int loads_, kept_loads_, preloaded_loads_, preloads_;
+	Uint32 total_wait_, total_load_;
+};
+
+}
+
+#endif
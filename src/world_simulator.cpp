@@ -0,0 +1,136 @@
+/*
+   Copyright (C) 2007 by David White <dave.net>
+   Part of the Silver Tree Project
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 2 or later.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY.
+
+   See the COPYING file for more details.
+*/
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+
+#include <SDL.h>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#include "filesystem.hpp"
+#include "global_game_state.hpp"
+#include "party.hpp"
+#include "settlement.hpp"
+#include "world.hpp"
+#include "world_simulator.hpp"
+#include "wml_node.hpp"
+#include "wml_parser.hpp"
+
+namespace game_logic
+{
+
+namespace {
+//the most memory the process has used so far, in kilobytes, or -1 if
+//it can't be told.
+long peak_memory_kb()
+{
+#ifndef _WIN32
+	rusage usage;
+	if(getrusage(RUSAGE_SELF, &usage) == 0) {
+		return usage.ru_maxrss;
+	}
+#endif
+	return -1;
+}
+}
+
+bool simulate_world(const std::string& file, int days, unsigned int seed,
+                    std::ostream& out)
+{
+	if(days <= 0) {
+		std::cerr << "world simulation needs a number of days\n";
+		return false;
+	}
+
+	wml::node_ptr scenario_cfg;
+	try {
+		scenario_cfg = wml::parse_wml(sys::read_file(file));
+	} catch(...) {
+		std::cerr << "error parsing scenario '" << file << "'\n";
+		return false;
+	}
+
+	wml::node_ptr world_cfg = scenario_cfg;
+	if(scenario_cfg->name() == "scenario") {
+		global_game_state::get().reset();
+	} else if(scenario_cfg->name() == "game") {
+		world_cfg = scenario_cfg->get_child("scenario");
+		if(!world_cfg) {
+			std::cerr << "scenario parse error: could not find [scenario]\n";
+			return false;
+		}
+
+		global_game_state::get().init(scenario_cfg);
+	} else {
+		std::cerr << "unrecognized game file\n";
+		return false;
+	}
+
+	//formulas roll dice with rand(), so seed it for the run to be the
+	//same every time.
+	srand(seed);
+
+	const Uint32 start = SDL_GetTicks();
+	const std::clock_t start_cpu = std::clock();
+	world w(world_cfg);
+	const Uint32 loaded = SDL_GetTicks();
+	const long loaded_memory = peak_memory_kb();
+	const int settlements_loaded = settlement::num_loaded();
+
+	const game_time begin = w.current_time();
+	w.simulate(begin + days*24*60*60);
+
+	const Uint32 elapsed = std::max<Uint32>(SDL_GetTicks() - loaded, 1);
+	const double cpu_seconds = double(std::clock() - start_cpu)/CLOCKS_PER_SEC;
+	const int game_seconds = w.current_time() - begin;
+	const world::statistics& stats = w.stats();
+	const double game_hours = std::max(game_seconds, 1)/(60.0*60);
+
+	out << "simulated " << game_seconds/(24.0*60*60) << " of "
+	    << days << " days, to day " << w.current_time().day() << "\n"
+	    << "parties: " << w.parties().size() << ", player's party "
+	    << (w.get_pc_party() && !w.get_pc_party()->is_destroyed() ?
+	        "alive" : "gone") << "\n"
+	    << "steps: " << stats.steps << ", party turns: " << stats.party_turns
+	    << ", encounters: " << stats.encounters << "\n"
+	    << "battles: " << stats.battles << ", won by the player's party: "
+	    << stats.battles_won << "\n"
+	    << "events fired: " << stats.events_fired << " ("
+	    << stats.events_fired/game_hours << " per game hour), handlers called: "
+	    << stats.event_handlers_run << ", "
+	    << 1000.0*stats.event_handler_seconds/game_hours
+	    << "ms handling events per game hour\n"
+	    << "tracks: " << w.get_tracks().num_tracks() << " (at most "
+	    << w.get_tracks().max_tracks() << " at once), about "
+	    << w.get_tracks().memory_used()/1024 << "KB\n"
+	    << "load time: " << (loaded - start) << "ms, with "
+	    << settlements_loaded << " of " << settlement::num_settlements()
+	    << " settlements loaded (" << settlement::num_loaded()
+	    << " by the end)\n"
+	    << "run time: " << elapsed << "ms (" << cpu_seconds
+	    << "s processor time), " << (1000.0*game_seconds)/elapsed
+	    << " game seconds per second\n";
+
+	const long memory = peak_memory_kb();
+	if(memory >= 0) {
+		out << "memory once loaded: " << loaded_memory << "KB, peak memory: "
+		    << memory << "KB\n";
+	}
+
+	return true;
+}
+
+}
@@ -0,0 +1,31 @@
+/*
+   Copyright (C) 2007 by David White <dave.net>
+   Part of the Silver Tree Project
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 2 or later.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY.
+
+   See the COPYING file for more details.
+*/
+#ifndef WORLD_SIMULATOR_HPP_INCLUDED
+#define WORLD_SIMULATOR_HPP_INCLUDED
+
+#include <iosfwd>
+#include <string>
+
+namespace game_logic
+{
+
+//plays the world in a scenario or saved game on for the given number of
+//game days, as fast as it can be played, with nothing drawn and the
+//player's party resting. Battles are played by their rules alone. What
+//happened, how long it took and how much memory was used are written to
+//out. Returns false if the world couldn't be set up.
+bool simulate_world(const std::string& file, int days, unsigned int seed,
+                    std::ostream& out);
+
+}
+
+#endif
@@ -4,118 +4,166 @@
 
 #include "base_terrain.hpp"
 #include "foreach.hpp"
+#include "rng.hpp"
+#include "threading.hpp"
 #include "zoom_map_generator.hpp"
 
 namespace hex {
 
 namespace {
-GLfloat distance_between_points(GLfloat x1, GLfloat y1, GLfloat x2, GLfloat y2)
+GLfloat square_distance(GLfloat x1, GLfloat y1, GLfloat x2, GLfloat y2)
 {
-	return sqrt((x1-x2)*(x1-x2) + (y1-y2)*(y1-y2));
+	return (x1-x2)*(x1-x2) + (y1-y2)*(y1-y2);
 }
 
-}
+//what each row of the zoomed map is worked out from, and where the
+//results go. Every row writes only its own part of the arrays, so rows
+//can be worked out on any thread.
+struct zoom_job {
+	const gamemap* map;
+	location dim;
+	std::vector<GLfloat> xpos, ypos;
+	double randomness;
+	unsigned int seed;
 
-boost::shared_ptr<gamemap> generate_zoom_map(
-    const gamemap& map, const location& top_left, const location& src_dim,
-	const location& dim, double height_scale, double randomness)
-{
-	std::cerr << "zoom map: " << top_left.x() << ", " << top_left.y() << "\n";
 	std::vector<GLfloat> heights;
-	std::vector<const_base_terrain_ptr> terrains;
-	std::vector<const_terrain_feature_ptr> features;
-	for(int y = 0; y != dim.y(); ++y) {
-		GLfloat ypos = tile::translate_y(top_left.y() + static_cast<double>(y)*(static_cast<double>(src_dim.y())/static_cast<double>(dim.y())));
-		for(int x = 0; x != dim.x(); ++x) {
-			GLfloat xpos = tile::translate_x(top_left.x() + static_cast<double>(x)*(static_cast<double>(src_dim.x())/static_cast<double>(dim.x())));
-			GLfloat ytmp = ypos;
-			GLfloat xtmp = xpos;
-
-			const tile* src_tile = map.closest_tile(&xtmp, &ytmp, false);
-			assert(src_tile);
-
-			std::vector<tile::point> closest_points;
-			closest_points.push_back(src_tile->center());
-			closest_points.push_back(src_tile->corners()[0]);
-			closest_points.push_back(src_tile->corners()[1]);
-			for(int n = 2; n != 6; ++n) {
-				GLfloat max_distance = -1.0;
-				tile::point* max_point = NULL;
-				for(std::vector<tile::point>::iterator p = closest_points.begin(); p != closest_points.end(); ++p) {
-					double new_distance = distance_between_points(xpos, ypos, p->position.x(), p->position.y());
-					if(max_point == NULL || new_distance > max_distance) {
-						max_point = &*p;
-						max_distance = new_distance;
-					}
-				}
+	std::vector<const tile*> tiles;
+};
 
-				const tile::point& p = src_tile->corners()[n];
-				const GLfloat distance = distance_between_points(xpos, ypos, p.position.x(), p.position.y());
-				if(distance < max_distance) {
-					*max_point = p;
-				}
-			}
+void zoom_row(void* data, int y)
+{
+	zoom_job& job = *static_cast<zoom_job*>(data);
+	const gamemap& map = *job.map;
+
+	//each row has its own random numbers, so the map comes out the
+	//same however the rows are shared between threads.
+	game_logic::rng rng(job.seed*job.dim.y() + y);
+
+	const GLfloat ypos = job.ypos[y];
+	for(int x = 0; x != job.dim.x(); ++x) {
+		const GLfloat xpos = job.xpos[x];
+		GLfloat ytmp = ypos;
+		GLfloat xtmp = xpos;
+
+		const tile* src_tile = map.closest_tile(&xtmp, &ytmp, false);
+		assert(src_tile);
+
+		//the height is blended from the three closest of the center
+		//and corners of the tile, weighted by how close they are.
+		const tile::point* points[7];
+		GLfloat dist[7];
+		points[0] = &src_tile->center();
+		for(int n = 0; n != 6; ++n) {
+			points[n+1] = &src_tile->corners()[n];
+		}
 
-			GLfloat distance_sum = 0.0;
-			foreach(const tile::point& p, closest_points) {
-				distance_sum += distance_between_points(xpos, ypos, p.position.x(), p.position.y());
+		for(int n = 0; n != 7; ++n) {
+			dist[n] = square_distance(xpos, ypos, points[n]->position.x(),
+			                          points[n]->position.y());
+		}
+
+		int closest[3] = {0, 1, 2};
+		for(int n = 3; n != 7; ++n) {
+			int furthest = 0;
+			for(int m = 1; m != 3; ++m) {
+				if(dist[closest[m]] > dist[closest[furthest]]) {
+					furthest = m;
+				}
 			}
 
-			GLfloat height = 0.0;
-			foreach(const tile::point& p, closest_points) {
-				height += p.position.z() * (1.0 - distance_between_points(xpos, ypos, p.position.x(), p.position.y())/distance_sum);
+			if(dist[n] < dist[closest[furthest]]) {
+				closest[furthest] = n;
 			}
+		}
 
-			heights.push_back(height);
+		GLfloat closest_dist[3];
+		GLfloat distance_sum = 0.0;
+		for(int n = 0; n != 3; ++n) {
+			closest_dist[n] = sqrt(dist[closest[n]]);
+			distance_sum += closest_dist[n];
+		}
 
-			// find the closest adjacent hex and see if it overlaps
-			location adj[6];
-			GLfloat closest_distance = -1.0;
-			location closest_loc;
-			get_adjacent_tiles(src_tile->loc(), adj);
-			foreach(const location& a, adj) {
-				if(!map.is_loc_on_map(a)) {
-					continue;
-				}
+		GLfloat height = 0.0;
+		for(int n = 0; n != 3; ++n) {
+			height += points[closest[n]]->position.z() *
+			          (1.0 - closest_dist[n]/distance_sum);
+		}
 
+		// find the closest adjacent hex and see if it overlaps
+		location adj[6];
+		GLfloat closest_distance = -1.0;
+		location closest_loc;
+		get_adjacent_tiles(src_tile->loc(), adj);
+		foreach(const location& a, adj) {
+			if(!map.is_loc_on_map(a)) {
+				continue;
+			}
 
-				const GLfloat distance = distance_between_points(xpos, ypos, tile::translate_x(a), tile::translate_y(a));
-				if(closest_distance < 0.0 || distance < closest_distance) {
-					closest_distance = distance;
-					closest_loc = a;
-				}
+			const GLfloat distance = square_distance(xpos, ypos, tile::translate_x(a), tile::translate_y(a));
+			if(closest_distance < 0.0 || distance < closest_distance) {
+				closest_distance = distance;
+				closest_loc = a;
 			}
+		}
 
-			if(closest_distance >= 0.0) {
-				assert(map.is_loc_on_map(closest_loc));
-				const tile& t = map.get_tile(closest_loc);
-				if(t.terrain()->overlap_priority() > src_tile->terrain()->overlap_priority()) {
-					const GLfloat distance = distance_between_points(xpos, ypos, tile::translate_x(src_tile->loc()), tile::translate_y(src_tile->loc()));
-					const GLfloat chance_replace = (distance/(distance + closest_distance))*randomness;
-					if((rand()%100) < chance_replace*100.0) {
-						src_tile = &t;
-					}
+		if(closest_distance >= 0.0) {
+			assert(map.is_loc_on_map(closest_loc));
+			const tile& t = map.get_tile(closest_loc);
+			if(t.terrain()->overlap_priority() > src_tile->terrain()->overlap_priority()) {
+				closest_distance = sqrt(closest_distance);
+				const GLfloat distance = sqrt(square_distance(xpos, ypos, tile::translate_x(src_tile->loc()), tile::translate_y(src_tile->loc())));
+				const GLfloat chance_replace = (distance/(distance + closest_distance))*job.randomness;
+				if(rng(100) < chance_replace*100.0) {
+					src_tile = &t;
 				}
 			}
-
-			terrains.push_back(src_tile->terrain());
-			features.push_back(src_tile->feature());
 		}
+
+		const int index = y*job.dim.x() + x;
+		job.heights[index] = height;
+		job.tiles[index] = src_tile;
 	}
+}
+
+}
+
+boost::shared_ptr<gamemap> generate_zoom_map(
+    const gamemap& map, const location& top_left, const location& src_dim,
+	const location& dim, double height_scale, double randomness,
+	unsigned int seed, int nthreads)
+{
+	zoom_job job;
+	job.map = &map;
+	job.dim = dim;
+	job.randomness = randomness;
+	job.seed = seed;
+	for(int x = 0; x != dim.x(); ++x) {
+		job.xpos.push_back(tile::translate_x(top_left.x() + static_cast<double>(x)*(static_cast<double>(src_dim.x())/static_cast<double>(dim.x()))));
+	}
+
+	for(int y = 0; y != dim.y(); ++y) {
+		job.ypos.push_back(tile::translate_y(top_left.y() + static_cast<double>(y)*(static_cast<double>(src_dim.y())/static_cast<double>(dim.y()))));
+	}
+
+	job.heights.resize(dim.x()*dim.y());
+	job.tiles.resize(dim.x()*dim.y());
+	threading::parallel_for(dim.y(), zoom_row, &job, nthreads);
 
+	std::vector<GLfloat>& heights = job.heights;
 	std::vector<GLfloat>::const_iterator min_height = std::min_element(heights.begin(), heights.end());
 	assert(min_height != heights.end());
+	const GLfloat lowest = *min_height;
 	foreach(GLfloat& height, heights) {
-		height = (height - *min_height)*height_scale;
+		height = (height - lowest)*height_scale;
 	}
 
 	std::vector<tile> tiles;
-	
+	tiles.reserve(dim.x()*dim.y());
 	for(int y = 0; y != dim.y(); ++y) {
 		for(int x = 0; x != dim.x(); ++x) {
 			const int index = y*dim.x() + x;
-			assert(index < heights.size());
-			tiles.push_back(tile(location(x,y), static_cast<int>(heights[index]), terrains[index], features[index]));
+			const tile* src_tile = job.tiles[index];
+			tiles.push_back(tile(location(x,y), static_cast<int>(heights[index]), src_tile->terrain(), src_tile->feature()));
 		}
 	}
 
@@ -19,9 +19,14 @@
 namespace hex
 {
 
+//makes a map of size dim from the area of input of size src_dim at
+//top_left, with heights blended between the tiles and the edges of the
+//terrain roughened by randomness. The same seed always gives the same
+//map. The rows of the map are made on up to nthreads threads.
 boost::shared_ptr<gamemap> generate_zoom_map(
     const gamemap& input, const location& top_left, const location& src_dim,
-	const location& dim, double height_scale, double randomness);
+	const location& dim, double height_scale, double randomness,
+	unsigned int seed, int nthreads=1);
 
 }
 
@@ -0,0 +1,396 @@
+use strict;
+
+# writes a scenario made up to load the engine: a big map, lots of
+# parties and settlements, and lots of event handlers. The same options
+# and seed always give the same scenario.
+
+my $width = 256;
+my $height = 256;
+my $nparties = 100;
+my $nsettlements = 10;
+my $nevents = 50;
+my $nhills = -1;
+my $max_radius = 10;
+my $forest = 5;
+my $water = 10;
+my $seed = 1;
+my $data = 'data';
+
+while(my $arg = shift @ARGV) {
+	if($arg eq '--dim') {
+		my $dim = shift @ARGV;
+		($width,$height) = split /x/, $dim;
+	} elsif($arg eq '--parties') {
+		$nparties = shift @ARGV;
+	} elsif($arg eq '--settlements') {
+		$nsettlements = shift @ARGV;
+	} elsif($arg eq '--events') {
+		$nevents = shift @ARGV;
+	} elsif($arg eq '--hills') {
+		$nhills = shift @ARGV;
+	} elsif($arg eq '--hillsize') {
+		$max_radius = shift @ARGV;
+	} elsif($arg eq '--forest') {
+		$forest = shift @ARGV;
+	} elsif($arg eq '--water') {
+		$water = shift @ARGV;
+	} elsif($arg eq '--seed') {
+		$seed = shift @ARGV;
+	} elsif($arg eq '--data') {
+		$data = shift @ARGV;
+	} else {
+		&usage;
+	}
+}
+
+&usage if $width < 8 or $height < 8 or $width > 1024 or $height > 1024;
+
+srand($seed);
+
+$nhills = int($width*$height/2000) if $nhills < 0;
+
+# terrains which can be walked on make up the land, and those which
+# can't make up the lakes.
+my (@land, @impassable, @features);
+&read_terrain("$data/terrain.cfg");
+die "no passable terrain in $data/terrain.cfg\n" unless @land;
+
+# trees are what mostly gets in the way, if there are any.
+@features = ('F') if grep { $_ eq 'F' } @features;
+
+my @generators = &read_generators("$data/character_generators.cfg");
+die "no character generators in $data/character_generators.cfg\n" unless @generators;
+
+my @towns = &read_settlements($data);
+die "no settlements in $data to reuse\n" if $nsettlements > 0 and !@towns;
+
+# the terrain is chosen for cells of the map, with the edges of the
+# cells made ragged so they don't look like squares.
+my $cell = 16;
+my $cells_wide = int(($width + $cell - 1)/$cell) + 1;
+my $cells_high = int(($height + $cell - 1)/$cell) + 1;
+my @cells = ();
+for(my $n = 0; $n != $cells_wide*$cells_high; ++$n) {
+	if(@impassable and rand(100) < $water) {
+		push @cells, $impassable[int(rand(@impassable))];
+	} else {
+		push @cells, $land[int(rand(@land))];
+	}
+}
+
+my @terrain = ();
+my @feature = ();
+my @heights = (0) x ($width*$height);
+for(my $y = 0; $y != $height; ++$y) {
+	for(my $x = 0; $x != $width; ++$x) {
+		my $cx = int(($x + rand(6))/$cell);
+		my $cy = int(($y + rand(6))/$cell);
+		my $t = $cells[$cy*$cells_wide + $cx];
+		push @terrain, $t;
+		push @feature, ($t->{passable} and @features and rand(100) < $forest) ?
+		               $features[int(rand(@features))] : '';
+	}
+}
+
+for(my $n = 0; $n != $nhills; ++$n) {
+	&apply_hill(rand($width), rand($height), rand($max_radius));
+}
+
+# settlements and parties are put on hexes which can be walked on, and
+# no two on the same hex.
+my %used = ();
+
+my @settlements = ();
+for(my $n = 0; $n != $nsettlements; ++$n) {
+	my ($x,$y) = &find_hex;
+	my $town = $towns[int(rand(@towns))];
+	push @settlements, "\t[settlement]
+	file=\"$town->{file}\"
+		[portal]
+		xdst=\"$town->{x}\"
+		xsrc=\"$x\"
+		ydst=\"$town->{y}\"
+		ysrc=\"$y\"
+		[/portal]
+	[/settlement]
+";
+}
+
+my @party_ids = ();
+my @parties = ();
+for(my $n = 0; $n != $nparties; ++$n) {
+	my ($x,$y) = &find_hex;
+	my $id = "scale_$n";
+	push @party_ids, $id;
+
+	my $allegiance = rand(2) < 1 ? 'good' : 'evil';
+	my $aggressive = rand(4) < 1 ? 'yes' : 'no';
+	my $money = int(rand(20));
+	my $copies = 1 + int(rand(3));
+	my $generator = $generators[int(rand(@generators))];
+	my $party = "\t[party]
+	aggressive=\"$aggressive\"
+	allegiance=\"$allegiance\"
+	id=\"$id\"
+	money=\"$money\"
+	x=\"$x\"
+	y=\"$y\"
+";
+
+	# most parties wander between a few places near where they start.
+	if(rand(4) >= 1) {
+		for(my $i = 0; $i != 3; ++$i) {
+			my ($wx,$wy) = &find_hex_near($x, $y, 30);
+			$party .= "\t\t[wander]\n\t\tx=\"$wx\"\n\t\ty=\"$wy\"\n\t\t[/wander]\n";
+		}
+	}
+
+	$party .= "\t\t[character]
+		copies=\"$copies\"
+		id=\"$generator\"
+		[/character]
+	[/party]
+";
+	push @parties, $party;
+}
+
+# the handlers are shared out between the kinds of event, each with a
+# filter cheap enough that calling the handlers is what gets measured.
+my @events = ("\t[event]
+	event=\"start\"
+		[set]
+		handled=\"0\"
+		object=\"var.scale\"
+		[/set]
+	[/event]
+");
+my @kinds = ('tick', 'begin_move', 'end_move', 'sight', 'encounter');
+for(my $n = 0; $n != $nevents; ++$n) {
+	my $kind = $kinds[$n%@kinds];
+	my $filter;
+	if($kind eq 'tick') {
+		my $minute = int(rand(60));
+		$filter = "world.time.minute = $minute";
+	} elsif($kind eq 'end_move') {
+		my ($x,$y) = (int(rand($width)), int(rand($height)));
+		$filter = "party.loc.x = $x and party.loc.y = $y";
+	} elsif(@party_ids == 0) {
+		$filter = 'world.time.minute = 0';
+		$kind = 'tick';
+	} elsif($kind eq 'encounter') {
+		# an [encounter] within a party is turned into a handler which
+		# is only looked at for that party.
+		my $p = int(rand(@parties));
+		$parties[$p] =~ s/\t\[\/party\]\n$/\t\t[encounter]
+		event="$kind"
+			[set]
+			handled="var.scale.handled + 1"
+			object="var.scale"
+			[\/set]
+		[\/encounter]
+	[\/party]
+/;
+		next;
+	} else {
+		my $id = $party_ids[int(rand(@party_ids))];
+		my $who = $kind eq 'sight' ? 'npc' : 'party';
+		$filter = "$who.id = '$id'";
+	}
+
+	push @events, "\t[event]
+	event=\"$kind\"
+	filter=\"$filter\"
+		[set]
+		handled=\"var.scale.handled + 1\"
+		object=\"var.scale\"
+		[/set]
+	[/event]
+";
+}
+
+# the player's party starts near the middle of the map.
+my ($pcx,$pcy) = &find_hex_near(int($width/2), int($height/2), 20);
+my $pc_generator = (grep { $_ eq 'swordsman' } @generators) ? 'swordsman' : $generators[0];
+
+print "[scenario]
+hours=\"9\"
+map_data=\"";
+
+for(my $y = 0; $y != $height; ++$y) {
+	my @output = ();
+	for(my $x = 0; $x != $width; ++$x) {
+		my $i = $y*$width + $x;
+		my $f = $feature[$i] eq '' ? '' : " $feature[$i]";
+		push @output, int($heights[$i]) . " $terrain[$i]->{id}$f";
+	}
+
+	print join ",", @output;
+	print "\n" unless $y == $height - 1;
+}
+
+print "\"\n";
+print @settlements;
+print @events;
+print @parties;
+print "\t[party]
+	aggressive=\"no\"
+	allegiance=\"good\"
+	controller=\"human\"
+	money=\"20\"
+	x=\"$pcx\"
+	y=\"$pcy\"
+		[character]
+		description=\"Tester\"
+		id=\"$pc_generator\"
+		[/character]
+	[/party]
+[/scenario]
+";
+
+sub usage
+{
+	print STDERR "Options:
+--dim WxH: specifies map dimensions, up to 1024x1024
+--parties n: specifies number of NPC parties
+--settlements n: specifies number of settlements
+--events n: specifies number of event handlers
+--hills n: specifies number of hills
+--hillsize n: specifies size of hills
+--forest n: specifies the % chance each tile will have a tree on it
+--water n: specifies the % of the map which can't be walked on
+--seed n: specifies the random seed; the same seed gives the same scenario
+--data dir: specifies where to find terrain.cfg and the settlements
+";
+	exit;
+}
+
+sub read_terrain
+{
+	my ($file) = @_;
+	open my $in, '<', $file or die "could not open $file\n";
+	my ($tag, $id, $cost);
+	while(my $line = <$in>) {
+		if($line =~ /^\s*\[(terrain|terrain_feature)\]/) {
+			($tag, $id, $cost) = ($1, undef, undef);
+		} elsif($line =~ /^\s*id=(\S+)/) {
+			$id = $1;
+		} elsif($line =~ /^\s*cost=(\S+)/) {
+			$cost = $1;
+		} elsif($line =~ /^\s*\[\/(terrain|terrain_feature)\]/ and defined $id) {
+			# terrain without a cost can't be told apart, so is left out.
+			next unless defined $cost;
+			my $passable = $cost ne 'impassable';
+			if($tag eq 'terrain_feature') {
+				# features only go on the map to get in the way.
+				push @features, $id unless $passable;
+			} elsif($id ne 'v') {
+				my $t = { id => $id, passable => $passable };
+				push @{$passable ? \@land : \@impassable}, $t;
+			}
+		}
+	}
+	close $in;
+}
+
+sub read_generators
+{
+	my ($file) = @_;
+	open my $in, '<', $file or die "could not open $file\n";
+	my @res = ();
+	my $in_generator = 0;
+	while(my $line = <$in>) {
+		if($line =~ /^\s*\[character_generator\]/) {
+			$in_generator = 1;
+		} elsif($in_generator and $line =~ /^\s*id=(\S+)/) {
+			push @res, $1;
+			$in_generator = 0;
+		}
+	}
+	close $in;
+	return @res;
+}
+
+# the settlements are the ones in the shipped scenarios, entered at the
+# same place as they are there.
+sub read_settlements
+{
+	my ($dir) = @_;
+	my %found = ();
+	foreach my $file (sort glob("$dir/*.cfg")) {
+		open my $in, '<', $file or next;
+		my ($town, $x, $y);
+		while(my $line = <$in>) {
+			if($line =~ /^\s*\[settlement\]/) {
+				($town, $x, $y) = (undef, undef, undef);
+			} elsif($line =~ /^\s*file="?([^"\s]+)"?/) {
+				$town = $1;
+			} elsif($line =~ /^\s*xdst="?(\d+)"?/) {
+				$x = $1;
+			} elsif($line =~ /^\s*ydst="?(\d+)"?/) {
+				$y = $1;
+			} elsif($line =~ /^\s*\[\/settlement\]/ and defined $town and
+			        defined $x and defined $y) {
+				$found{$town} = { file => $town, x => $x, y => $y }
+				    unless exists $found{$town};
+			}
+		}
+		close $in;
+	}
+
+	return map { $found{$_} } sort keys %found;
+}
+
+sub walkable
+{
+	my ($x,$y) = @_;
+	my $i = $y*$width + $x;
+	return $terrain[$i]->{passable} && $feature[$i] eq '' && !$used{$i};
+}
+
+sub find_hex
+{
+	for(my $tries = 0; $tries != 10000; ++$tries) {
+		my ($x,$y) = (int(rand($width)), int(rand($height)));
+		if(&walkable($x,$y)) {
+			$used{$y*$width + $x} = 1;
+			return ($x,$y);
+		}
+	}
+
+	die "could not find anywhere to put everything; try a bigger map\n";
+}
+
+sub find_hex_near
+{
+	my ($xloc,$yloc,$radius) = @_;
+	for(my $tries = 0; $tries != 1000; ++$tries) {
+		my $x = $xloc + int(rand(2*$radius + 1)) - $radius;
+		my $y = $yloc + int(rand(2*$radius + 1)) - $radius;
+		next if $x < 0 or $y < 0 or $x >= $width or $y >= $height;
+		if(&walkable($x,$y)) {
+			return ($x,$y);
+		}
+	}
+
+	return &find_hex;
+}
+
+sub apply_hill
+{
+	my ($xloc,$yloc,$radius) = @_;
+	my $x1 = int($xloc - $radius);
+	my $y1 = int($yloc - $radius);
+	$x1 = 0 if $x1 < 0;
+	$y1 = 0 if $y1 < 0;
+	for(my $x = $x1; $x < $width and $x <= $xloc + $radius; ++$x) {
+		for(my $y = $y1; $y < $height and $y <= $yloc + $radius; ++$y) {
+			my $xdiff = ($xloc - $x);
+			my $ydiff = ($yloc - $y);
+
+			my $h = $radius - sqrt($xdiff*$xdiff + $ydiff*$ydiff);
+			if($h > 0) {
+				$heights[$y*$width + $x] += $h;
+			}
+		}
+	}
+}